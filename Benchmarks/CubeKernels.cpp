@@ -0,0 +1,324 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// Micro-benchmarks of the CPU ports of the cube-map compute passes, each run alone over a
+// whole level, parameterized by the face size of the probe, the threads of the scheduler,
+// and the ISA of the dispatched kernels. Each reports the texels written per second and
+// the compulsory memory traffic in GB/s, with each pass reading its inputs and writing its
+// outputs once.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <benchmark/benchmark.h>
+#include "CPU/LightProbe.h"
+#include "CPU/SphericalHarmonics.h"
+#include "TestUtils.h"
+
+using namespace std;
+using namespace CPU;
+
+static const uint32_t FaceSizes[] = { 32, 128, 512, 2048, 4096 };
+
+static uint64_t getCubeBytes(uint32_t size)
+{
+	return static_cast<uint64_t>(size) * size * CubeMap::FaceCount * CubeMap::ChannelCount * sizeof(float);
+}
+
+static uint64_t getCubeTexels(uint32_t size)
+{
+	return static_cast<uint64_t>(size) * size * CubeMap::FaceCount;
+}
+
+static Scheduler::sptr getScheduler(uint32_t numThreads)
+{
+	static map<uint32_t, Scheduler::sptr> schedulers;
+
+	auto& scheduler = schedulers[numThreads];
+	if (!scheduler)
+	{
+		scheduler = make_shared<Scheduler>();
+		if (!scheduler->Init(numThreads)) scheduler.reset();
+	}
+
+	return scheduler;
+}
+
+namespace
+{
+	//--------------------------------------------------------------------------------------
+	// Light probe running one of its per-band kernels over a whole level
+	//--------------------------------------------------------------------------------------
+	class LightProbeKernels : public LightProbe
+	{
+	public:
+		enum Kernel : uint8_t
+		{
+			GEN_RADIANCE,		// CSGenRadiance: level 0 from two blended sources
+			BLIT_CUBE,			// CSBlitCube: level 1 from the radiance
+			COS_UP_IN_PLACE,	// CSCosUp_in_place: level 1 from level 2
+			COSINE_UP			// CSCosineUp: level 0 from level 1 and the radiance
+		};
+
+		LightProbeKernels();
+		virtual ~LightProbeKernels();
+
+		// The sources are half the size, so that the radiance generation samples them
+		bool Init(uint32_t size, const Scheduler::sptr& scheduler);
+		void SetKernel(Kernel kernel);
+		void Run();
+
+		uint64_t GetTexels() const;
+		uint64_t GetBytes() const;
+
+		using uptr = std::unique_ptr<LightProbeKernels>;
+
+	protected:
+		TaskGraph	m_kernelGraph;
+		Kernel		m_kernel;
+	};
+}
+
+LightProbeKernels::LightProbeKernels() :
+	m_kernel(GEN_RADIANCE)
+{
+}
+
+LightProbeKernels::~LightProbeKernels()
+{
+}
+
+bool LightProbeKernels::Init(uint32_t size, const Scheduler::sptr& scheduler)
+{
+	CubeMap::sptr sources[2];
+	for (auto i = 0u; i < 2; ++i)
+	{
+		sources[i] = make_shared<CubeMap>();
+		if (!sources[i]->Create((max)(size / 2, 1u))) return false;
+		TestUtils::FillRandom(*sources[i], i + 1);
+	}
+
+	if (!LightProbe::Init(sources, 2, UPSAMPLE_PER_LEVEL, scheduler)) return false;
+	if (m_numLevels < 3) return false;
+
+	// Halfway between the sources
+	UpdateFrame(1.5);
+
+	TestUtils::FillRandom(*m_radiance, 3);
+	TestUtils::FillRandom(*m_irradiance, 4);
+
+	return true;
+}
+
+void LightProbeKernels::SetKernel(Kernel kernel)
+{
+	m_kernel = kernel;
+	m_kernelGraph.Clear();
+
+	switch (kernel)
+	{
+	case GEN_RADIANCE:
+		forEachTile(RADIANCE, 0, [this](uint8_t s, uint32_t i, uint32_t rowEnd)
+		{
+			m_kernelGraph.AddTask([this, s, i, rowEnd]() { generateRadiance(s, i, rowEnd); });
+		});
+		break;
+	case BLIT_CUBE:
+		forEachTile(MIP_GEN, 1, [this](uint8_t s, uint32_t i, uint32_t rowEnd)
+		{
+			m_kernelGraph.AddTask([this, s, i, rowEnd]() { generateMips(1, s, i, rowEnd); });
+		});
+		break;
+	default:
+	{
+		const uint8_t level = kernel == COSINE_UP ? 0 : 1;
+		forEachTile(UP_SAMPLE, level, [this, level](uint8_t s, uint32_t i, uint32_t rowEnd)
+		{
+			m_kernelGraph.AddTask([this, level, s, i, rowEnd]() { upsample(level, s, i, rowEnd); });
+		});
+	}
+	}
+}
+
+void LightProbeKernels::Run()
+{
+	m_scheduler->Run(m_kernelGraph);
+}
+
+uint64_t LightProbeKernels::GetTexels() const
+{
+	const uint8_t level = m_kernel == BLIT_CUBE || m_kernel == COS_UP_IN_PLACE ? 1 : 0;
+
+	return getCubeTexels(m_irradiance->GetSize(level));
+}
+
+uint64_t LightProbeKernels::GetBytes() const
+{
+	const auto size0 = m_irradiance->GetSize(0);
+	const auto size1 = m_irradiance->GetSize(1);
+	const auto size2 = m_irradiance->GetSize(2);
+
+	switch (m_kernel)
+	{
+	case GEN_RADIANCE:
+		return getCubeBytes(m_sources[0]->GetSize()) + getCubeBytes(m_sources[1]->GetSize()) + getCubeBytes(size0);
+	case BLIT_CUBE:
+		return getCubeBytes(size0) + getCubeBytes(size1);
+	case COS_UP_IN_PLACE:
+		return getCubeBytes(size2) + getCubeBytes(size1) * 2;
+	default:
+		return getCubeBytes(size1) + getCubeBytes(size0) * 2;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Benchmarks
+//--------------------------------------------------------------------------------------
+
+// The inputs of the last configuration are kept across the ISAs and the kernels, and
+// released for another one, as the largest faces take several GB; see registerBenchmarks.
+static LightProbeKernels::uptr g_lightProbe;
+static CubeMap::uptr g_radiance;
+static uint32_t g_size = 0;
+static uint32_t g_numThreads = 0;
+
+static void setReport(benchmark::State& state, uint64_t texels, uint64_t bytes, ISA isa)
+{
+	state.counters["texels/s"] = benchmark::Counter(static_cast<double>(texels),
+		benchmark::Counter::kIsIterationInvariantRate);
+	state.counters["GB/s"] = benchmark::Counter(bytes * 1.0e-9, benchmark::Counter::kIsIterationInvariantRate);
+	state.SetLabel(GetISAName(isa));
+}
+
+static void CubeKernel(benchmark::State& state, LightProbeKernels::Kernel kernel)
+{
+	const auto size = static_cast<uint32_t>(state.range(0));
+	const auto numThreads = static_cast<uint32_t>(state.range(1));
+	const auto isa = static_cast<ISA>(state.range(2));
+
+	if (!g_lightProbe || g_size != size || g_numThreads != numThreads)
+	{
+		g_radiance.reset();
+		g_lightProbe.reset();
+		g_lightProbe = make_unique<LightProbeKernels>();
+		g_size = size;
+		g_numThreads = numThreads;
+
+		const auto scheduler = getScheduler(numThreads);
+		if (!scheduler || !g_lightProbe->Init(size, scheduler))
+		{
+			g_lightProbe.reset();
+			state.SkipWithError("Failed to create the light probe");
+
+			return;
+		}
+	}
+
+	SetISA(isa);
+	g_lightProbe->SetKernel(kernel);
+	for (auto _ : state) g_lightProbe->Run();
+
+	setReport(state, g_lightProbe->GetTexels(), g_lightProbe->GetBytes(), isa);
+}
+
+static void SHProjection(benchmark::State& state)
+{
+	const auto size = static_cast<uint32_t>(state.range(0));
+	const auto numThreads = static_cast<uint32_t>(state.range(1));
+	const auto isa = static_cast<ISA>(state.range(2));
+
+	if (!g_radiance || g_size != size)
+	{
+		g_lightProbe.reset();
+		g_radiance.reset();
+		g_radiance = make_unique<CubeMap>();
+		g_size = size;
+		if (!g_radiance->Create(size))
+		{
+			g_radiance.reset();
+			state.SkipWithError("Failed to create the radiance");
+
+			return;
+		}
+		TestUtils::FillRandom(*g_radiance, 1);
+	}
+
+	SHProjector<3> projector;
+	if (!projector.Init(getScheduler(numThreads)))
+	{
+		state.SkipWithError("Failed to create the SH projector");
+
+		return;
+	}
+
+	float3 coeffs[SHProjector<3>::NumCoeffs];
+	for (auto _ : state)
+	{
+		projector.Project(*g_radiance, coeffs, 0, isa);
+		benchmark::DoNotOptimize(coeffs);
+	}
+
+	// The radiance, and the solid angles of the upper half rows of a face
+	setReport(state, getCubeTexels(size), getCubeBytes(size) + static_cast<uint64_t>(size) * size / 2 * sizeof(float), isa);
+}
+
+// Registered size-major, then by thread count, so that the cached inputs are reused by
+// all the kernels and the ISAs of a configuration before moving to the next one
+static void registerBenchmarks()
+{
+	static const struct
+	{
+		const char* Name;
+		LightProbeKernels::Kernel Kernel;
+	} kernels[] =
+	{
+		{ "CubeKernel/CSGenRadiance", LightProbeKernels::GEN_RADIANCE },
+		{ "CubeKernel/CSBlitCube", LightProbeKernels::BLIT_CUBE },
+		{ "CubeKernel/CSCosUp_in_place", LightProbeKernels::COS_UP_IN_PLACE },
+		{ "CubeKernel/CSCosineUp", LightProbeKernels::COSINE_UP }
+	};
+
+	// 1 thread doubling up to all hardware threads, and the scalar and the native ISAs
+	const auto maxThreads = (max)(thread::hardware_concurrency(), 1u);
+	vector<uint32_t> threadCounts;
+	for (auto n = 1u; n < maxThreads; n *= 2) threadCounts.push_back(n);
+	threadCounts.push_back(maxThreads);
+
+	vector<ISA> isas(1, ISA::SCALAR);
+	if (GetNativeISA() != ISA::SCALAR) isas.push_back(GetNativeISA());
+
+	const auto setArgs = [](benchmark::internal::Benchmark* pBenchmark, uint32_t size, uint32_t numThreads, ISA isa)
+	{
+		pBenchmark->ArgNames({ "size", "threads", "isa" });
+		pBenchmark->Args({ static_cast<int64_t>(size), static_cast<int64_t>(numThreads), static_cast<int64_t>(isa) });
+		pBenchmark->UseRealTime()->Unit(benchmark::kMillisecond);
+	};
+
+	// The SH projection only keeps the radiance, which does not depend on the thread count
+	for (const auto size : FaceSizes)
+	{
+		for (const auto numThreads : threadCounts)
+			for (const auto& kernel : kernels)
+				for (const auto isa : isas)
+					setArgs(benchmark::RegisterBenchmark(kernel.Name, CubeKernel, kernel.Kernel), size, numThreads, isa);
+
+		for (const auto numThreads : threadCounts)
+			for (const auto isa : isas)
+				setArgs(benchmark::RegisterBenchmark("SHProjection", SHProjection), size, numThreads, isa);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+	registerBenchmarks();
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	return 0;
+}
@@ -149,7 +149,9 @@ LICENSE
 */
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+#ifdef _MSC_VER
 #define __STDC_LIB_EXT1__
+#endif
 #include "stb_image_write.h"
 
 /*
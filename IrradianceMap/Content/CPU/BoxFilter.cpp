@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "BoxFilter.h"
+
+using namespace CPU;
+
+// Vertical sums first, then horizontal, so that all the kernels round identically
+static inline float box(const float* pRow0, const float* pRow1, uint32_t j)
+{
+	return ((pRow0[j * 2] + pRow1[j * 2]) + (pRow0[j * 2 + 1] + pRow1[j * 2 + 1])) * 0.25f;
+}
+
+#if defined(CPU_SIMD_X86)
+CPU_TARGET_AVX2
+static void boxDownsampleAVX2(float* pDst, const float* pSrc, uint32_t srcSize,
+	uint32_t rowBegin, uint32_t rowEnd)
+{
+	const auto dstSize = srcSize / 2;
+	const auto quarter = _mm256_set1_ps(0.25f);
+
+	for (auto i = rowBegin; i < rowEnd; ++i)
+	{
+		const auto pRow0 = &pSrc[static_cast<size_t>(srcSize) * (i * 2)];
+		const auto pRow1 = pRow0 + srcSize;
+		const auto pOut = &pDst[static_cast<size_t>(dstSize) * i];
+
+		// 8 destination texels from a 16x2 source block per iteration
+		auto j = 0u;
+		for (; j + 8 <= dstSize; j += 8)
+		{
+			const auto v0 = _mm256_add_ps(_mm256_loadu_ps(&pRow0[j * 2]), _mm256_loadu_ps(&pRow1[j * 2]));
+			const auto v1 = _mm256_add_ps(_mm256_loadu_ps(&pRow0[j * 2 + 8]), _mm256_loadu_ps(&pRow1[j * 2 + 8]));
+
+			// hadd works within 128-bit lanes, so restore the texel order across lanes
+			const auto h = _mm256_hadd_ps(v0, v1);
+			const auto sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(h), 0xd8));
+			_mm256_storeu_ps(&pOut[j], _mm256_mul_ps(sum, quarter));
+		}
+
+		for (; j < dstSize; ++j)
+			pOut[j] = box(pRow0, pRow1, j);
+	}
+}
+#endif
+
+#if defined(CPU_SIMD_NEON)
+static void boxDownsampleNEON(float* pDst, const float* pSrc, uint32_t srcSize,
+	uint32_t rowBegin, uint32_t rowEnd)
+{
+	const auto dstSize = srcSize / 2;
+
+	for (auto i = rowBegin; i < rowEnd; ++i)
+	{
+		const auto pRow0 = &pSrc[static_cast<size_t>(srcSize) * (i * 2)];
+		const auto pRow1 = pRow0 + srcSize;
+		const auto pOut = &pDst[static_cast<size_t>(dstSize) * i];
+
+		// 8 destination texels from a 16x2 source block per iteration, de-interleaved by vld2q
+		auto j = 0u;
+		for (; j + 8 <= dstSize; j += 8)
+		{
+			const auto a0 = vld2q_f32(&pRow0[j * 2]);
+			const auto b0 = vld2q_f32(&pRow1[j * 2]);
+			const auto a1 = vld2q_f32(&pRow0[j * 2 + 8]);
+			const auto b1 = vld2q_f32(&pRow1[j * 2 + 8]);
+			const auto s0 = vaddq_f32(vaddq_f32(a0.val[0], b0.val[0]), vaddq_f32(a0.val[1], b0.val[1]));
+			const auto s1 = vaddq_f32(vaddq_f32(a1.val[0], b1.val[0]), vaddq_f32(a1.val[1], b1.val[1]));
+			vst1q_f32(&pOut[j], vmulq_n_f32(s0, 0.25f));
+			vst1q_f32(&pOut[j + 4], vmulq_n_f32(s1, 0.25f));
+		}
+
+		for (; j < dstSize; ++j)
+			pOut[j] = box(pRow0, pRow1, j);
+	}
+}
+#endif
+
+void CPU::BoxDownsampleScalar(float* pDst, const float* pSrc, uint32_t srcSize,
+	uint32_t rowBegin, uint32_t rowEnd)
+{
+	const auto dstSize = srcSize / 2;
+
+	for (auto i = rowBegin; i < rowEnd; ++i)
+	{
+		const auto pRow0 = &pSrc[static_cast<size_t>(srcSize) * (i * 2)];
+		const auto pRow1 = pRow0 + srcSize;
+		const auto pOut = &pDst[static_cast<size_t>(dstSize) * i];
+
+		for (auto j = 0u; j < dstSize; ++j)
+			pOut[j] = box(pRow0, pRow1, j);
+	}
+}
+
+void CPU::BoxDownsample(float* pDst, const float* pSrc, uint32_t srcSize,
+	uint32_t rowBegin, uint32_t rowEnd, ISA isa)
+{
+	switch (isa)
+	{
+#if defined(CPU_SIMD_X86)
+	case ISA::AVX2:
+		boxDownsampleAVX2(pDst, pSrc, srcSize, rowBegin, rowEnd);
+		break;
+#endif
+#if defined(CPU_SIMD_NEON)
+	case ISA::NEON:
+		boxDownsampleNEON(pDst, pSrc, srcSize, rowBegin, rowEnd);
+		break;
+#endif
+	default:
+		BoxDownsampleScalar(pDst, pSrc, srcSize, rowBegin, rowEnd);
+	}
+}
+
+void CPU::BoxDownsample(float* pDst, const float* pSrc, uint32_t srcSize, ISA isa)
+{
+	BoxDownsample(pDst, pSrc, srcSize, 0, srcSize / 2, isa);
+}
+
+bool CPU::BoxDownsample(CubeMap& dst, uint8_t dstLevel, const CubeMap& src, uint8_t srcLevel, ISA isa)
+{
+	const auto srcSize = src.GetSize(srcLevel);
+	if (srcSize < 2 || dst.GetSize(dstLevel) * 2 != srcSize) return false;
+
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+			BoxDownsample(dst.GetPlane(dstLevel, s, c), src.GetPlane(srcLevel, s, c), srcSize, isa);
+
+	return true;
+}
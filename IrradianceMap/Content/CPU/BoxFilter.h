@@ -0,0 +1,28 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CubeMap.h"
+#include "SIMD.h"
+
+namespace CPU
+{
+	//--------------------------------------------------------------------------------------
+	// 2x2 box reduction, equivalent to CSBlitCube/PSBlitCube sampling a 2x finer level
+	//--------------------------------------------------------------------------------------
+
+	// Reduces rows [rowBegin, rowEnd) of a planar destination face of size (srcSize / 2)^2
+	void BoxDownsample(float* pDst, const float* pSrc, uint32_t srcSize,
+		uint32_t rowBegin, uint32_t rowEnd, ISA isa = GetISA());
+	void BoxDownsample(float* pDst, const float* pSrc, uint32_t srcSize, ISA isa = GetISA());
+
+	// Scalar reference for validation
+	void BoxDownsampleScalar(float* pDst, const float* pSrc, uint32_t srcSize,
+		uint32_t rowBegin, uint32_t rowEnd);
+
+	// Reduces all faces and channels of srcLevel into dstLevel, which must be exactly
+	// half the size; returns false otherwise.
+	bool BoxDownsample(CubeMap& dst, uint8_t dstLevel, const CubeMap& src, uint8_t srcLevel, ISA isa = GetISA());
+}
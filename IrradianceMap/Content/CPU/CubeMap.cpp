@@ -0,0 +1,378 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include "CubeMap.h"
+#include "Optional/XUSGDDSWriter.h"
+
+using namespace std;
+using namespace CPU;
+
+float3 CPU::GetCubeTexcoord(uint8_t slice, const float3& pos)
+{
+	switch (slice)
+	{
+	case 0:
+		return float3(pos.z, pos.y, -pos.x);
+	case 1:
+		return float3(-pos.z, pos.y, pos.x);
+	case 2:
+		return float3(pos.x, pos.z, -pos.y);
+	case 3:
+		return float3(pos.x, -pos.z, pos.y);
+	case 4:
+		return float3(pos.x, pos.y, pos.z);
+	case 5:
+		return float3(-pos.x, pos.y, -pos.z);
+	default:
+		return pos;
+	}
+}
+
+float3 CPU::GetCubeTexcoord(uint32_t x, uint32_t y, uint8_t slice, uint32_t size)
+{
+	const auto radius = size * 0.5f;
+	const float3 pos(x - radius + 0.5f, -(y - radius + 0.5f), radius);
+
+	return GetCubeTexcoord(slice, pos);
+}
+
+float3 CPU::GetCubeTexcoord(uint8_t slice, float u, float v)
+{
+	const float3 pos(u * 2.0f - 1.0f, -(v * 2.0f - 1.0f), 1.0f);
+
+	return GetCubeTexcoord(slice, pos);
+}
+
+uint8_t CPU::GetCubeFace(const float3& dir, uint32_t size, float& x, float& y)
+{
+	const auto ax = fabs(dir.x);
+	const auto ay = fabs(dir.y);
+	const auto az = fabs(dir.z);
+
+	uint8_t face;
+	float3 pos;
+	if (ax >= ay && ax >= az)
+	{
+		face = dir.x >= 0.0f ? 0 : 1;
+		pos = dir.x >= 0.0f ? float3(-dir.z, dir.y, dir.x) : float3(dir.z, dir.y, -dir.x);
+	}
+	else if (ay >= az)
+	{
+		face = dir.y >= 0.0f ? 2 : 3;
+		pos = dir.y >= 0.0f ? float3(dir.x, -dir.z, dir.y) : float3(dir.x, dir.z, -dir.y);
+	}
+	else
+	{
+		face = dir.z >= 0.0f ? 4 : 5;
+		pos = dir.z >= 0.0f ? float3(dir.x, dir.y, dir.z) : float3(-dir.x, dir.y, -dir.z);
+	}
+
+	const auto radius = size * 0.5f;
+	const auto scale = pos.z > 0.0f ? radius / pos.z : 0.0f;
+	x = pos.x * scale + radius;
+	y = -pos.y * scale + radius;
+
+	return face;
+}
+
+uint8_t CPU::WrapCubeTexel(uint8_t face, uint32_t size, int32_t& x, int32_t& y)
+{
+	const auto maxCoord = static_cast<int32_t>(size) - 1;
+	if (x >= 0 && y >= 0 && x <= maxCoord && y <= maxCoord) return face;
+
+	// Re-project the texel center on the extended face plane onto the adjacent face
+	const auto radius = size * 0.5f;
+	const float3 pos(x + 0.5f - radius, -(y + 0.5f - radius), radius);
+	const auto dir = GetCubeTexcoord(face, pos);
+
+	float u, v;
+	face = GetCubeFace(dir, size, u, v);
+	x = (min)((max)(static_cast<int32_t>(floor(u)), 0), maxCoord);
+	y = (min)((max)(static_cast<int32_t>(floor(v)), 0), maxCoord);
+
+	return face;
+}
+
+float CPU::GetCubeTexelSolidAngle(uint32_t x, uint32_t y, uint32_t size)
+{
+	// Integral of the solid angle from the face center to (u, v) on the unit-distance face
+	const auto areaElement = [](double u, double v)
+	{
+		return atan2(u * v, sqrt(u * u + v * v + 1.0));
+	};
+
+	const auto scale = 2.0 / size;
+	const auto u0 = x * scale - 1.0;
+	const auto v0 = y * scale - 1.0;
+	const auto u1 = u0 + scale;
+	const auto v1 = v0 + scale;
+
+	return static_cast<float>(areaElement(u0, v0) - areaElement(u0, v1) - areaElement(u1, v0) + areaElement(u1, v1));
+}
+
+//--------------------------------------------------------------------------------------
+// Row LUT
+//--------------------------------------------------------------------------------------
+
+// GetCubeTexcoord(slice, pos) as signed components of pos, for the SIMD kernels
+struct FaceMapping
+{
+	uint8_t Axes[3];
+	float Signs[3];
+};
+
+static const FaceMapping FaceMappings[] =
+{
+	{ { 2, 1, 0 }, { 1.0f, 1.0f, -1.0f } },
+	{ { 2, 1, 0 }, { -1.0f, 1.0f, 1.0f } },
+	{ { 0, 2, 1 }, { 1.0f, 1.0f, -1.0f } },
+	{ { 0, 2, 1 }, { 1.0f, -1.0f, 1.0f } },
+	{ { 0, 1, 2 }, { 1.0f, 1.0f, 1.0f } },
+	{ { 0, 1, 2 }, { -1.0f, 1.0f, -1.0f } }
+};
+
+// The face-local position is (offsets[x], py, pz), whose squared length sums x^2 last
+static void getRowDirections(const float* pOffsets, float py, float pz, uint8_t face,
+	uint32_t xBegin, uint32_t xEnd, float* const pDirs[3])
+{
+	const auto yz = py * py + pz * pz;
+	for (auto x = xBegin; x < xEnd; ++x)
+	{
+		const auto px = pOffsets[x];
+		const auto rcpLen = 1.0f / sqrt(px * px + yz);
+		const auto dir = GetCubeTexcoord(face, float3(px * rcpLen, py * rcpLen, pz * rcpLen));
+		pDirs[0][x - xBegin] = dir.x;
+		pDirs[1][x - xBegin] = dir.y;
+		pDirs[2][x - xBegin] = dir.z;
+	}
+}
+
+#if defined(CPU_SIMD_X86)
+CPU_TARGET_AVX2
+static void getRowDirectionsAVX2(const float* pOffsets, float py, float pz, uint8_t face,
+	uint32_t xBegin, uint32_t xEnd, float* const pDirs[3])
+{
+	const auto& mapping = FaceMappings[face];
+	const auto one = _mm256_set1_ps(1.0f);
+	const auto yz = _mm256_set1_ps(py * py + pz * pz);
+	const auto vy = _mm256_set1_ps(py);
+	const auto vz = _mm256_set1_ps(pz);
+	const __m256 signs[] =
+	{
+		_mm256_set1_ps(mapping.Signs[0]),
+		_mm256_set1_ps(mapping.Signs[1]),
+		_mm256_set1_ps(mapping.Signs[2])
+	};
+
+	auto x = xBegin;
+	for (; x + 8 <= xEnd; x += 8)
+	{
+		const auto px = _mm256_loadu_ps(&pOffsets[x]);
+		const auto rcpLen = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(px, px), yz)));
+		const __m256 pos[] = { _mm256_mul_ps(px, rcpLen), _mm256_mul_ps(vy, rcpLen), _mm256_mul_ps(vz, rcpLen) };
+		for (uint8_t c = 0; c < 3; ++c)
+			_mm256_storeu_ps(&pDirs[c][x - xBegin], _mm256_mul_ps(signs[c], pos[mapping.Axes[c]]));
+	}
+
+	float* const pRemainder[] = { pDirs[0] + (x - xBegin), pDirs[1] + (x - xBegin), pDirs[2] + (x - xBegin) };
+	getRowDirections(pOffsets, py, pz, face, x, xEnd, pRemainder);
+}
+#endif
+
+CubeRowLUT::CubeRowLUT() :
+	m_size(0)
+{
+}
+
+CubeRowLUT::~CubeRowLUT()
+{
+}
+
+bool CubeRowLUT::Init(uint32_t size)
+{
+	if (size == 0) return false;
+	if (size == m_size) return true;
+	m_size = size;
+
+	const auto radius = size * 0.5f;
+	m_offsets.resize(size);
+	for (auto i = 0u; i < size; ++i) m_offsets[i] = i - radius + 0.5f;
+
+	const auto numRows = (size + 1) / 2;
+	m_solidAngles.resize(static_cast<size_t>(size) * numRows);
+	for (auto i = 0u; i < numRows; ++i)
+		for (auto j = 0u; j < size; ++j)
+			m_solidAngles[static_cast<size_t>(size) * i + j] = GetCubeTexelSolidAngle(j, i, size);
+
+	return true;
+}
+
+void CubeRowLUT::GetDirections(uint8_t face, uint32_t y, uint32_t xBegin, uint32_t xEnd,
+	float* const pDirs[3], ISA isa) const
+{
+	const auto py = -m_offsets[y];
+	const auto pz = m_size * 0.5f;
+
+	switch (isa)
+	{
+#if defined(CPU_SIMD_X86)
+	case ISA::AVX2:
+		getRowDirectionsAVX2(m_offsets.data(), py, pz, face, xBegin, xEnd, pDirs);
+		break;
+#endif
+	default:
+		getRowDirections(m_offsets.data(), py, pz, face, xBegin, xEnd, pDirs);
+	}
+}
+
+const float* CubeRowLUT::GetSolidAngles(uint32_t y) const
+{
+	return &m_solidAngles[static_cast<size_t>(m_size) * (min)(y, m_size - 1 - y)];
+}
+
+uint32_t CubeRowLUT::GetSize() const
+{
+	return m_size;
+}
+
+//--------------------------------------------------------------------------------------
+// Cube map
+//--------------------------------------------------------------------------------------
+
+CubeMap::CubeMap() :
+	m_size(0),
+	m_numMips(0)
+{
+}
+
+CubeMap::~CubeMap()
+{
+}
+
+bool CubeMap::Create(uint32_t size, uint8_t numMips)
+{
+	if (size == 0) return false;
+
+	auto maxMips = static_cast<uint8_t>(1);
+	while ((size >> maxMips) > 0) ++maxMips;
+	numMips = numMips ? (min)(numMips, maxMips) : maxMips;
+
+	m_size = size;
+	m_numMips = numMips;
+
+	// Level-major, then face-major planes of R, G, and B
+	size_t offset = 0;
+	m_levelOffsets.resize(numMips);
+	for (uint8_t i = 0; i < numMips; ++i)
+	{
+		const size_t levelSize = GetSize(i);
+		m_levelOffsets[i] = offset;
+		offset += levelSize * levelSize * FaceCount * ChannelCount;
+	}
+	m_data.assign(offset, 0.0f);
+
+	return true;
+}
+
+bool CubeMap::Create(const XUSG::DDS::Reader& reader, uint8_t numMips)
+{
+	if (!reader.IsCubeMap() || reader.GetWidth() != reader.GetHeight()) return false;
+
+	const auto fileMips = static_cast<uint8_t>((min)(reader.GetMipLevels(), 255u));
+	numMips = numMips ? (min)(numMips, fileMips) : fileMips;
+	if (!Create(reader.GetWidth(), numMips)) return false;
+
+	// Interleaved RGB to planes
+	vector<float> texels(static_cast<size_t>(m_size) * m_size * ChannelCount);
+	for (uint8_t i = 0; i < m_numMips; ++i)
+	{
+		const size_t numTexels = static_cast<size_t>(GetSize(i)) * GetSize(i);
+		for (uint8_t face = 0; face < FaceCount; ++face)
+		{
+			if (!reader.Decode(face, i, texels.data(), ChannelCount)) return false;
+
+			for (uint8_t c = 0; c < ChannelCount; ++c)
+			{
+				const auto pPlane = GetPlane(i, face, c);
+				for (size_t j = 0; j < numTexels; ++j) pPlane[j] = texels[ChannelCount * j + c];
+			}
+		}
+	}
+
+	return true;
+}
+
+bool CubeMap::Write(XUSG::DDS::Writer& writer, XUSG::DDS::DXGIFormat format) const
+{
+	if (!writer.Create(m_size, m_size, m_numMips, 1, format, true)) return false;
+
+	// Planes to interleaved RGB
+	vector<float> texels(static_cast<size_t>(m_size) * m_size * ChannelCount);
+	for (uint8_t i = 0; i < m_numMips; ++i)
+	{
+		const size_t numTexels = static_cast<size_t>(GetSize(i)) * GetSize(i);
+		for (uint8_t face = 0; face < FaceCount; ++face)
+		{
+			for (uint8_t c = 0; c < ChannelCount; ++c)
+			{
+				const auto pPlane = GetPlane(i, face, c);
+				for (size_t j = 0; j < numTexels; ++j) texels[ChannelCount * j + c] = pPlane[j];
+			}
+			if (!writer.Encode(face, i, texels.data(), ChannelCount)) return false;
+		}
+	}
+
+	return true;
+}
+
+float3 CubeMap::Load(uint8_t level, uint8_t face, uint32_t x, uint32_t y) const
+{
+	const auto i = static_cast<size_t>(GetSize(level)) * y + x;
+
+	return float3(GetPlane(level, face, 0)[i], GetPlane(level, face, 1)[i], GetPlane(level, face, 2)[i]);
+}
+
+void CubeMap::Store(uint8_t level, uint8_t face, uint32_t x, uint32_t y, const float3& color)
+{
+	const auto i = static_cast<size_t>(GetSize(level)) * y + x;
+	GetPlane(level, face, 0)[i] = color.x;
+	GetPlane(level, face, 1)[i] = color.y;
+	GetPlane(level, face, 2)[i] = color.z;
+}
+
+float3 CubeMap::SampleLevel(const float3& dir, uint8_t level) const
+{
+	level = (min)(level, static_cast<uint8_t>(m_numMips - 1));
+
+	return SampleBilinear(dir, GetSize(level), [&](uint8_t face, uint32_t x, uint32_t y)
+	{
+		return Load(level, face, x, y);
+	});
+}
+
+uint32_t CubeMap::GetSize(uint8_t level) const
+{
+	return (max)(m_size >> level, 1u);
+}
+
+uint8_t CubeMap::GetNumMips() const
+{
+	return m_numMips;
+}
+
+float* CubeMap::GetPlane(uint8_t level, uint8_t face, uint8_t channel)
+{
+	const size_t size = GetSize(level);
+
+	return &m_data[m_levelOffsets[level] + size * size * (ChannelCount * face + channel)];
+}
+
+const float* CubeMap::GetPlane(uint8_t level, uint8_t face, uint8_t channel) const
+{
+	const size_t size = GetSize(level);
+
+	return &m_data[m_levelOffsets[level] + size * size * (ChannelCount * face + channel)];
+}
@@ -0,0 +1,173 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "SIMD.h"
+
+namespace XUSG
+{
+	namespace DDS
+	{
+		class Reader;
+		class Writer;
+		enum DXGIFormat : uint32_t;
+	}
+}
+
+namespace CPU
+{
+	struct float3
+	{
+		float x;
+		float y;
+		float z;
+
+		float3() = default;
+		constexpr float3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	//--------------------------------------------------------------------------------------
+	// Cube-map texel addressing, mirroring CubeMap.hlsli
+	//--------------------------------------------------------------------------------------
+	float3 GetCubeTexcoord(uint8_t slice, const float3& pos);
+	float3 GetCubeTexcoord(uint32_t x, uint32_t y, uint8_t slice, uint32_t size);
+	float3 GetCubeTexcoord(uint8_t slice, float u, float v);
+
+	// Inverse of GetCubeTexcoord: returns the face and the continuous texel-space
+	// position (texel centers at i + 0.5) of a direction on a face of the given size
+	uint8_t GetCubeFace(const float3& dir, uint32_t size, float& x, float& y);
+
+	// Re-projects a texel beyond the face edges onto the adjacent face, as seamless
+	// filtering does; returns the face of the texel and updates its coordinates
+	uint8_t WrapCubeTexel(uint8_t face, uint32_t size, int32_t& x, int32_t& y);
+
+	// Solid angle subtended by texel (x, y) of a face of the given size
+	float GetCubeTexelSolidAngle(uint32_t x, uint32_t y, uint32_t size);
+
+	//--------------------------------------------------------------------------------------
+	// Texel directions and solid angles of a face size, a row at a time, for CPU baking.
+	// The face-local texel offsets, shared by the rows and the columns, and the solid
+	// angles of the upper half rows, which are the same on all faces and mirror in the
+	// lower half, are cached per size; the directions are generated with SIMD.
+	//--------------------------------------------------------------------------------------
+	class CubeRowLUT
+	{
+	public:
+		CubeRowLUT();
+		virtual ~CubeRowLUT();
+
+		// Keeps the tables when the size is unchanged
+		bool Init(uint32_t size);
+
+		// Unit directions of texels [xBegin, xEnd) of row y of a face, as x, y and z planes
+		// from xBegin: GetCubeTexcoord(x, y, face, size) divided by its length. All ISAs
+		// return the same bits, as the length is computed without FMA on any of them.
+		void GetDirections(uint8_t face, uint32_t y, uint32_t xBegin, uint32_t xEnd,
+			float* const pDirs[3], ISA isa = GetISA()) const;
+
+		// Solid angles of row y, indexed by x, as GetCubeTexelSolidAngle
+		const float* GetSolidAngles(uint32_t y) const;
+
+		uint32_t GetSize() const;
+
+		using uptr = std::unique_ptr<CubeRowLUT>;
+		using sptr = std::shared_ptr<CubeRowLUT>;
+
+	protected:
+		std::vector<float>	m_offsets;		// x - size / 2 + 0.5, as in GetCubeTexcoord
+		std::vector<float>	m_solidAngles;	// Upper half rows
+
+		uint32_t	m_size;
+	};
+
+	// Seamless bilinear filtering over faces of the given size, reading the texels through
+	// fetch(face, x, y) so that partially resolved levels can be sampled as a TextureCube
+	template<typename Fetch>
+	float3 SampleBilinear(const float3& dir, uint32_t size, const Fetch& fetch)
+	{
+		float x, y;
+		const auto face = GetCubeFace(dir, size, x, y);
+
+		// Bilinear footprint
+		x -= 0.5f;
+		y -= 0.5f;
+		const auto fx = std::floor(x);
+		const auto fy = std::floor(y);
+		const auto wx = x - fx;
+		const auto wy = y - fy;
+		const auto x0 = static_cast<int32_t>(fx);
+		const auto y0 = static_cast<int32_t>(fy);
+
+		const auto load = [&](int32_t i, int32_t j)
+		{
+			const auto f = WrapCubeTexel(face, size, i, j);
+
+			return fetch(f, static_cast<uint32_t>(i), static_cast<uint32_t>(j));
+		};
+
+		const auto c00 = load(x0, y0);
+		const auto c10 = wx > 0.0f ? load(x0 + 1, y0) : c00;
+		const auto c01 = wy > 0.0f ? load(x0, y0 + 1) : c00;
+		const auto c11 = wx > 0.0f && wy > 0.0f ? load(x0 + 1, y0 + 1) : c00;
+
+		const auto w00 = (1.0f - wx) * (1.0f - wy);
+		const auto w10 = wx * (1.0f - wy);
+		const auto w01 = (1.0f - wx) * wy;
+		const auto w11 = wx * wy;
+
+		return float3(
+			c00.x * w00 + c10.x * w10 + c01.x * w01 + c11.x * w11,
+			c00.y * w00 + c10.y * w10 + c01.y * w01 + c11.y * w11,
+			c00.z * w00 + c10.z * w10 + c01.z * w01 + c11.z * w11);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Six-face cube map with a mip chain, stored as planar RGB float faces
+	//--------------------------------------------------------------------------------------
+	class CubeMap
+	{
+	public:
+		CubeMap();
+		virtual ~CubeMap();
+
+		// numMips = 0 creates the full mip chain
+		bool Create(uint32_t size, uint8_t numMips = 1);
+
+		// Decodes the mips of a DDS cube map; numMips = 0 takes all the mips in the file
+		bool Create(const XUSG::DDS::Reader& reader, uint8_t numMips = 1);
+
+		// Encodes all the mips into a DDS cube map of an uncompressed float format
+		bool Write(XUSG::DDS::Writer& writer, XUSG::DDS::DXGIFormat format) const;
+
+		float3 Load(uint8_t level, uint8_t face, uint32_t x, uint32_t y) const;
+		void Store(uint8_t level, uint8_t face, uint32_t x, uint32_t y, const float3& color);
+
+		// Bilinear sampling with seamless filtering across face edges, as TextureCube::SampleLevel
+		float3 SampleLevel(const float3& dir, uint8_t level) const;
+
+		uint32_t GetSize(uint8_t level = 0) const;
+		uint8_t GetNumMips() const;
+
+		float* GetPlane(uint8_t level, uint8_t face, uint8_t channel);
+		const float* GetPlane(uint8_t level, uint8_t face, uint8_t channel) const;
+
+		static const uint8_t FaceCount = 6;
+		static const uint8_t ChannelCount = 3;
+
+		using uptr = std::unique_ptr<CubeMap>;
+		using sptr = std::shared_ptr<CubeMap>;
+
+	protected:
+		std::vector<float>	m_data;
+		std::vector<size_t>	m_levelOffsets;
+
+		uint32_t	m_size;
+		uint8_t		m_numMips;
+	};
+}
@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include "Halton.h"
+
+using namespace std;
+using namespace CPU;
+
+float CPU::Halton(uint32_t i, uint32_t base)
+{
+	const auto invBase = 1.0 / base;
+	auto scale = invBase;
+	auto value = 0.0;
+	for (; i > 0; i /= base)
+	{
+		value += (i % base) * scale;
+		scale *= invBase;
+	}
+
+	return static_cast<float>(value);
+}
+
+//--------------------------------------------------------------------------------------
+// Incremental Halton sequence
+//--------------------------------------------------------------------------------------
+
+HaltonSequence::HaltonSequence(uint32_t base) :
+	m_base(base < 2 ? 2 : base),
+	m_invBase(1.0 / m_base)
+{
+	Reset();
+}
+
+HaltonSequence::~HaltonSequence()
+{
+}
+
+void HaltonSequence::Reset(uint32_t i)
+{
+	memset(m_digits, 0, sizeof(m_digits));
+	m_value = 0.0;
+
+	auto scale = m_invBase;
+	for (uint8_t k = 0; i > 0 && k < MaxDigits; ++k, i /= m_base)
+	{
+		m_digits[k] = static_cast<uint8_t>(i % m_base);
+		m_value += m_digits[k] * scale;
+		scale *= m_invBase;
+	}
+}
+
+float HaltonSequence::Next()
+{
+	const auto value = static_cast<float>(m_value);
+
+	// Add one with carries: the carried digits wrap from base - 1 to 0
+	auto scale = m_invBase;
+	for (uint8_t k = 0; k < MaxDigits; ++k)
+	{
+		if (m_digits[k] + 1u < m_base)
+		{
+			++m_digits[k];
+			m_value += scale;
+			break;
+		}
+
+		m_digits[k] = 0;
+		m_value -= (m_base - 1) * scale;
+		scale *= m_invBase;
+	}
+
+	return value;
+}
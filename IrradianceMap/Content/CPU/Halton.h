@@ -0,0 +1,39 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+namespace CPU
+{
+	// Radical inverse of i in the given base
+	float Halton(uint32_t i, uint32_t base);
+
+	//--------------------------------------------------------------------------------------
+	// Incremental Halton sequence of one base, as behind XUSG::IncrementalHalton: each
+	// step adds one to the digits of the index, updating the radical inverse by the
+	// changed digits only, so that successive points cost O(1) on average
+	//--------------------------------------------------------------------------------------
+	class HaltonSequence
+	{
+	public:
+		HaltonSequence(uint32_t base = 2);
+		virtual ~HaltonSequence();
+
+		// Restarts at index i, whose point is returned by the next call to Next()
+		void Reset(uint32_t i = 0);
+
+		// Returns the point of the current index, then moves to the next index
+		float Next();
+
+		static const uint8_t MaxDigits = 32;
+
+	protected:
+		uint32_t	m_base;
+		double		m_invBase;
+		double		m_value;
+		uint8_t		m_digits[MaxDigits];
+	};
+}
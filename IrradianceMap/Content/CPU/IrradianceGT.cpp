@@ -0,0 +1,304 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "IrradianceGT.h"
+#include "BoxFilter.h"
+
+using namespace std;
+using namespace CPU;
+
+static const auto PI = 3.14159265358979323846;
+
+// Square chunks of up to ChunkSize^2 input texels
+static const auto ChunkSize = 64u;
+
+// Bands of whole rows of about BandTexels output texels
+static const auto BandTexels = 4096u;
+
+// Margin of the horizon tests against rounding
+static const auto HorizonEpsilon = 1e-5f;
+
+static void convolveChunk(const float* pTexels, uint32_t stride, const float normal[3], float irradiance[3])
+{
+	const auto pX = pTexels;
+	const auto pY = pX + stride;
+	const auto pZ = pY + stride;
+	const auto pR = pZ + stride;
+	const auto pG = pR + stride;
+	const auto pB = pG + stride;
+
+	float sums[3] = {};
+	for (auto i = 0u; i < stride; ++i)
+	{
+		const auto cosTheta = (max)(normal[0] * pX[i] + normal[1] * pY[i] + normal[2] * pZ[i], 0.0f);
+		sums[0] += cosTheta * pR[i];
+		sums[1] += cosTheta * pG[i];
+		sums[2] += cosTheta * pB[i];
+	}
+
+	for (uint8_t c = 0; c < 3; ++c) irradiance[c] = sums[c];
+}
+
+#if defined(CPU_SIMD_X86)
+CPU_TARGET_AVX2
+static float horizontalSumAVX2(__m256 v)
+{
+	const auto s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	const auto t = _mm_add_ps(s, _mm_movehl_ps(s, s));
+
+	return _mm_cvtss_f32(_mm_add_ss(t, _mm_movehdup_ps(t)));
+}
+
+CPU_TARGET_AVX2
+static void convolveChunkAVX2(const float* pTexels, uint32_t stride, const float normal[3], float irradiance[3])
+{
+	const auto pX = pTexels;
+	const auto pY = pX + stride;
+	const auto pZ = pY + stride;
+	const auto pR = pZ + stride;
+	const auto pG = pR + stride;
+	const auto pB = pG + stride;
+
+	const auto nx = _mm256_set1_ps(normal[0]);
+	const auto ny = _mm256_set1_ps(normal[1]);
+	const auto nz = _mm256_set1_ps(normal[2]);
+	const auto zero = _mm256_setzero_ps();
+
+	auto r = zero;
+	auto g = zero;
+	auto b = zero;
+	for (auto i = 0u; i < stride; i += 8)
+	{
+		auto cosTheta = _mm256_mul_ps(nz, _mm256_loadu_ps(&pZ[i]));
+		cosTheta = _mm256_fmadd_ps(ny, _mm256_loadu_ps(&pY[i]), cosTheta);
+		cosTheta = _mm256_fmadd_ps(nx, _mm256_loadu_ps(&pX[i]), cosTheta);
+		cosTheta = _mm256_max_ps(cosTheta, zero);
+
+		r = _mm256_fmadd_ps(cosTheta, _mm256_loadu_ps(&pR[i]), r);
+		g = _mm256_fmadd_ps(cosTheta, _mm256_loadu_ps(&pG[i]), g);
+		b = _mm256_fmadd_ps(cosTheta, _mm256_loadu_ps(&pB[i]), b);
+	}
+
+	irradiance[0] = horizontalSumAVX2(r);
+	irradiance[1] = horizontalSumAVX2(g);
+	irradiance[2] = horizontalSumAVX2(b);
+}
+#endif
+
+//--------------------------------------------------------------------------------------
+// Ground-truth irradiance
+//--------------------------------------------------------------------------------------
+
+IrradianceGT::IrradianceGT() :
+	m_pRadiance(nullptr),
+	m_pIrradiance(nullptr),
+	m_srcLevel(0),
+	m_isa(ISA::SCALAR)
+{
+}
+
+IrradianceGT::~IrradianceGT()
+{
+}
+
+bool IrradianceGT::Init(const Scheduler::sptr& scheduler)
+{
+	m_scheduler = scheduler;
+	if (!m_scheduler)
+	{
+		m_scheduler = make_shared<Scheduler>();
+		if (!m_scheduler->Init()) return false;
+	}
+
+	return true;
+}
+
+bool IrradianceGT::Convolve(const CubeMap& radiance, CubeMap& irradiance, uint8_t srcLevel, ISA isa)
+{
+	if (!m_scheduler || srcLevel >= radiance.GetNumMips() || irradiance.GetNumMips() == 0) return false;
+
+	m_pRadiance = &radiance;
+	m_pIrradiance = &irradiance;
+	m_srcLevel = srcLevel;
+	m_isa = isa;
+
+	// Chunks of the input, with the texel planes padded to the SIMD width
+	const auto srcSize = radiance.GetSize(srcLevel);
+	const auto chunkSize = (min)(srcSize, ChunkSize);
+	const auto chunksPerRow = (srcSize + chunkSize - 1) / chunkSize;
+	m_chunks.resize(static_cast<size_t>(chunksPerRow) * chunksPerRow * CubeMap::FaceCount);
+
+	size_t offset = 0;
+	auto k = 0u;
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto y = 0u; y < chunksPerRow; ++y)
+			for (auto x = 0u; x < chunksPerRow; ++x)
+			{
+				auto& chunk = m_chunks[k++];
+				chunk.Face = s;
+				chunk.X = chunkSize * x;
+				chunk.Y = chunkSize * y;
+				chunk.Width = (min)(chunkSize, srcSize - chunk.X);
+				chunk.Height = (min)(chunkSize, srcSize - chunk.Y);
+				chunk.Stride = (chunk.Width * chunk.Height + 7) & ~7u;
+				chunk.Offset = offset;
+				offset += chunk.Stride * 6;
+			}
+	m_texels.resize(offset);
+	m_srcRows.Init(srcSize);
+
+	m_taskGraph.Clear();
+	for (auto& chunk : m_chunks)
+	{
+		auto pChunk = &chunk;
+		m_taskGraph.AddTask([this, pChunk]() { prepareChunk(*pChunk); });
+	}
+	m_scheduler->Run(m_taskGraph);
+
+	convolveLevel(0);
+
+	// The mips are box-filtered, as those of <env>_gt.dds, unless they are not exactly half
+	// the size of the previous level
+	for (uint8_t i = 1; i < irradiance.GetNumMips(); ++i)
+		if (!BoxDownsample(irradiance, i, irradiance, i - 1, isa)) convolveLevel(i);
+
+	m_pRadiance = nullptr;
+	m_pIrradiance = nullptr;
+
+	return true;
+}
+
+void IrradianceGT::convolveLevel(uint8_t level)
+{
+	const auto size = m_pIrradiance->GetSize(level);
+	const auto rowsPerBand = (min)((max)(BandTexels / size, 1u), size);
+	m_rows.Init(size);
+
+	m_taskGraph.Clear();
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto rowBegin = 0u; rowBegin < size; rowBegin += rowsPerBand)
+		{
+			const auto rowEnd = (min)(rowBegin + rowsPerBand, size);
+			m_taskGraph.AddTask([this, level, s, rowBegin, rowEnd]() { convolveBand(level, s, rowBegin, rowEnd); });
+		}
+	m_scheduler->Run(m_taskGraph);
+}
+
+void IrradianceGT::prepareChunk(Chunk& chunk)
+{
+	const auto srcSize = m_pRadiance->GetSize(m_srcLevel);
+	const auto pX = &m_texels[chunk.Offset];
+	const auto pY = pX + chunk.Stride;
+	const auto pZ = pY + chunk.Stride;
+	float* const pWeighted[] = { pZ + chunk.Stride, pZ + chunk.Stride * 2, pZ + chunk.Stride * 3 };
+	fill(pX, pX + chunk.Stride * 6, 0.0f);
+
+	double axis[3] = {};
+	memset(chunk.Moments, 0, sizeof(chunk.Moments));
+	auto k = 0u;
+	for (auto i = 0u; i < chunk.Height; ++i)
+	{
+		const auto y = chunk.Y + i;
+		float* const pDirs[] = { pX + k, pY + k, pZ + k };
+		m_srcRows.GetDirections(chunk.Face, y, chunk.X, chunk.X + chunk.Width, pDirs, m_isa);
+
+		const auto pSolidAngles = m_srcRows.GetSolidAngles(y);
+		for (auto j = 0u; j < chunk.Width; ++j, ++k)
+		{
+			const auto x = chunk.X + j;
+			const float dir[] = { pX[k], pY[k], pZ[k] };
+			const auto weight = static_cast<float>(pSolidAngles[x] / PI);
+			const auto index = static_cast<size_t>(srcSize) * y + x;
+			for (uint8_t c = 0; c < 3; ++c)
+			{
+				pWeighted[c][k] = m_pRadiance->GetPlane(m_srcLevel, chunk.Face, c)[index] * weight;
+				for (uint8_t d = 0; d < 3; ++d) chunk.Moments[c][d] += static_cast<double>(pWeighted[c][k]) * dir[d];
+			}
+
+			for (uint8_t d = 0; d < 3; ++d) axis[d] += dir[d];
+		}
+	}
+
+	// Bounding cone around the mean direction
+	const auto axisNorm = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	chunk.Axis = float3(static_cast<float>(axis[0] / axisNorm), static_cast<float>(axis[1] / axisNorm),
+		static_cast<float>(axis[2] / axisNorm));
+
+	auto minCos = 1.0f;
+	for (auto i = 0u; i < k; ++i)
+		minCos = (min)(minCos, pX[i] * chunk.Axis.x + pY[i] * chunk.Axis.y + pZ[i] * chunk.Axis.z);
+
+	if (minCos > 0.0f)
+	{
+		// The horizon misses the cone when the angle to the axis exceeds 90 degrees plus its radius
+		const auto sinRadius = sqrt((max)(1.0f - minCos * minCos, 0.0f));
+		chunk.CullBelow = -sinRadius - HorizonEpsilon;
+		chunk.FullAbove = sinRadius + HorizonEpsilon;
+	}
+	else
+	{
+		chunk.CullBelow = -2.0f;
+		chunk.FullAbove = 2.0f;
+	}
+}
+
+void IrradianceGT::convolveBand(uint8_t level, uint8_t face, uint32_t rowBegin, uint32_t rowEnd)
+{
+	const auto size = m_pIrradiance->GetSize(level);
+	const auto numTexels = static_cast<size_t>(size) * (rowEnd - rowBegin);
+
+	// Planes of the x, y and z normals
+	vector<float> normals(numTexels * 3);
+	const float* const pNormals[] = { normals.data(), normals.data() + numTexels, normals.data() + numTexels * 2 };
+	for (auto i = rowBegin; i < rowEnd; ++i)
+	{
+		const auto offset = static_cast<size_t>(size) * (i - rowBegin);
+		float* const pDirs[] = { &normals[offset], &normals[numTexels + offset], &normals[numTexels * 2 + offset] };
+		m_rows.GetDirections(face, i, 0, size, pDirs, m_isa);
+	}
+
+	// Chunk by chunk, so that the texels of a chunk stay in cache over the band
+	vector<double> sums(numTexels * 3, 0.0);
+	for (const auto& chunk : m_chunks)
+	{
+		const auto pTexels = &m_texels[chunk.Offset];
+		for (size_t k = 0; k < numTexels; ++k)
+		{
+			const float normal[] = { pNormals[0][k], pNormals[1][k], pNormals[2][k] };
+			const auto pSums = &sums[k * 3];
+			const auto t = normal[0] * chunk.Axis.x + normal[1] * chunk.Axis.y + normal[2] * chunk.Axis.z;
+			if (t < chunk.CullBelow) continue;
+
+			if (t > chunk.FullAbove)
+			{
+				for (uint8_t c = 0; c < 3; ++c)
+					pSums[c] += chunk.Moments[c][0] * normal[0] + chunk.Moments[c][1] * normal[1] + chunk.Moments[c][2] * normal[2];
+				continue;
+			}
+
+			float irradiance[3];
+			switch (m_isa)
+			{
+#if defined(CPU_SIMD_X86)
+			case ISA::AVX2:
+				convolveChunkAVX2(pTexels, chunk.Stride, normal, irradiance);
+				break;
+#endif
+			default:
+				convolveChunk(pTexels, chunk.Stride, normal, irradiance);
+			}
+
+			for (uint8_t c = 0; c < 3; ++c) pSums[c] += irradiance[c];
+		}
+	}
+
+	for (uint8_t c = 0; c < 3; ++c)
+	{
+		const auto pPlane = m_pIrradiance->GetPlane(level, face, c) + static_cast<size_t>(size) * rowBegin;
+		for (size_t k = 0; k < numTexels; ++k) pPlane[k] = static_cast<float>(sums[k * 3 + c]);
+	}
+}
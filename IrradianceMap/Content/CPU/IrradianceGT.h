@@ -0,0 +1,77 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CubeMap.h"
+#include "Scheduler.h"
+#include "SIMD.h"
+
+namespace CPU
+{
+	//--------------------------------------------------------------------------------------
+	// Ground-truth irradiance by brute-force convolution: each output texel integrates the
+	// clamped cosine over all the texels of the radiance, weighted by their solid angles.
+	// The result is divided by PI, as stored in the irradiance maps (and <env>_gt.dds).
+	//--------------------------------------------------------------------------------------
+	class IrradianceGT
+	{
+	public:
+		IrradianceGT();
+		virtual ~IrradianceGT();
+
+		// Without a scheduler, the convolver creates one using all hardware threads
+		bool Init(const Scheduler::sptr& scheduler = nullptr);
+
+		// Convolves srcLevel of the radiance into level 0 of the irradiance, which must be
+		// created beforehand with any size; its mips are box-filtered. The input texels are
+		// grouped in fixed square chunks: the chunks below the horizon of an output texel
+		// are skipped and those entirely above it are summed through their precomputed
+		// first moments, which is exact, so only the chunks crossing the horizon are looped
+		// over. Chunks are summed in order, so the result does not depend on the number of
+		// threads.
+		bool Convolve(const CubeMap& radiance, CubeMap& irradiance, uint8_t srcLevel = 0, ISA isa = GetISA());
+
+		using uptr = std::unique_ptr<IrradianceGT>;
+		using sptr = std::shared_ptr<IrradianceGT>;
+
+	protected:
+		struct Chunk
+		{
+			float3		Axis;		// Bounding cone of the texel directions
+			float		CullBelow;	// All the texels are below the horizon if dot(n, Axis) < CullBelow
+			float		FullAbove;	// All the texels are above the horizon if dot(n, Axis) > FullAbove
+			double		Moments[3][3];	// Sums of the weighted radiance times the directions
+			size_t		Offset;
+			uint32_t	Stride;		// Texel count padded to the SIMD width
+			uint8_t		Face;
+			uint32_t	X;
+			uint32_t	Y;
+			uint32_t	Width;
+			uint32_t	Height;
+		};
+
+		void prepareChunk(Chunk& chunk);
+		void convolveLevel(uint8_t level);
+		void convolveBand(uint8_t level, uint8_t face, uint32_t rowBegin, uint32_t rowEnd);
+
+		Scheduler::sptr	m_scheduler;
+		TaskGraph		m_taskGraph;
+
+		// Per chunk, planes of the x, y and z directions, then of the R, G and B radiances
+		// weighted by the solid angles over PI
+		std::vector<Chunk>	m_chunks;
+		std::vector<float>	m_texels;
+
+		// Directions and solid angles of the input and of the convolved level
+		CubeRowLUT		m_srcRows;
+		CubeRowLUT		m_rows;
+
+		// Inputs of the running convolution
+		const CubeMap*	m_pRadiance;
+		CubeMap*		m_pIrradiance;
+		uint8_t			m_srcLevel;
+		ISA				m_isa;
+	};
+}
@@ -0,0 +1,407 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include "IrradianceMC.h"
+#include "BoxFilter.h"
+#include "Halton.h"
+
+using namespace std;
+using namespace CPU;
+
+static const auto PI = 3.14159265358979323846;
+
+// Bands of whole rows of about BandTexels output texels
+static const auto BandTexels = 1024u;
+
+// Halton bases of the sample dimensions: the row and the column of the CDF, the position
+// in the cell, and the cosine lobe
+static const uint32_t HaltonBases[] = { 2, 3, 5, 7, 11, 13 };
+static const auto NumDimensions = static_cast<uint8_t>(sizeof(HaltonBases) / sizeof(uint32_t));
+
+// Independent random rotations of the Halton points (randomized QMC), whose spread gives
+// the error estimate; the variance of single samples would overestimate the error of QMC.
+static const auto NumReplicates = 8u;
+
+static inline float getLuminance(const float3& color)
+{
+	return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+}
+
+// Integer hash for the per-texel scrambling
+static inline uint32_t hashInt(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+
+	return x;
+}
+
+// Orthonormal basis around a unit normal, after Duff et al.
+static void getTangentFrame(const float3& n, float3& t, float3& b)
+{
+	const auto sign = n.z >= 0.0f ? 1.0f : -1.0f;
+	const auto a = -1.0f / (sign + n.z);
+	const auto c = n.x * n.y * a;
+	t = float3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+	b = float3(c, sign + n.y * n.y * a, -n.y);
+}
+
+//--------------------------------------------------------------------------------------
+// Monte Carlo irradiance
+//--------------------------------------------------------------------------------------
+
+IrradianceMC::IrradianceMC() :
+	m_cdfSize(0),
+	m_cellTexels(1),
+	m_pRadiance(nullptr),
+	m_pIrradiance(nullptr),
+	m_srcLevel(0),
+	m_tolerance(0.01f),
+	m_maxSamples(4096)
+{
+}
+
+IrradianceMC::~IrradianceMC()
+{
+}
+
+bool IrradianceMC::Init(const Scheduler::sptr& scheduler)
+{
+	m_scheduler = scheduler;
+	if (!m_scheduler)
+	{
+		m_scheduler = make_shared<Scheduler>();
+		if (!m_scheduler->Init()) return false;
+	}
+
+	return true;
+}
+
+bool IrradianceMC::Convolve(const CubeMap& radiance, CubeMap& irradiance, uint8_t srcLevel,
+	float tolerance, uint32_t maxSamples)
+{
+	if (!m_scheduler || srcLevel >= radiance.GetNumMips() || irradiance.GetNumMips() == 0) return false;
+
+	m_pRadiance = &radiance;
+	m_pIrradiance = &irradiance;
+	m_srcLevel = srcLevel;
+	m_tolerance = tolerance;
+	m_maxSamples = (max)(maxSamples, BatchSize);
+
+	// Cells of power-of-two texels that evenly divide the faces
+	const auto srcSize = radiance.GetSize(srcLevel);
+	m_cellTexels = 1;
+	while (srcSize / m_cellTexels > MaxCDFSize && srcSize % (m_cellTexels * 2) == 0) m_cellTexels *= 2;
+	m_cdfSize = srcSize / m_cellTexels;
+
+	const auto numRows = m_cdfSize * CubeMap::FaceCount;
+	m_cellProbs.resize(static_cast<size_t>(numRows) * m_cdfSize);
+	m_cdf.resize(m_cellProbs.size());
+	m_rowCDF.resize(numRows);
+
+	m_taskGraph.Clear();
+	const auto rowsPerBand = (max)(BandTexels * 16 / (srcSize * m_cellTexels), 1u);
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto rowBegin = 0u; rowBegin < m_cdfSize; rowBegin += rowsPerBand)
+		{
+			const auto rowEnd = (min)(rowBegin + rowsPerBand, m_cdfSize);
+			m_taskGraph.AddTask([this, s, rowBegin, rowEnd]() { buildCDF(s, rowBegin, rowEnd); });
+		}
+	m_scheduler->Run(m_taskGraph);
+
+	// Marginal distribution of the rows, whose sums end the unnormalized conditional CDFs
+	auto sum = 0.0;
+	for (auto i = 0u; i < numRows; ++i)
+	{
+		sum += m_cdf[static_cast<size_t>(m_cdfSize) * (i + 1) - 1];
+		m_rowCDF[i] = sum;
+	}
+
+	const auto size = irradiance.GetSize();
+	m_sampleCounts.assign(static_cast<size_t>(size) * size * CubeMap::FaceCount, 0.0f);
+
+	if (sum > 0.0)
+	{
+		for (auto& prob : m_cellProbs) prob /= sum;
+		for (auto& cdf : m_rowCDF) cdf /= sum;
+		for (auto i = 0u; i < numRows; ++i)
+		{
+			const auto pCDF = &m_cdf[static_cast<size_t>(m_cdfSize) * i];
+			const auto rowSum = pCDF[m_cdfSize - 1];
+			if (rowSum > 0.0) for (auto j = 0u; j < m_cdfSize; ++j) pCDF[j] /= rowSum;
+		}
+		estimateLevel(0);
+	}
+	else
+	{
+		// No light
+		for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+			for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+				fill(irradiance.GetPlane(0, s, c), irradiance.GetPlane(0, s, c) + static_cast<size_t>(size) * size, 0.0f);
+	}
+
+	// The mips are box-filtered, as those of <env>_gt.dds, unless they are not exactly half
+	// the size of the previous level
+	for (uint8_t i = 1; i < irradiance.GetNumMips(); ++i)
+		if (!BoxDownsample(irradiance, i, irradiance, i - 1) && sum > 0.0) estimateLevel(i);
+
+	m_pRadiance = nullptr;
+	m_pIrradiance = nullptr;
+
+	return true;
+}
+
+const float* IrradianceMC::GetSampleCounts(uint8_t face) const
+{
+	const auto size = m_sampleCounts.size() / CubeMap::FaceCount;
+
+	return face < CubeMap::FaceCount && size > 0 ? &m_sampleCounts[size * face] : nullptr;
+}
+
+uint64_t IrradianceMC::GetTotalSampleCount() const
+{
+	uint64_t numSamples = 0;
+	for (const auto& count : m_sampleCounts) numSamples += static_cast<uint64_t>(count);
+
+	return numSamples;
+}
+
+void IrradianceMC::buildCDF(uint8_t face, uint32_t rowBegin, uint32_t rowEnd)
+{
+	// Mean luminance of each cell times its solid angle
+	const auto srcSize = m_pRadiance->GetSize(m_srcLevel);
+	const float* const pPlanes[] =
+	{
+		m_pRadiance->GetPlane(m_srcLevel, face, 0),
+		m_pRadiance->GetPlane(m_srcLevel, face, 1),
+		m_pRadiance->GetPlane(m_srcLevel, face, 2)
+	};
+
+	for (auto i = rowBegin; i < rowEnd; ++i)
+	{
+		const auto cell = static_cast<size_t>(m_cdfSize) * (m_cdfSize * face + i);
+		auto sum = 0.0;
+		for (auto j = 0u; j < m_cdfSize; ++j)
+		{
+			auto luminance = 0.0;
+			for (auto y = i * m_cellTexels; y < (i + 1) * m_cellTexels; ++y)
+			{
+				const auto offset = static_cast<size_t>(srcSize) * y;
+				for (auto x = j * m_cellTexels; x < (j + 1) * m_cellTexels; ++x)
+				{
+					const float3 color(pPlanes[0][offset + x], pPlanes[1][offset + x], pPlanes[2][offset + x]);
+					luminance += (max)(getLuminance(color), 0.0f);
+				}
+			}
+
+			const auto solidAngle = GetCubeTexelSolidAngle(j, i, m_cdfSize);
+			m_cellProbs[cell + j] = luminance / (m_cellTexels * m_cellTexels) * solidAngle;
+			sum += m_cellProbs[cell + j];
+			m_cdf[cell + j] = sum;
+		}
+	}
+}
+
+void IrradianceMC::estimateLevel(uint8_t level)
+{
+	const auto size = m_pIrradiance->GetSize(level);
+	const auto rowsPerBand = (min)((max)(BandTexels / size, 1u), size);
+
+	m_taskGraph.Clear();
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto rowBegin = 0u; rowBegin < size; rowBegin += rowsPerBand)
+		{
+			const auto rowEnd = (min)(rowBegin + rowsPerBand, size);
+			m_taskGraph.AddTask([this, level, s, rowBegin, rowEnd]() { estimateBand(level, s, rowBegin, rowEnd); });
+		}
+	m_scheduler->Run(m_taskGraph);
+}
+
+void IrradianceMC::estimateBand(uint8_t level, uint8_t face, uint32_t rowBegin, uint32_t rowEnd)
+{
+	const auto size = m_pIrradiance->GetSize(level);
+	float* const pPlanes[] =
+	{
+		m_pIrradiance->GetPlane(level, face, 0),
+		m_pIrradiance->GetPlane(level, face, 1),
+		m_pIrradiance->GetPlane(level, face, 2)
+	};
+
+	for (auto i = rowBegin; i < rowEnd; ++i)
+		for (auto j = 0u; j < size; ++j)
+		{
+			const auto texcoord = GetCubeTexcoord(j, i, face, size);
+			const auto norm = 1.0f / sqrt(texcoord.x * texcoord.x + texcoord.y * texcoord.y + texcoord.z * texcoord.z);
+			const float3 normal(texcoord.x * norm, texcoord.y * norm, texcoord.z * norm);
+
+			const auto index = static_cast<size_t>(size) * i + j;
+			const auto seed = hashInt(hashInt(hashInt(level) ^ face) ^ static_cast<uint32_t>(index));
+
+			uint32_t numSamples;
+			const auto irradiance = estimateTexel(normal, seed, numSamples);
+			pPlanes[0][index] = irradiance.x;
+			pPlanes[1][index] = irradiance.y;
+			pPlanes[2][index] = irradiance.z;
+
+			if (level == 0) m_sampleCounts[static_cast<size_t>(size) * size * face + index] = static_cast<float>(numSamples);
+		}
+}
+
+float3 IrradianceMC::estimateTexel(const float3& normal, uint32_t seed, uint32_t& numSamples) const
+{
+	float3 tangent, binormal;
+	getTangentFrame(normal, tangent, binormal);
+
+	// Halton points, with the random rotations (Cranley-Patterson) of the replicates per texel
+	HaltonSequence sequences[NumDimensions];
+	float offsets[NumReplicates][NumDimensions];
+	for (uint8_t k = 0; k < NumDimensions; ++k)
+	{
+		sequences[k] = HaltonSequence(HaltonBases[k]);
+		for (auto r = 0u; r < NumReplicates; ++r)
+		{
+			seed = hashInt(seed + k);
+			offsets[r][k] = (seed >> 8) * (1.0f / 16777216.0f);
+		}
+	}
+
+	double sums[NumReplicates][3] = {};
+	auto n = 0u;	// Points per replicate
+	while (n * NumReplicates < m_maxSamples)
+	{
+		for (auto b = 0u; b < BatchSize / NumReplicates; ++b, ++n)
+		{
+			float point[NumDimensions];
+			for (uint8_t k = 0; k < NumDimensions; ++k) point[k] = sequences[k].Next();
+
+			for (auto r = 0u; r < NumReplicates; ++r)
+			{
+				float u[NumDimensions];
+				for (uint8_t k = 0; k < NumDimensions; ++k)
+				{
+					u[k] = point[k] + offsets[r][k];
+					u[k] = u[k] < 1.0f ? u[k] : u[k] - 1.0f;
+				}
+
+				evaluateSample(normal, tangent, binormal, u, sums[r]);
+			}
+		}
+
+		// Standard error of the luminance from the spread of the replicate means
+		double means[NumReplicates];
+		auto mean = 0.0;
+		for (auto r = 0u; r < NumReplicates; ++r)
+		{
+			means[r] = (0.2126 * sums[r][0] + 0.7152 * sums[r][1] + 0.0722 * sums[r][2]) / n;
+			mean += means[r] / NumReplicates;
+		}
+
+		auto variance = 0.0;
+		for (auto r = 0u; r < NumReplicates; ++r) variance += (means[r] - mean) * (means[r] - mean);
+		variance /= (NumReplicates - 1) * NumReplicates;
+		if (variance <= m_tolerance * m_tolerance * mean * mean) break;
+	}
+
+	numSamples = n * NumReplicates;
+
+	double result[3] = {};
+	for (auto r = 0u; r < NumReplicates; ++r)
+		for (uint8_t c = 0; c < 3; ++c) result[c] += sums[r][c];
+
+	return float3(static_cast<float>(result[0] / numSamples), static_cast<float>(result[1] / numSamples),
+		static_cast<float>(result[2] / numSamples));
+}
+
+void IrradianceMC::evaluateSample(const float3& normal, const float3& tangent, const float3& binormal,
+	const float u[], double estimate[3]) const
+{
+	const auto srcSize = m_pRadiance->GetSize(m_srcLevel);
+	const auto invPI = 1.0 / PI;
+
+	// Luminance sample: a row from the marginal CDF, a cell from its conditional CDF, and a
+	// uniform position on the face inside the cell
+	{
+		const auto row = static_cast<uint32_t>((min)(upper_bound(m_rowCDF.cbegin(), m_rowCDF.cend(),
+			static_cast<double>(u[0])) - m_rowCDF.cbegin(), static_cast<ptrdiff_t>(m_rowCDF.size() - 1)));
+		const auto pCDF = &m_cdf[static_cast<size_t>(m_cdfSize) * row];
+		const auto cellX = static_cast<uint32_t>((min)(upper_bound(pCDF, pCDF + m_cdfSize,
+			static_cast<double>(u[1])) - pCDF, static_cast<ptrdiff_t>(m_cdfSize - 1)));
+		const auto cellY = row % m_cdfSize;
+		const auto face = static_cast<uint8_t>(row / m_cdfSize);
+		const auto x = (cellX + u[2]) * m_cellTexels;
+		const auto y = (cellY + u[3]) * m_cellTexels;
+
+		const auto pos = GetCubeTexcoord(face, x / srcSize, y / srcSize);
+		const auto dist = sqrt(static_cast<double>(pos.x) * pos.x + static_cast<double>(pos.y) * pos.y +
+			static_cast<double>(pos.z) * pos.z);
+		const auto cosTheta = (normal.x * pos.x + normal.y * pos.y + normal.z * pos.z) / dist;
+		if (cosTheta > 0.0)
+		{
+			// Density per unit area on the face, over the solid angle: dA / dw = dist^3
+			const auto cellArea = 4.0 / (static_cast<double>(m_cdfSize) * m_cdfSize);
+			const auto pdf = m_cellProbs[static_cast<size_t>(m_cdfSize) * row + cellX] / cellArea * dist * dist * dist;
+			const auto weight = cosTheta * invPI / (pdf + cosTheta * invPI);
+			const auto radiance = loadRadiance(face, x, y);
+			estimate[0] += radiance.x * weight;
+			estimate[1] += radiance.y * weight;
+			estimate[2] += radiance.z * weight;
+		}
+	}
+
+	// Cosine sample
+	{
+		const auto r = sqrt(u[4]);
+		const auto phi = static_cast<float>(2.0 * PI) * u[5];
+		const auto lx = r * cos(phi);
+		const auto ly = r * sin(phi);
+		const auto lz = sqrt((max)(1.0f - u[4], 0.0f));
+		if (lz > 0.0f)
+		{
+			const float3 dir(tangent.x * lx + binormal.x * ly + normal.x * lz,
+				tangent.y * lx + binormal.y * ly + normal.y * lz,
+				tangent.z * lx + binormal.z * ly + normal.z * lz);
+
+			float x, y;
+			const auto face = GetCubeFace(dir, srcSize, x, y);
+			const auto pdf = lz * invPI;
+			const auto weight = pdf / (getLuminancePDF(dir) + pdf);
+			const auto radiance = loadRadiance(face, x, y);
+			estimate[0] += radiance.x * weight;
+			estimate[1] += radiance.y * weight;
+			estimate[2] += radiance.z * weight;
+		}
+	}
+}
+
+float3 IrradianceMC::loadRadiance(uint8_t face, float x, float y) const
+{
+	const auto maxCoord = static_cast<int32_t>(m_pRadiance->GetSize(m_srcLevel)) - 1;
+	const auto i = (min)((max)(static_cast<int32_t>(x), 0), maxCoord);
+	const auto j = (min)((max)(static_cast<int32_t>(y), 0), maxCoord);
+
+	return m_pRadiance->Load(m_srcLevel, face, i, j);
+}
+
+double IrradianceMC::getLuminancePDF(const float3& dir) const
+{
+	float x, y;
+	const auto srcSize = m_pRadiance->GetSize(m_srcLevel);
+	const auto face = GetCubeFace(dir, srcSize, x, y);
+	const auto maxCoord = static_cast<int32_t>(m_cdfSize) - 1;
+	const auto i = (min)((max)(static_cast<int32_t>(x) / static_cast<int32_t>(m_cellTexels), 0), maxCoord);
+	const auto j = (min)((max)(static_cast<int32_t>(y) / static_cast<int32_t>(m_cellTexels), 0), maxCoord);
+	const auto cell = (static_cast<size_t>(m_cdfSize) * face + j) * m_cdfSize + i;
+
+	// Density per unit area on the face, over the solid angle: dA / dw = |dir / major axis|^3
+	const auto dist = sqrt(static_cast<double>(dir.x) * dir.x + static_cast<double>(dir.y) * dir.y +
+		static_cast<double>(dir.z) * dir.z) / (max)((max)(fabs(dir.x), fabs(dir.y)), fabs(dir.z));
+	const auto cellArea = 4.0 / (static_cast<double>(m_cdfSize) * m_cdfSize);
+
+	return m_cellProbs[cell] / cellArea * dist * dist * dist;
+}
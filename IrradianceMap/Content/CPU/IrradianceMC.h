@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CubeMap.h"
+#include "Scheduler.h"
+
+namespace CPU
+{
+	//--------------------------------------------------------------------------------------
+	// Stochastic reference irradiance for environments too large for the brute-force
+	// convolution of IrradianceGT, with the same output: irradiance divided by PI
+	//--------------------------------------------------------------------------------------
+	class IrradianceMC
+	{
+	public:
+		IrradianceMC();
+		virtual ~IrradianceMC();
+
+		// Without a scheduler, the integrator creates one using all hardware threads
+		bool Init(const Scheduler::sptr& scheduler = nullptr);
+
+		// Estimates level 0 of the irradiance from srcLevel of the radiance; the irradiance
+		// must be created beforehand with any size, and its mips are box-filtered. A sample
+		// pairs a direction drawn from the luminance CDF of the radiance with one drawn from
+		// the cosine lobe, combined by the balance heuristic, over Halton points scrambled
+		// per texel. A texel stops after the first batch of BatchSize samples at which the
+		// standard error of its luminance, estimated from independently scrambled replicates,
+		// falls below tolerance times the mean, or at maxSamples. Texels are independent, so
+		// the result does not depend on the number of threads.
+		bool Convolve(const CubeMap& radiance, CubeMap& irradiance, uint8_t srcLevel = 0,
+			float tolerance = 0.01f, uint32_t maxSamples = 4096);
+
+		// Samples taken by the texels of level 0 in the last convolution, as one plane per face
+		const float* GetSampleCounts(uint8_t face) const;
+		uint64_t GetTotalSampleCount() const;
+
+		static const uint32_t BatchSize = 128;
+
+		// The CDF is built over cells of up to MaxCDFSize^2 per face, sampled uniformly inside
+		static const uint32_t MaxCDFSize = 512;
+
+		using uptr = std::unique_ptr<IrradianceMC>;
+		using sptr = std::shared_ptr<IrradianceMC>;
+
+	protected:
+		void buildCDF(uint8_t face, uint32_t rowBegin, uint32_t rowEnd);
+		void estimateLevel(uint8_t level);
+		void estimateBand(uint8_t level, uint8_t face, uint32_t rowBegin, uint32_t rowEnd);
+		float3 estimateTexel(const float3& normal, uint32_t seed, uint32_t& numSamples) const;
+		void evaluateSample(const float3& normal, const float3& tangent, const float3& binormal,
+			const float u[], double estimate[3]) const;
+		float3 loadRadiance(uint8_t face, float x, float y) const;
+		double getLuminancePDF(const float3& dir) const;
+
+		Scheduler::sptr	m_scheduler;
+		TaskGraph		m_taskGraph;
+
+		// Probabilities of the cells, row by row of the faces, the conditional CDFs of the
+		// rows, and the marginal CDF of the rows
+		std::vector<double>	m_cellProbs;
+		std::vector<double>	m_cdf;
+		std::vector<double>	m_rowCDF;
+		uint32_t		m_cdfSize;
+		uint32_t		m_cellTexels;	// Texels per cell along each axis
+
+		std::vector<float>	m_sampleCounts;
+
+		// Inputs of the running convolution
+		const CubeMap*	m_pRadiance;
+		CubeMap*		m_pIrradiance;
+		uint8_t			m_srcLevel;
+		float			m_tolerance;
+		uint32_t		m_maxSamples;
+	};
+}
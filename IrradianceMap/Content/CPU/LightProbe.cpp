@@ -0,0 +1,534 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include "LightProbe.h"
+#include "BoxFilter.h"
+#include "MipCosine.h"
+
+using namespace std;
+using namespace CPU;
+
+// Width of the face borders that fused up sampling resolves in place before the interior;
+// the bilinear taps of a border texel, even across the face edges, stay within the coarser border.
+static const auto BorderWidth = 4u;
+
+LightProbe::LightProbe() :
+	m_upsampleMode(UPSAMPLE_PER_LEVEL),
+	m_mapSize(0.0f),
+	m_numLevels(0),
+	m_blendWeights(),
+	m_blend(0.0f),
+	m_inputProbeIdx(0)
+{
+}
+
+LightProbe::~LightProbe()
+{
+}
+
+bool LightProbe::Init(const CubeMap::sptr pSources[], uint32_t numSources,
+	UpsampleMode upsampleMode, const Scheduler::sptr& scheduler)
+{
+	if (!numSources) return false;
+
+	// Keep the input images
+	auto texSize = 1u;
+	m_sources.assign(pSources, pSources + numSources);
+	for (const auto& source : m_sources)
+	{
+		if (!source) return false;
+		texSize = (max)(source->GetSize(), texSize);
+	}
+
+	// A single level has no coarser level to up-sample from, so level 0 would never be resolved;
+	// the full chain cannot have more levels than the MipCos weights, checked before allocating.
+	if (texSize < 2 || (texSize >> MipCosineMaxLevels) > 0) return false;
+
+	// Create resources
+	m_irradiance = make_unique<CubeMap>();
+	if (!m_irradiance->Create(texSize, 0)) return false;
+
+	m_radiance = make_unique<CubeMap>();
+	if (!m_radiance->Create(texSize, 1)) return false;
+	if (!m_radianceRows.Init(texSize)) return false;
+
+	// Immutable constants
+	m_numLevels = m_irradiance->GetNumMips();
+	m_mapSize = static_cast<float>(texSize);
+	m_blendWeights = GetMipCosineWeights(m_mapSize, m_numLevels);
+
+	// Create the scheduler and the per-tile task graph
+	m_upsampleMode = upsampleMode;
+	m_scheduler = scheduler;
+	if (!m_scheduler)
+	{
+		m_scheduler = make_shared<Scheduler>();
+		if (!m_scheduler->Init()) return false;
+	}
+
+	return createTaskGraph();
+}
+
+bool LightProbe::SetSources(const CubeMap::sptr pSources[], uint32_t numSources)
+{
+	if (!numSources) return false;
+
+	// The resources and the task graph are kept, so the sources must not be larger
+	for (auto i = 0u; i < numSources; ++i)
+		if (!pSources[i] || pSources[i]->GetSize() > m_radiance->GetSize()) return false;
+
+	m_sources.assign(pSources, pSources + numSources);
+	m_inputProbeIdx %= numSources;
+
+	return true;
+}
+
+void LightProbe::UpdateFrame(double time)
+{
+	static const auto period = 3.0;
+	const auto numSources = static_cast<uint32_t>(m_sources.size());
+	auto blend = static_cast<float>(time / period);
+	m_inputProbeIdx = static_cast<uint32_t>(time / period);
+	blend = numSources > 1 ? blend - m_inputProbeIdx : 0.0f;
+	m_inputProbeIdx %= numSources;
+	m_blend = blend;
+}
+
+void LightProbe::Process()
+{
+	// Radiance, mip generation, and up sampling of every tile as soon as the tiles
+	// it reads are done, instead of a barrier after each level
+	m_scheduler->Run(m_taskGraph);
+}
+
+const CubeMap* LightProbe::GetIrradiance() const
+{
+	return m_irradiance.get();
+}
+
+const CubeMap* LightProbe::GetRadiance() const
+{
+	return m_radiance.get();
+}
+
+bool LightProbe::createTaskGraph()
+{
+	// Faces are split into bands of whole rows of about TileTexels texels; the fused
+	// bands are larger to amortize the coarser rows they resolve redundantly.
+	static const auto TileTexels = 16384u;
+	static const auto FusedTileTexels = 65536u;
+
+	m_taskGraph.Clear();
+	for (auto& bases : m_taskBases) bases.assign(m_numLevels, UINT32_MAX);
+	for (uint8_t stage = 0; stage < NUM_STAGE; ++stage)
+	{
+		auto& rowsPerTile = m_rowsPerTile[stage];
+		rowsPerTile.resize(m_numLevels);
+		for (uint8_t level = 0; level < m_numLevels; ++level)
+		{
+			const auto size = m_irradiance->GetSize(level);
+			const auto tileTexels = stage == UP_SAMPLE_FUSED ? FusedTileTexels : TileTexels;
+			rowsPerTile[level] = stage == RESOLVE_BORDER ? size : (min)((max)(tileTexels / size, 1u), size);
+		}
+	}
+
+	// Radiance
+	addTasks(RADIANCE, 0);
+
+	// Mip generation: each band reads the bands of the finer level on the same face, or
+	// the whole finer level when it is not exactly 2x (sampling across the face edges).
+	for (uint8_t level = 1; level < m_numLevels; ++level)
+	{
+		addTasks(MIP_GEN, level);
+
+		const uint8_t srcLevel = level - 1;
+		const auto srcStage = level > 1 ? MIP_GEN : RADIANCE;
+		const auto srcSize = m_irradiance->GetSize(srcLevel);
+		const auto isBox = m_irradiance->GetSize(level) * 2 == srcSize;
+		forEachTile(MIP_GEN, level, [&](uint8_t s, uint32_t rowBegin, uint32_t rowEnd)
+		{
+			const auto task = getTask(MIP_GEN, level, s, rowBegin);
+			if (isBox)
+			{
+				for (auto i = rowBegin * 2; i < rowEnd * 2; i += m_rowsPerTile[srcStage][srcLevel])
+					m_taskGraph.AddDependency(task, getTask(srcStage, srcLevel, s, i));
+			}
+			else forEachTile(srcStage, srcLevel, [&](uint8_t t, uint32_t i, uint32_t)
+			{
+				m_taskGraph.AddDependency(task, getTask(srcStage, srcLevel, t, i));
+			});
+		});
+	}
+
+	if (m_upsampleMode == UPSAMPLE_FUSED)
+	{
+		createFusedTasks();
+
+		return true;
+	}
+
+	// Up sampling from the coarsest level, where the final pass writes level 0
+	const uint8_t numPasses = m_numLevels - 1;
+	for (uint8_t i = 0; i < numPasses; ++i)
+	{
+		const uint8_t level = numPasses - i - 1;
+		addTasks(UP_SAMPLE, level);
+
+		const auto isBox = m_irradiance->GetSize(level + 1) * 2 == m_irradiance->GetSize(level);
+		forEachTile(UP_SAMPLE, level, [&](uint8_t s, uint32_t rowBegin, uint32_t rowEnd)
+		{
+			const auto task = getTask(UP_SAMPLE, level, s, rowBegin);
+
+			// The resolved coarser texels in the bilinear footprint, across the face edges
+			addFootprintDependencies(task, level, s, rowBegin, rowEnd);
+
+			// The source texels of the band itself
+			m_taskGraph.AddDependency(task, getTask(level > 0 ? MIP_GEN : RADIANCE, level, s, rowBegin));
+
+			// In place, so the band must have been read by the coarser mip generation
+			if (level > 0)
+			{
+				if (isBox)
+				{
+					for (auto j = rowBegin / 2; j < (rowEnd + 1) / 2; j += m_rowsPerTile[MIP_GEN][level + 1])
+						m_taskGraph.AddDependency(task, getTask(MIP_GEN, level + 1, s, j));
+				}
+				else forEachTile(MIP_GEN, level + 1, [&](uint8_t t, uint32_t j, uint32_t)
+				{
+					m_taskGraph.AddDependency(task, getTask(MIP_GEN, level + 1, t, j));
+				});
+			}
+		});
+	}
+
+	return true;
+}
+
+void LightProbe::createFusedTasks()
+{
+	if (m_numLevels < 2) return;
+
+	// The borders of the coarser levels are resolved in place first, from coarse to fine,
+	// as they are shared by the adjacent faces; each needs the borders of the coarser level,
+	// the mips of its face, and the coarser mip generation to have read it.
+	const uint8_t coarsest = m_numLevels - 1;
+	for (uint8_t i = 1; i < coarsest; ++i)
+	{
+		const uint8_t level = coarsest - i;
+		addTasks(RESOLVE_BORDER, level);
+
+		for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		{
+			const auto task = getTask(RESOLVE_BORDER, level, s, 0);
+			const auto coarserStage = level + 1 < coarsest ? RESOLVE_BORDER : MIP_GEN;
+			forEachTile(coarserStage, level + 1, [&](uint8_t t, uint32_t j, uint32_t)
+			{
+				m_taskGraph.AddDependency(task, getTask(coarserStage, level + 1, t, j));
+			});
+
+			for (uint8_t l = level; l <= level + 1; ++l)
+				forEachTile(MIP_GEN, l, [&](uint8_t t, uint32_t j, uint32_t)
+				{
+					if (t == s) m_taskGraph.AddDependency(task, getTask(MIP_GEN, l, t, j));
+				});
+		}
+	}
+
+	// Then the bands of level 0, each resolving its footprint at all the levels,
+	// which transitively depends on the whole mip chain
+	addTasks(UP_SAMPLE_FUSED, 0);
+
+	const auto coarserStage = coarsest > 1 ? RESOLVE_BORDER : MIP_GEN;
+	forEachTile(UP_SAMPLE_FUSED, 0, [&](uint8_t s, uint32_t rowBegin, uint32_t rowEnd)
+	{
+		const auto task = getTask(UP_SAMPLE_FUSED, 0, s, rowBegin);
+		forEachTile(coarserStage, 1, [&](uint8_t t, uint32_t j, uint32_t)
+		{
+			m_taskGraph.AddDependency(task, getTask(coarserStage, 1, t, j));
+		});
+
+		for (auto i = rowBegin; i < rowEnd; i += m_rowsPerTile[RADIANCE][0])
+			m_taskGraph.AddDependency(task, getTask(RADIANCE, 0, s, i));
+	});
+}
+
+void LightProbe::addTasks(Stage stage, uint8_t level)
+{
+	m_taskBases[stage][level] = m_taskGraph.GetNumTasks();
+
+	forEachTile(stage, level, [this, stage, level](uint8_t s, uint32_t i, uint32_t rowEnd)
+	{
+		switch (stage)
+		{
+		case RADIANCE:
+			m_taskGraph.AddTask([this, s, i, rowEnd]() { generateRadiance(s, i, rowEnd); });
+			break;
+		case MIP_GEN:
+			m_taskGraph.AddTask([this, level, s, i, rowEnd]() { generateMips(level, s, i, rowEnd); });
+			break;
+		case UP_SAMPLE:
+			m_taskGraph.AddTask([this, level, s, i, rowEnd]() { upsample(level, s, i, rowEnd); });
+			break;
+		case RESOLVE_BORDER:
+			m_taskGraph.AddTask([this, level, s]() { resolveBorder(level, s); });
+			break;
+		default:
+			m_taskGraph.AddTask([this, s, i, rowEnd]() { upsampleFused(s, i, rowEnd); });
+		}
+	});
+}
+
+void LightProbe::forEachTile(Stage stage, uint8_t level,
+	const function<void(uint8_t, uint32_t, uint32_t)>& func) const
+{
+	const auto size = m_irradiance->GetSize(level);
+	const auto rowsPerTile = m_rowsPerTile[stage][level];
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto i = 0u; i < size; i += rowsPerTile)
+			func(s, i, (min)(i + rowsPerTile, size));
+}
+
+uint32_t LightProbe::getTask(Stage stage, uint8_t level, uint8_t face, uint32_t row) const
+{
+	const auto size = m_irradiance->GetSize(level);
+	const auto rowsPerTile = m_rowsPerTile[stage][level];
+	const auto tilesPerFace = (size + rowsPerTile - 1) / rowsPerTile;
+
+	return m_taskBases[stage][level] + tilesPerFace * face + row / rowsPerTile;
+}
+
+void LightProbe::addFootprintDependencies(uint32_t task, uint8_t level, uint8_t face,
+	uint32_t rowBegin, uint32_t rowEnd)
+{
+	// The coarsest level is only mip generated
+	const uint8_t c = level + 1;
+	const auto stage = c + 1 < m_numLevels ? UP_SAMPLE : MIP_GEN;
+	const auto size = m_irradiance->GetSize(level);
+	const auto sizeC = static_cast<int32_t>(m_irradiance->GetSize(c));
+
+	// Coarser rows (and the columns beyond the edges) covered by the bilinear taps of the band
+	const auto scale = static_cast<float>(sizeC) / size;
+	const auto y0 = static_cast<int32_t>(floor((rowBegin + 0.5f) * scale - 0.5f));
+	const auto y1 = static_cast<int32_t>(floor((rowEnd - 0.5f) * scale - 0.5f)) + 1;
+
+	const auto addTexel = [&](int32_t x, int32_t y)
+	{
+		const auto t = WrapCubeTexel(face, sizeC, x, y);
+		m_taskGraph.AddDependency(task, getTask(stage, c, t, y));
+	};
+
+	for (auto y = y0; y <= y1; ++y)
+	{
+		if (y < 0 || y >= sizeC)
+			for (auto x = -1; x <= sizeC; ++x) addTexel(x, y);
+		else
+		{
+			addTexel(0, y);
+			addTexel(-1, y);
+			addTexel(sizeC, y);
+		}
+	}
+}
+
+void LightProbe::generateRadiance(uint8_t face, uint32_t rowBegin, uint32_t rowEnd)
+{
+	// The last source blends back into the first one, as the GPU SRV tables do
+	const auto numSources = static_cast<uint32_t>(m_sources.size());
+	const auto& source1 = *m_sources[m_inputProbeIdx];
+	const auto& source2 = *m_sources[(m_inputProbeIdx + 1) % numSources];
+
+	const auto size = m_radiance->GetSize();
+	if (m_blend == 0.0f && source1.GetSize() == size)
+	{
+		// Unblended sources of the same size are copied as is
+		const auto offset = static_cast<size_t>(size) * rowBegin;
+		const auto count = static_cast<size_t>(size) * (rowEnd - rowBegin);
+		for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+			copy_n(&source1.GetPlane(0, face, c)[offset], count, &m_radiance->GetPlane(0, face, c)[offset]);
+
+		return;
+	}
+
+	// Sampling directions a row at a time
+	vector<float> dirs(static_cast<size_t>(size) * 3);
+	float* const pDirs[] = { dirs.data(), dirs.data() + size, dirs.data() + size * 2 };
+	for (auto i = rowBegin; i < rowEnd; ++i)
+	{
+		m_radianceRows.GetDirections(face, i, 0, size, pDirs);
+		for (auto j = 0u; j < size; ++j)
+		{
+			const float3 dir(pDirs[0][j], pDirs[1][j], pDirs[2][j]);
+			const auto result = m_blend == 0.0f ? source1.SampleLevel(dir, 0) :
+				Lerp(source1.SampleLevel(dir, 0), source2.SampleLevel(dir, 0), m_blend);
+			m_radiance->Store(0, face, j, i, result);
+		}
+	}
+}
+
+void LightProbe::generateMips(uint8_t level, uint8_t face, uint32_t rowBegin, uint32_t rowEnd)
+{
+	// Equivalent to m_irradiance->GenerateMips() with CSBlitCube; level 0 is left
+	// to the final up-sampling pass, so the first level is blitted from the radiance.
+	const auto& source = level > 1 ? *m_irradiance : *m_radiance;
+	const uint8_t srcLevel = level > 1 ? level - 1 : 0;
+
+	// Bilinear sampling at the texel centers of an exactly 2x coarser level is a 2x2 box
+	const auto size = m_irradiance->GetSize(level);
+	const auto srcSize = source.GetSize(srcLevel);
+	if (size * 2 == srcSize)
+	{
+		for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+			BoxDownsample(m_irradiance->GetPlane(level, face, c), source.GetPlane(srcLevel, face, c),
+				srcSize, rowBegin, rowEnd);
+
+		return;
+	}
+
+	for (auto i = rowBegin; i < rowEnd; ++i)
+		for (auto j = 0u; j < size; ++j)
+		{
+			const auto dir = GetCubeTexcoord(j, i, face, size);
+			m_irradiance->Store(level, face, j, i, source.SampleLevel(dir, srcLevel));
+		}
+}
+
+void LightProbe::upsample(uint8_t level, uint8_t face, uint32_t rowBegin, uint32_t rowEnd)
+{
+	// Cosine-approximating Haar coefficients (weights of box filters)
+	const auto weight = m_blendWeights.Weights[level];
+	const uint8_t c = level + 1;
+
+	const auto size = m_irradiance->GetSize(level);
+	for (auto y = rowBegin; y < rowEnd; ++y)
+		for (auto x = 0u; x < size; ++x)
+		{
+			// Fetch the color of the current level and the resolved color at the coarser level
+			const auto dir = GetCubeTexcoord(x, y, face, size);
+			const auto coarser = m_irradiance->SampleLevel(dir, c);
+
+			// Final pass, as CSCosineUp; otherwise in-place, as CSCosUp_in_place
+			if (level > 0)
+			{
+				const auto src = m_irradiance->Load(level, face, x, y);
+				m_irradiance->Store(level, face, x, y, Lerp(coarser, src, weight));
+			}
+			else
+			{
+				const auto src = m_radiance->Load(0, face, x, y);
+				m_irradiance->Store(0, face, x, y, LerpWithBias(coarser, src, weight));
+			}
+		}
+}
+
+void LightProbe::resolveBorder(uint8_t level, uint8_t face)
+{
+	const auto weight = m_blendWeights.Weights[level];
+	const uint8_t c = level + 1;
+
+	const auto size = m_irradiance->GetSize(level);
+	for (auto y = 0u; y < size; ++y)
+		for (auto x = 0u; x < size; ++x)
+		{
+			// Skip the interior
+			if (!isBorder(level, x, y)) x = size - BorderWidth;
+
+			const auto dir = GetCubeTexcoord(x, y, face, size);
+			const auto src = m_irradiance->Load(level, face, x, y);
+			const auto coarser = m_irradiance->SampleLevel(dir, c);
+
+			m_irradiance->Store(level, face, x, y, Lerp(coarser, src, weight));
+		}
+}
+
+void LightProbe::upsampleFused(uint8_t face, uint32_t rowBegin, uint32_t rowEnd)
+{
+	// Levels up to the top one have interiors, which are resolved for the rows of the footprint
+	// of the band into a per-thread buffer; the coarser parents are then still in cache when the
+	// finer level reads them, and none of the coarser levels is written back.
+	uint8_t top = 0;
+	while (top + 1 < m_numLevels && m_irradiance->GetSize(top + 1) > BorderWidth * 2) ++top;
+
+	thread_local vector<float3> resolved;
+	thread_local vector<uint32_t> rowMins, rowMaxs;
+	thread_local vector<size_t> offsets;
+	rowMins.resize(top + 1);
+	rowMaxs.resize(top + 1);
+	offsets.resize(top + 1);
+
+	// Footprint rows of the band at each level, as addFootprintDependencies
+	rowMins[0] = rowBegin;
+	rowMaxs[0] = rowEnd - 1;
+	size_t numTexels = 0;
+	for (uint8_t level = 1; level <= top; ++level)
+	{
+		const auto size = m_irradiance->GetSize(level);
+		const auto scale = static_cast<float>(size) / m_irradiance->GetSize(level - 1);
+		const auto y0 = static_cast<int32_t>(floor((rowMins[level - 1] + 0.5f) * scale - 0.5f));
+		const auto y1 = static_cast<int32_t>(floor((rowMaxs[level - 1] + 0.5f) * scale - 0.5f)) + 1;
+		rowMins[level] = (max)(y0, 0);
+		rowMaxs[level] = (min)(static_cast<uint32_t>(y1), size - 1);
+		offsets[level] = numTexels;
+		numTexels += static_cast<size_t>(rowMaxs[level] - rowMins[level] + 1) * size;
+	}
+	resolved.resize(numTexels);
+
+	// The borders and the levels without interiors are resolved in place
+	const auto fetch = [this, top](uint8_t level, uint8_t f, uint32_t x, uint32_t y)
+	{
+		if (level > top || isBorder(level, x, y)) return m_irradiance->Load(level, f, x, y);
+
+		const auto size = m_irradiance->GetSize(level);
+
+		return resolved[offsets[level] + static_cast<size_t>(y - rowMins[level]) * size + x];
+	};
+
+	for (uint8_t level = top; level > 0; --level)
+	{
+		const auto weight = m_blendWeights.Weights[level];
+		const uint8_t c = level + 1;
+		const auto sizeC = m_irradiance->GetSize(c);
+
+		const auto size = m_irradiance->GetSize(level);
+		for (auto y = rowMins[level]; y <= rowMaxs[level]; ++y)
+			for (auto x = 0u; x < size; ++x)
+			{
+				if (isBorder(level, x, y)) continue;
+
+				const auto dir = GetCubeTexcoord(x, y, face, size);
+				const auto src = m_irradiance->Load(level, face, x, y);
+				const auto coarser = SampleBilinear(dir, sizeC, [&](uint8_t f, uint32_t i, uint32_t j)
+				{
+					return fetch(c, f, i, j);
+				});
+
+				resolved[offsets[level] + static_cast<size_t>(y - rowMins[level]) * size + x] = Lerp(coarser, src, weight);
+			}
+	}
+
+	// Final pass, as CSCosineUp
+	const auto weight = m_blendWeights.Weights[0];
+	const auto size = m_irradiance->GetSize();
+	const auto sizeC = m_irradiance->GetSize(1);
+	for (auto y = rowBegin; y < rowEnd; ++y)
+		for (auto x = 0u; x < size; ++x)
+		{
+			const auto dir = GetCubeTexcoord(x, y, face, size);
+			const auto src = m_radiance->Load(0, face, x, y);
+			const auto coarser = SampleBilinear(dir, sizeC, [&](uint8_t f, uint32_t i, uint32_t j)
+			{
+				return fetch(1, f, i, j);
+			});
+
+			m_irradiance->Store(0, face, x, y, LerpWithBias(coarser, src, weight));
+		}
+}
+
+bool LightProbe::isBorder(uint8_t level, uint32_t x, uint32_t y) const
+{
+	const auto size = m_irradiance->GetSize(level);
+
+	return x < BorderWidth || y < BorderWidth || x + BorderWidth >= size || y + BorderWidth >= size;
+}
@@ -0,0 +1,94 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CubeMap.h"
+#include "MipCosine.h"
+#include "Scheduler.h"
+
+namespace CPU
+{
+	//--------------------------------------------------------------------------------------
+	// CPU MipCos light probe, mirroring ::LightProbe::Process without a GPU device
+	//--------------------------------------------------------------------------------------
+	class LightProbe
+	{
+	public:
+		enum UpsampleMode : uint8_t
+		{
+			UPSAMPLE_PER_LEVEL,	// Resolves every level in place, as CSCosUp_in_place
+			UPSAMPLE_FUSED		// Resolves all the levels of a tile in one sweep; only level 0 is written
+		};
+
+		LightProbe();
+		virtual ~LightProbe();
+
+		// Without a scheduler, the probe creates one using all hardware threads. The largest
+		// source must be at least 2x2 per face, so that the irradiance has a coarser level,
+		// and have no more levels than MipCosineMaxLevels.
+		bool Init(const CubeMap::sptr pSources[], uint32_t numSources,
+			UpsampleMode upsampleMode = UPSAMPLE_PER_LEVEL,
+			const Scheduler::sptr& scheduler = nullptr);
+
+		// Replaces the sources without reallocating; they cannot be larger than at Init
+		bool SetSources(const CubeMap::sptr pSources[], uint32_t numSources);
+
+		void UpdateFrame(double time);
+		void Process();
+
+		const CubeMap* GetIrradiance() const;
+		const CubeMap* GetRadiance() const;
+
+		using uptr = std::unique_ptr<LightProbe>;
+		using sptr = std::shared_ptr<LightProbe>;
+
+	protected:
+		enum Stage : uint8_t
+		{
+			RADIANCE,
+			MIP_GEN,
+			UP_SAMPLE,
+			RESOLVE_BORDER,
+			UP_SAMPLE_FUSED,
+
+			NUM_STAGE
+		};
+
+		bool createTaskGraph();
+		void createFusedTasks();
+		void addTasks(Stage stage, uint8_t level);
+		void forEachTile(Stage stage, uint8_t level,
+			const std::function<void(uint8_t, uint32_t, uint32_t)>& func) const;
+		uint32_t getTask(Stage stage, uint8_t level, uint8_t face, uint32_t row) const;
+		void addFootprintDependencies(uint32_t task, uint8_t level, uint8_t face,
+			uint32_t rowBegin, uint32_t rowEnd);
+
+		// Each task processes a band of rows [rowBegin, rowEnd) of a face at a level
+		void generateRadiance(uint8_t face, uint32_t rowBegin, uint32_t rowEnd);
+		void generateMips(uint8_t level, uint8_t face, uint32_t rowBegin, uint32_t rowEnd);
+		void upsample(uint8_t level, uint8_t face, uint32_t rowBegin, uint32_t rowEnd);
+		void resolveBorder(uint8_t level, uint8_t face);
+		void upsampleFused(uint8_t face, uint32_t rowBegin, uint32_t rowEnd);
+		bool isBorder(uint8_t level, uint32_t x, uint32_t y) const;
+
+		std::vector<CubeMap::sptr> m_sources;
+		CubeMap::uptr	m_irradiance;
+		CubeMap::uptr	m_radiance;
+		CubeRowLUT		m_radianceRows;
+
+		Scheduler::sptr	m_scheduler;
+		TaskGraph		m_taskGraph;
+		std::vector<uint32_t> m_taskBases[NUM_STAGE];
+		std::vector<uint32_t> m_rowsPerTile[NUM_STAGE];
+		UpsampleMode	m_upsampleMode;
+
+		float		m_mapSize;
+		uint8_t		m_numLevels;
+		MipCosineWeights m_blendWeights;
+
+		float		m_blend;
+		uint32_t	m_inputProbeIdx;
+	};
+}
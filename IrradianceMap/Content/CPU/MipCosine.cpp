@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include "MipCosine.h"
+
+using namespace std;
+using namespace CPU;
+
+struct MipCosineWeightTables
+{
+	MipCosineWeights Tables[MipCosineMaxLevels];
+};
+
+static constexpr MipCosineWeightTables generateTables(bool preintegrated)
+{
+	MipCosineWeightTables tables = {};
+	for (uint8_t i = 0; i < MipCosineMaxLevels; ++i)
+		tables.Tables[i] = GenerateMipCosineWeights(static_cast<float>(1u << i), i + 1, preintegrated);
+
+	return tables;
+}
+
+static constexpr MipCosineWeightTables g_boxWeightTables = generateTables(false);
+static constexpr MipCosineWeightTables g_preintegratedWeightTables = generateTables(true);
+
+MipCosineWeights CPU::GetMipCosineWeights(float mapSize, uint8_t numLevels, bool preintegrated)
+{
+	const auto size = static_cast<uint32_t>(mapSize);
+	if (size > 0 && static_cast<float>(size) == mapSize && (size & (size - 1)) == 0)
+	{
+		uint8_t log2Size = 0;
+		while ((size >> log2Size) > 1) ++log2Size;
+
+		if (log2Size + 1 == numLevels && numLevels <= MipCosineMaxLevels)
+			return (preintegrated ? g_preintegratedWeightTables : g_boxWeightTables).Tables[log2Size];
+	}
+
+	return GenerateMipCosineWeights(mapSize, numLevels, preintegrated);
+}
+
+float3 CPU::LerpWithBias(const float3& coarser, const float3& src, float weight)
+{
+	auto result = Lerp(coarser, src, weight);
+
+	// Adjustment with bias
+	result.x *= 1.3f;
+	result.y *= 1.3f;
+	result.z *= 1.3f;
+	const auto r = (result.x + result.y + result.z) / 3.0f;
+	const auto e = (min)((max)(1.0f / r, 1.0f), 1.85f);
+	result.x = pow(fabs(result.x), e);
+	result.y = pow(fabs(result.y), e);
+	result.z = pow(fabs(result.z), e);
+
+	return result;
+}
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CubeMap.h"
+
+namespace CPU
+{
+	// Must match MAX_LEVEL_COUNT in MipCosine.hlsli
+	static const uint8_t MipCosineMaxLevels = 16;
+
+	//--------------------------------------------------------------------------------------
+	// Compile-time math for the weight tables
+	//--------------------------------------------------------------------------------------
+	namespace MipCosineMath
+	{
+		static constexpr double Pi = 3.141592654;
+		static constexpr double Ln2 = 0.69314718055994531;
+
+		constexpr double Sin(double x)
+		{
+			while (x > Pi) x -= 2.0 * Pi;
+			while (x < -Pi) x += 2.0 * Pi;
+
+			auto term = x, sum = x;
+			for (auto i = 1; i < 12; ++i)
+			{
+				term *= -x * x / ((2.0 * i) * (2.0 * i + 1.0));
+				sum += term;
+			}
+
+			return sum;
+		}
+
+		constexpr double Cos(double x)
+		{
+			return Sin(x + 0.5 * Pi);
+		}
+
+		constexpr double Exp2(uint32_t n)
+		{
+			return static_cast<double>(1ull << n);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// MipCos helpers, mirroring MipCosine.hlsli
+	//--------------------------------------------------------------------------------------
+
+	// Cosine-approximating Haar coefficients (weights of box filters)
+	constexpr float MipCosineBlendWeight(float mapSize, uint8_t numLevels, uint8_t level, bool preintegrated = true)
+	{
+		using namespace MipCosineMath;
+
+		const double s = mapSize;
+		const auto a = Pi / (s * 4.0);
+
+		if (preintegrated)
+		{
+			const auto pi2 = Pi * Pi;
+			const auto pi3 = pi2 * Pi;
+			const auto s2 = s * s;
+			const auto s3 = s2 * s;
+
+			const auto sinA = Sin(Exp2(level) * a);
+			const auto cosA = Cos(Exp2(level) * a);
+			const auto numerator = Exp2(level * 3) * pi3 * sinA * Ln2;
+			const auto denormC = (128.0 * s3 - Exp2(level * 2 + 4) * s * pi2) * cosA;
+			const auto denormS = Exp2(level + 5) * s2 * Pi * sinA;
+			const auto denorminator = denormC - denormS + 64.0 * s3 * Pi;
+
+			return static_cast<float>(numerator / denorminator);
+		}
+
+		auto wsum = 0.0, weight = 0.0;
+		for (auto i = level; i < numLevels; ++i)
+		{
+			const auto w = Exp2(i * 3) * Sin(Exp2(i) * a);
+			weight = i == level ? w : weight;
+			wsum += w;
+		}
+
+		return wsum > 0.0 ? static_cast<float>(weight / wsum) : 1.0f;
+	}
+
+	// Per-level blend weights of a (mapSize, numLevels) pyramid
+	struct MipCosineWeights
+	{
+		float Weights[MipCosineMaxLevels];
+	};
+
+	constexpr MipCosineWeights GenerateMipCosineWeights(float mapSize, uint8_t numLevels, bool preintegrated = true)
+	{
+		MipCosineWeights weights = {};
+		for (uint8_t i = 0; i < numLevels && i < MipCosineMaxLevels; ++i)
+			weights.Weights[i] = MipCosineBlendWeight(mapSize, numLevels, i, preintegrated);
+
+		return weights;
+	}
+
+	// Returns the tables generated at compile time for the full mip chains of power-of-two
+	// sizes, and generates the others
+	MipCosineWeights GetMipCosineWeights(float mapSize, uint8_t numLevels, bool preintegrated = true);
+
+	float3 LerpWithBias(const float3& coarser, const float3& src, float weight);
+
+	inline float3 Lerp(const float3& a, const float3& b, float t)
+	{
+		return float3(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t);
+	}
+}
@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include "ProbeBaker.h"
+
+using namespace std;
+using namespace CPU;
+
+ProbeBaker::ProbeBaker() :
+	m_upsampleMode(LightProbe::UPSAMPLE_PER_LEVEL),
+	m_size(0)
+{
+}
+
+ProbeBaker::~ProbeBaker()
+{
+}
+
+bool ProbeBaker::Init(LightProbe::UpsampleMode upsampleMode, const Scheduler::sptr& scheduler)
+{
+	m_upsampleMode = upsampleMode;
+	m_lightProbe.reset();
+	m_size = 0;
+
+	// All the probes share the worker threads; one hardware thread is left to the loader
+	m_scheduler = scheduler;
+	if (!m_scheduler)
+	{
+		m_scheduler = make_shared<Scheduler>();
+		if (!m_scheduler->Init((max)(thread::hardware_concurrency(), 2u) - 1)) return false;
+	}
+
+	return true;
+}
+
+bool ProbeBaker::Bake(uint32_t numProbes, const Loader& loader, const Consumer& consumer)
+{
+	if (!numProbes) return true;
+	if (!m_scheduler && !Init(m_upsampleMode)) return false;
+
+	// Double-buffered sources: probe i + 1 is loaded while probe i is filtered
+	CubeMap::sptr sources[2];
+	if (!loader(0, sources[0])) return false;
+
+	// One loader thread for the whole batch, which loads a probe per request
+	mutex loadMutex;
+	condition_variable loadCV;
+	auto toLoad = 0u;
+	auto isLoading = false;
+	auto isLoaded = true;
+	auto quit = false;
+	thread loaderThread;
+	if (numProbes > 1) loaderThread = thread([&]()
+	{
+		unique_lock<mutex> lock(loadMutex);
+		while (true)
+		{
+			loadCV.wait(lock, [&]() { return isLoading || quit; });
+			if (quit) return;
+
+			lock.unlock();
+			const auto success = loader(toLoad, sources[toLoad % 2]);
+			lock.lock();
+
+			isLoaded = success;
+			isLoading = false;
+			loadCV.notify_all();
+		}
+	});
+
+	auto success = true;
+	for (auto i = 0u; i < numProbes && success; ++i)
+	{
+		if (i + 1 < numProbes)
+		{
+			lock_guard<mutex> lock(loadMutex);
+			toLoad = i + 1;
+			isLoading = true;
+			loadCV.notify_all();
+		}
+
+		success = prepare(sources[i % 2]);
+		if (success)
+		{
+			m_lightProbe->Process();
+
+			// The coarser levels of the fused mode only hold intermediate mips.
+			const auto& irradiance = *m_lightProbe->GetIrradiance();
+			success = consumer(i, irradiance, m_upsampleMode == LightProbe::UPSAMPLE_FUSED ? 1 : irradiance.GetNumMips());
+		}
+
+		// Always wait for the loader before leaving or recycling its cube
+		unique_lock<mutex> lock(loadMutex);
+		loadCV.wait(lock, [&]() { return !isLoading; });
+		success = success && isLoaded;
+	}
+
+	if (loaderThread.joinable())
+	{
+		{
+			lock_guard<mutex> lock(loadMutex);
+			quit = true;
+			loadCV.notify_all();
+		}
+		loaderThread.join();
+	}
+
+	return success;
+}
+
+bool ProbeBaker::Bake(const CubeMap::sptr pSources[], uint32_t numProbes, vector<CubeMap::uptr>& irradiances)
+{
+	irradiances.resize(numProbes);
+
+	const auto loader = [pSources](uint32_t i, CubeMap::sptr& source)
+	{
+		source = pSources[i];
+
+		return source != nullptr;
+	};
+
+	const auto consumer = [&irradiances](uint32_t i, const CubeMap& irradiance, uint8_t numLevels)
+	{
+		// Reuse the storage of the output pyramids when there is any
+		auto& dst = irradiances[i];
+		if (!dst) dst = make_unique<CubeMap>();
+		if (dst->GetSize() != irradiance.GetSize() || dst->GetNumMips() != numLevels)
+			if (!dst->Create(irradiance.GetSize(), numLevels)) return false;
+
+		for (uint8_t l = 0; l < numLevels; ++l)
+		{
+			const size_t planeSize = static_cast<size_t>(irradiance.GetSize(l)) * irradiance.GetSize(l);
+			for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+				for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+					memcpy(dst->GetPlane(l, s, c), irradiance.GetPlane(l, s, c), sizeof(float) * planeSize);
+		}
+
+		return true;
+	};
+
+	return Bake(numProbes, loader, consumer);
+}
+
+bool ProbeBaker::prepare(const CubeMap::sptr& source)
+{
+	if (!source) return false;
+
+	// The light probe, with its pyramids and task graph, is only recreated on size changes
+	if (m_lightProbe && source->GetSize() == m_size)
+	{
+		if (!m_lightProbe->SetSources(&source, 1)) return false;
+	}
+	else
+	{
+		m_lightProbe = make_unique<LightProbe>();
+		if (!m_lightProbe->Init(&source, 1, m_upsampleMode, m_scheduler)) return false;
+		m_size = source->GetSize();
+	}
+
+	m_lightProbe->UpdateFrame(0.0);
+
+	return true;
+}
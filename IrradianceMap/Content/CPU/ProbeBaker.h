@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LightProbe.h"
+
+namespace CPU
+{
+	//--------------------------------------------------------------------------------------
+	// Batched baking of many probes, reusing one light probe and its intermediate buffers
+	//--------------------------------------------------------------------------------------
+	class ProbeBaker
+	{
+	public:
+		// Provides the environment cube of probe i. It runs on the loader thread of the batch
+		// while probe i - 1 is being filtered. The cube passed in is a recycled one, which
+		// can be refilled in place if it has the right size, or replaced.
+		using Loader = std::function<bool(uint32_t i, CubeMap::sptr& source)>;
+
+		// Receives the irradiance pyramid of probe i, in place in the light probe, so it is
+		// only valid during the call. Levels 0 to numLevels - 1 are resolved; with
+		// UPSAMPLE_FUSED, that is level 0 only, and the coarser levels hold intermediates.
+		using Consumer = std::function<bool(uint32_t i, const CubeMap& irradiance, uint8_t numLevels)>;
+
+		ProbeBaker();
+		virtual ~ProbeBaker();
+
+		// Without a scheduler, the baker creates one leaving a hardware thread to the loader
+		bool Init(LightProbe::UpsampleMode upsampleMode = LightProbe::UPSAMPLE_PER_LEVEL,
+			const Scheduler::sptr& scheduler = nullptr);
+
+		bool Bake(uint32_t numProbes, const Loader& loader, const Consumer& consumer);
+
+		// Convenience for cubes already in memory; the resolved levels are copied out, into
+		// the cubes already in irradiances when they have the same size and level count
+		bool Bake(const CubeMap::sptr pSources[], uint32_t numProbes, std::vector<CubeMap::uptr>& irradiances);
+
+		using uptr = std::unique_ptr<ProbeBaker>;
+		using sptr = std::shared_ptr<ProbeBaker>;
+
+	protected:
+		bool prepare(const CubeMap::sptr& source);
+
+		LightProbe::uptr	m_lightProbe;
+		Scheduler::sptr		m_scheduler;
+		LightProbe::UpsampleMode m_upsampleMode;
+
+		uint32_t			m_size;
+	};
+}
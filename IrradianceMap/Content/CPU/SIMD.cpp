@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <atomic>
+#include "SIMD.h"
+
+#if defined(CPU_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace CPU;
+
+static ISA detectISA()
+{
+#if defined(CPU_SIMD_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return ISA::SCALAR;
+
+	// OSXSAVE, FMA and F16C, then OS support of the YMM states, then AVX2
+	__cpuid(info, 1);
+	const auto hasOSXSave = (info[2] & (1 << 27)) != 0;
+	const auto hasFMA = (info[2] & (1 << 12)) != 0;
+	const auto hasF16C = (info[2] & (1 << 29)) != 0;
+	if (!hasOSXSave || !hasFMA || !hasF16C || (_xgetbv(0) & 0x6) != 0x6) return ISA::SCALAR;
+
+	__cpuidex(info, 7, 0);
+
+	return (info[1] & (1 << 5)) ? ISA::AVX2 : ISA::SCALAR;
+#else
+	__builtin_cpu_init();
+
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c") ? ISA::AVX2 : ISA::SCALAR;
+#endif
+#elif defined(CPU_SIMD_NEON)
+	return ISA::NEON;
+#else
+	return ISA::SCALAR;
+#endif
+}
+
+// Initialized on first use, so that static initializers of other translation units
+// can dispatch kernels safely, and atomic, so that SetISA may race with workers
+static std::atomic<ISA>& getSelectedISA()
+{
+	static std::atomic<ISA> isa(GetNativeISA());
+
+	return isa;
+}
+
+ISA CPU::GetNativeISA()
+{
+	static const auto isa = detectISA();
+
+	return isa;
+}
+
+ISA CPU::GetISA()
+{
+	return getSelectedISA().load(std::memory_order_relaxed);
+}
+
+void CPU::SetISA(ISA isa)
+{
+	// Never select an instruction set that the processor cannot run
+	getSelectedISA().store(isa == ISA::SCALAR || isa == GetNativeISA() ? isa : ISA::SCALAR,
+		std::memory_order_relaxed);
+}
+
+const char* CPU::GetISAName(ISA isa)
+{
+	switch (isa)
+	{
+	case ISA::AVX2:
+		return "AVX2";
+	case ISA::NEON:
+		return "NEON";
+	default:
+		return "Scalar";
+	}
+}
@@ -0,0 +1,43 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_SIMD_X86	1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CPU_SIMD_NEON	1
+#include <arm_neon.h>
+#endif
+
+// Per-function ISA targeting, so that kernels can be dispatched at runtime
+// without building the whole project for the highest instruction set.
+#if defined(CPU_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_TARGET_AVX2	__attribute__((target("avx2,fma,f16c")))
+#else
+#define CPU_TARGET_AVX2
+#endif
+
+namespace CPU
+{
+	enum class ISA : uint8_t
+	{
+		SCALAR,
+		AVX2,
+		NEON
+	};
+
+	// The best instruction set supported by the running processor
+	ISA GetNativeISA();
+
+	// The instruction set used by the dispatched kernels, defaulting to the native one;
+	// it can be lowered (e.g. to SCALAR) for validation and benchmarking.
+	ISA GetISA();
+	void SetISA(ISA isa);
+
+	const char* GetISAName(ISA isa);
+}
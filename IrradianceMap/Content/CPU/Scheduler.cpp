@@ -0,0 +1,232 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include "Scheduler.h"
+
+using namespace std;
+using namespace CPU;
+
+//--------------------------------------------------------------------------------------
+// Task graph
+//--------------------------------------------------------------------------------------
+
+TaskGraph::TaskGraph()
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+}
+
+uint32_t TaskGraph::AddTask(const Task& task)
+{
+	m_nodes.push_back({ task, {}, 0 });
+
+	return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void TaskGraph::AddDependency(uint32_t task, uint32_t prerequisite)
+{
+	auto& successors = m_nodes[prerequisite].Successors;
+	if (find(successors.cbegin(), successors.cend(), task) != successors.cend()) return;
+
+	successors.push_back(task);
+	++m_nodes[task].NumPrerequisites;
+}
+
+void TaskGraph::Clear()
+{
+	m_nodes.clear();
+}
+
+uint32_t TaskGraph::GetNumTasks() const
+{
+	return static_cast<uint32_t>(m_nodes.size());
+}
+
+//--------------------------------------------------------------------------------------
+// Scheduler
+//--------------------------------------------------------------------------------------
+
+Scheduler::Scheduler() :
+	m_numQueued(0),
+	m_numSleeping(0),
+	m_numRemaining(0),
+	m_quit(false),
+	m_pGraph(nullptr),
+	m_pendingSize(0)
+{
+}
+
+Scheduler::~Scheduler()
+{
+	shutdown();
+}
+
+bool Scheduler::Init(uint32_t numThreads)
+{
+	shutdown();
+
+	numThreads = numThreads ? numThreads : thread::hardware_concurrency();
+	numThreads = (max)(numThreads, 1u);
+
+	m_queues.resize(numThreads);
+	for (auto& queue : m_queues) queue = make_unique<WorkQueue>();
+
+	// Worker 0 is the thread calling Run()
+	m_quit = false;
+	m_threads.reserve(numThreads - 1);
+	for (auto i = 1u; i < numThreads; ++i) m_threads.emplace_back(&Scheduler::workerLoop, this, i);
+
+	return true;
+}
+
+void Scheduler::Run(const TaskGraph& graph)
+{
+	if (m_queues.empty()) Init();
+
+	const auto numTasks = graph.GetNumTasks();
+	if (!numTasks) return;
+
+	if (m_pendingSize < numTasks)
+	{
+		m_pending = make_unique<atomic<uint32_t>[]>(numTasks);
+		m_pendingSize = numTasks;
+	}
+
+	m_pGraph = &graph;
+	for (auto i = 0u; i < numTasks; ++i) m_pending[i] = graph.m_nodes[i].NumPrerequisites;
+	m_numRemaining = numTasks;
+
+	// Seed the tasks without prerequisites round-robin
+	const auto numWorkers = static_cast<uint32_t>(m_queues.size());
+	auto worker = 0u;
+	for (auto i = 0u; i < numTasks; ++i)
+		if (!graph.m_nodes[i].NumPrerequisites)
+			push(worker++ % numWorkers, i);
+
+	while (m_numRemaining > 0)
+	{
+		uint32_t task;
+		if (tryPop(0, task))
+		{
+			execute(0, task);
+			continue;
+		}
+
+		unique_lock<mutex> lock(m_mutex);
+		++m_numSleeping;
+		m_cv.wait(lock, [this] { return m_numRemaining == 0 || m_numQueued > 0; });
+		--m_numSleeping;
+	}
+
+	m_pGraph = nullptr;
+}
+
+uint32_t Scheduler::GetNumThreads() const
+{
+	return static_cast<uint32_t>(m_queues.size());
+}
+
+void Scheduler::workerLoop(uint32_t worker)
+{
+	for (;;)
+	{
+		uint32_t task;
+		if (tryPop(worker, task))
+		{
+			execute(worker, task);
+			continue;
+		}
+
+		unique_lock<mutex> lock(m_mutex);
+		++m_numSleeping;
+		m_cv.wait(lock, [this] { return m_quit || m_numQueued > 0; });
+		--m_numSleeping;
+		if (m_quit) return;
+	}
+}
+
+void Scheduler::push(uint32_t worker, uint32_t task)
+{
+	{
+		auto& queue = *m_queues[worker];
+		lock_guard<mutex> lock(queue.Mutex);
+		queue.Tasks.push_back(task);
+	}
+
+	// Wake up a sleeping thread, if any, to run or steal the task
+	++m_numQueued;
+	if (m_numSleeping > 0)
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_cv.notify_one();
+	}
+}
+
+bool Scheduler::tryPop(uint32_t worker, uint32_t& task)
+{
+	if (m_numQueued == 0) return false;
+
+	// LIFO from the own queue keeps the just-unlocked (cache-hot) work local
+	{
+		auto& queue = *m_queues[worker];
+		lock_guard<mutex> lock(queue.Mutex);
+		if (!queue.Tasks.empty())
+		{
+			task = queue.Tasks.back();
+			queue.Tasks.pop_back();
+			--m_numQueued;
+
+			return true;
+		}
+	}
+
+	// FIFO stealing from the others
+	const auto numWorkers = static_cast<uint32_t>(m_queues.size());
+	for (auto i = 1u; i < numWorkers; ++i)
+	{
+		auto& queue = *m_queues[(worker + i) % numWorkers];
+		lock_guard<mutex> lock(queue.Mutex);
+		if (!queue.Tasks.empty())
+		{
+			task = queue.Tasks.front();
+			queue.Tasks.pop_front();
+			--m_numQueued;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Scheduler::execute(uint32_t worker, uint32_t task)
+{
+	const auto& node = m_pGraph->m_nodes[task];
+	node.Func();
+
+	for (const auto& successor : node.Successors)
+		if (m_pending[successor].fetch_sub(1) == 1) push(worker, successor);
+
+	if (m_numRemaining.fetch_sub(1) == 1)
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_cv.notify_all();
+	}
+}
+
+void Scheduler::shutdown()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_quit = true;
+		m_cv.notify_all();
+	}
+
+	for (auto& thread : m_threads) thread.join();
+	m_threads.clear();
+	m_queues.clear();
+}
@@ -0,0 +1,98 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CPU
+{
+	//--------------------------------------------------------------------------------------
+	// Task graph: tasks run once all their prerequisites have completed
+	//--------------------------------------------------------------------------------------
+	class TaskGraph
+	{
+	public:
+		using Task = std::function<void()>;
+
+		TaskGraph();
+		virtual ~TaskGraph();
+
+		uint32_t AddTask(const Task& task);
+		void AddDependency(uint32_t task, uint32_t prerequisite);
+		void Clear();
+
+		uint32_t GetNumTasks() const;
+
+	protected:
+		friend class Scheduler;
+
+		struct Node
+		{
+			Task Func;
+			std::vector<uint32_t> Successors;
+			uint32_t NumPrerequisites;
+		};
+
+		std::vector<Node> m_nodes;
+	};
+
+	//--------------------------------------------------------------------------------------
+	// Work-stealing scheduler for task graphs
+	//--------------------------------------------------------------------------------------
+	class Scheduler
+	{
+	public:
+		Scheduler();
+		virtual ~Scheduler();
+
+		// numThreads counts the calling thread; 0 uses all hardware threads
+		bool Init(uint32_t numThreads = 0);
+
+		// Blocks until every task of the graph has run; the calling thread participates.
+		// A graph can be run any number of times. Run is not reentrant, and only one thread
+		// may be in Run (or Init) at a time: a task must not run a graph on the scheduler
+		// that runs it, and the owners sharing a scheduler must run it from one thread.
+		void Run(const TaskGraph& graph);
+
+		uint32_t GetNumThreads() const;
+
+		using uptr = std::unique_ptr<Scheduler>;
+		using sptr = std::shared_ptr<Scheduler>;
+
+	protected:
+		struct WorkQueue
+		{
+			std::mutex Mutex;
+			std::deque<uint32_t> Tasks;
+		};
+
+		void workerLoop(uint32_t worker);
+		void push(uint32_t worker, uint32_t task);
+		bool tryPop(uint32_t worker, uint32_t& task);
+		void execute(uint32_t worker, uint32_t task);
+		void shutdown();
+
+		std::vector<std::thread>	m_threads;
+		std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+		std::mutex					m_mutex;
+		std::condition_variable		m_cv;
+		std::atomic<uint32_t>		m_numQueued;
+		std::atomic<uint32_t>		m_numSleeping;
+		std::atomic<uint32_t>		m_numRemaining;
+		bool						m_quit;
+
+		const TaskGraph*			m_pGraph;
+		std::unique_ptr<std::atomic<uint32_t>[]> m_pending;
+		uint32_t					m_pendingSize;
+	};
+}
@@ -0,0 +1,716 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "SphericalHarmonics.h"
+#include "Optional/XUSGDDSWriter.h"
+
+using namespace std;
+using namespace CPU;
+
+// Basis constants, as in DirectXSH
+static const float SHY00 = 0.282094791773878f;	// 1/2 * sqrt(1/PI)
+static const float SHY1 = 0.488602511902920f;	// sqrt(3/(4PI))
+static const float SHY2 = 1.092548430592079f;	// 1/2 * sqrt(15/PI)
+static const float SHY20A = 0.946174695757560f;	// 3/4 * sqrt(5/PI)
+static const float SHY20B = 0.315391565252520f;	// 1/4 * sqrt(5/PI)
+static const float SHY22 = 0.546274215296040f;	// 1/4 * sqrt(15/PI)
+static const float SHY30 = 0.373176332590115f;	// 1/4 * sqrt(7/PI)
+static const float SHY31 = 0.457045799464466f;	// 1/4 * sqrt(21/(2PI))
+static const float SHY32A = 2.890611442640554f;	// 1/2 * sqrt(105/PI)
+static const float SHY32B = 1.445305721320277f;	// 1/4 * sqrt(105/PI)
+static const float SHY33 = 0.590043589926644f;	// 1/4 * sqrt(35/(2PI))
+static const float SHY40 = 0.105785546915204f;	// 3/16 * sqrt(1/PI)
+static const float SHY41 = 0.669046543557289f;	// 3/4 * sqrt(5/(2PI))
+static const float SHY42A = 0.946174695757560f;	// 3/4 * sqrt(5/PI)
+static const float SHY42B = 0.473087347878780f;	// 3/8 * sqrt(5/PI)
+static const float SHY43 = 1.770130769779930f;	// 3/4 * sqrt(35/(2PI))
+static const float SHY44A = 2.503342941796705f;	// 3/4 * sqrt(35/PI)
+static const float SHY44B = 0.625835735449176f;	// 3/16 * sqrt(35/PI)
+
+template<uint8_t order>
+void CPU::EvaluateSHBasis(const float3& dir, float basis[order * order])
+{
+	// The Condon-Shortley phase negates the odd-m functions, which is the same as
+	// evaluating the standard real polynomials at (-x, -y, z).
+	const auto x = -dir.x;
+	const auto y = -dir.y;
+	const auto z = dir.z;
+
+	basis[0] = SHY00;
+	basis[1] = SHY1 * y;
+	basis[2] = SHY1 * z;
+	basis[3] = SHY1 * x;
+	if (order < 3) return;
+
+	const auto x2 = x * x;
+	const auto y2 = y * y;
+	const auto z2 = z * z;
+	basis[4] = SHY2 * x * y;
+	basis[5] = SHY2 * y * z;
+	basis[6] = SHY20A * z2 - SHY20B;
+	basis[7] = SHY2 * x * z;
+	basis[8] = SHY22 * (x2 - y2);
+	if (order < 4) return;
+
+	basis[9] = SHY33 * y * (3.0f * x2 - y2);
+	basis[10] = SHY32A * x * y * z;
+	basis[11] = SHY31 * y * (5.0f * z2 - 1.0f);
+	basis[12] = SHY30 * z * (5.0f * z2 - 3.0f);
+	basis[13] = SHY31 * x * (5.0f * z2 - 1.0f);
+	basis[14] = SHY32B * z * (x2 - y2);
+	basis[15] = SHY33 * x * (x2 - 3.0f * y2);
+	if (order < 5) return;
+
+	basis[16] = SHY44A * x * y * (x2 - y2);
+	basis[17] = SHY43 * y * z * (3.0f * x2 - y2);
+	basis[18] = SHY42A * x * y * (7.0f * z2 - 1.0f);
+	basis[19] = SHY41 * y * z * (7.0f * z2 - 3.0f);
+	basis[20] = SHY40 * (z2 * (35.0f * z2 - 30.0f) + 3.0f);
+	basis[21] = SHY41 * x * z * (7.0f * z2 - 3.0f);
+	basis[22] = SHY42B * (x2 - y2) * (7.0f * z2 - 1.0f);
+	basis[23] = SHY43 * x * z * (x2 - 3.0f * y2);
+	basis[24] = SHY44B * ((x2 - y2) * (x2 - y2) - 4.0f * x2 * y2);
+}
+
+// Projects a row of texels, with its directions from CubeRowLUT, into sums[coefficient * 3 + channel]
+template<uint8_t order>
+static void projectRow(const float* const pRows[3], const float* pSolidAngles, const float* const pDirs[3],
+	uint32_t xBegin, uint32_t size, float sums[])
+{
+	for (auto x = xBegin; x < size; ++x)
+	{
+		float basis[order * order];
+		EvaluateSHBasis<order>(float3(pDirs[0][x], pDirs[1][x], pDirs[2][x]), basis);
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			const auto radiance = pRows[c][x] * pSolidAngles[x];
+			for (uint8_t k = 0; k < order * order; ++k) sums[k * 3 + c] += basis[k] * radiance;
+		}
+	}
+}
+
+#if defined(CPU_SIMD_X86)
+// EvaluateSHBasis on 8 directions, given as (-x, -y, z)
+template<uint8_t order>
+CPU_TARGET_AVX2
+static inline void evaluateBasisAVX2(__m256 x, __m256 y, __m256 z, __m256 basis[])
+{
+	const auto one = _mm256_set1_ps(1.0f);
+	const auto three = _mm256_set1_ps(3.0f);
+
+	basis[0] = _mm256_set1_ps(SHY00);
+	basis[1] = _mm256_mul_ps(_mm256_set1_ps(SHY1), y);
+	basis[2] = _mm256_mul_ps(_mm256_set1_ps(SHY1), z);
+	basis[3] = _mm256_mul_ps(_mm256_set1_ps(SHY1), x);
+	if (order < 3) return;
+
+	const auto x2 = _mm256_mul_ps(x, x);
+	const auto y2 = _mm256_mul_ps(y, y);
+	const auto z2 = _mm256_mul_ps(z, z);
+	const auto xy = _mm256_mul_ps(x, y);
+	const auto yz = _mm256_mul_ps(y, z);
+	const auto xz = _mm256_mul_ps(x, z);
+	const auto x2my2 = _mm256_sub_ps(x2, y2);
+	basis[4] = _mm256_mul_ps(_mm256_set1_ps(SHY2), xy);
+	basis[5] = _mm256_mul_ps(_mm256_set1_ps(SHY2), yz);
+	basis[6] = _mm256_fmsub_ps(_mm256_set1_ps(SHY20A), z2, _mm256_set1_ps(SHY20B));
+	basis[7] = _mm256_mul_ps(_mm256_set1_ps(SHY2), xz);
+	basis[8] = _mm256_mul_ps(_mm256_set1_ps(SHY22), x2my2);
+	if (order < 4) return;
+
+	const auto x2mThreeY2 = _mm256_fnmadd_ps(three, y2, x2);
+	const auto threeX2mY2 = _mm256_fmsub_ps(three, x2, y2);
+	const auto z5m1 = _mm256_fmsub_ps(_mm256_set1_ps(5.0f), z2, one);
+	basis[9] = _mm256_mul_ps(_mm256_set1_ps(SHY33), _mm256_mul_ps(y, threeX2mY2));
+	basis[10] = _mm256_mul_ps(_mm256_set1_ps(SHY32A), _mm256_mul_ps(xy, z));
+	basis[11] = _mm256_mul_ps(_mm256_set1_ps(SHY31), _mm256_mul_ps(y, z5m1));
+	basis[12] = _mm256_mul_ps(_mm256_set1_ps(SHY30), _mm256_mul_ps(z, _mm256_fmsub_ps(_mm256_set1_ps(5.0f), z2, three)));
+	basis[13] = _mm256_mul_ps(_mm256_set1_ps(SHY31), _mm256_mul_ps(x, z5m1));
+	basis[14] = _mm256_mul_ps(_mm256_set1_ps(SHY32B), _mm256_mul_ps(z, x2my2));
+	basis[15] = _mm256_mul_ps(_mm256_set1_ps(SHY33), _mm256_mul_ps(x, x2mThreeY2));
+	if (order < 5) return;
+
+	const auto z7m1 = _mm256_fmsub_ps(_mm256_set1_ps(7.0f), z2, one);
+	const auto z7m3 = _mm256_fmsub_ps(_mm256_set1_ps(7.0f), z2, three);
+	basis[16] = _mm256_mul_ps(_mm256_set1_ps(SHY44A), _mm256_mul_ps(xy, x2my2));
+	basis[17] = _mm256_mul_ps(_mm256_set1_ps(SHY43), _mm256_mul_ps(yz, threeX2mY2));
+	basis[18] = _mm256_mul_ps(_mm256_set1_ps(SHY42A), _mm256_mul_ps(xy, z7m1));
+	basis[19] = _mm256_mul_ps(_mm256_set1_ps(SHY41), _mm256_mul_ps(yz, z7m3));
+	basis[20] = _mm256_mul_ps(_mm256_set1_ps(SHY40),
+		_mm256_fmadd_ps(z2, _mm256_fmsub_ps(_mm256_set1_ps(35.0f), z2, _mm256_set1_ps(30.0f)), three));
+	basis[21] = _mm256_mul_ps(_mm256_set1_ps(SHY41), _mm256_mul_ps(xz, z7m3));
+	basis[22] = _mm256_mul_ps(_mm256_set1_ps(SHY42B), _mm256_mul_ps(x2my2, z7m1));
+	basis[23] = _mm256_mul_ps(_mm256_set1_ps(SHY43), _mm256_mul_ps(xz, x2mThreeY2));
+	basis[24] = _mm256_mul_ps(_mm256_set1_ps(SHY44B),
+		_mm256_fmsub_ps(x2my2, x2my2, _mm256_mul_ps(_mm256_set1_ps(4.0f), _mm256_mul_ps(x2, y2))));
+}
+
+template<uint8_t order>
+CPU_TARGET_AVX2
+static void projectRowAVX2(const float* const pRows[3], const float* pSolidAngles, const float* const pDirs[3],
+	uint32_t size, float sums[])
+{
+	static const uint8_t numCoeffs = order * order;
+
+	const auto signMask = _mm256_set1_ps(-0.0f);
+
+	// 8 texels per iteration, with a sum per coefficient and channel in each lane
+	__m256 acc[numCoeffs * 3];
+	for (auto& a : acc) a = _mm256_setzero_ps();
+
+	auto x = 0u;
+	for (; x + 8 <= size; x += 8)
+	{
+		__m256 basis[numCoeffs];
+		evaluateBasisAVX2<order>(_mm256_xor_ps(_mm256_loadu_ps(&pDirs[0][x]), signMask),
+			_mm256_xor_ps(_mm256_loadu_ps(&pDirs[1][x]), signMask), _mm256_loadu_ps(&pDirs[2][x]), basis);
+
+		// Radiance weighted by the solid angles
+		const auto w = _mm256_loadu_ps(&pSolidAngles[x]);
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			const auto radiance = _mm256_mul_ps(_mm256_loadu_ps(&pRows[c][x]), w);
+			for (uint8_t k = 0; k < numCoeffs; ++k)
+				acc[k * 3 + c] = _mm256_fmadd_ps(basis[k], radiance, acc[k * 3 + c]);
+		}
+	}
+
+	// Remainder of the row, then the lanes
+	projectRow<order>(pRows, pSolidAngles, pDirs, x, size, sums);
+	for (uint8_t i = 0; i < numCoeffs * 3; ++i)
+	{
+		alignas(32) float values[8];
+		_mm256_store_ps(values, acc[i]);
+		sums[i] += ((values[0] + values[1]) + (values[2] + values[3])) + ((values[4] + values[5]) + (values[6] + values[7]));
+	}
+}
+#endif
+
+//--------------------------------------------------------------------------------------
+// Batched irradiance evaluation
+//--------------------------------------------------------------------------------------
+
+// Constants of EvaluateSHIrradiance per term. The clamped-cosine factor A_l is zero for
+// odd l > 1, so band 3 is skipped, and order 4 evaluates as order 3 on the CPU and the GPU.
+static const float IrradianceScales[] =
+{
+	0.886226925452758f,		// c4
+	1.023326707946489f,		// 2 * c2
+	1.023326707946489f,
+	1.023326707946489f,
+	0.858085530809783f,		// 2 * c1
+	0.858085530809783f,
+	0.247707956100376f,		// c3
+	0.858085530809783f,
+	0.429042765404892f,		// c1
+	-0.327686824806849f,	// c5
+	-0.231709575926411f,	// c6
+	-0.123853978050188f,	// c7
+	-0.087577987756218f,	// c8
+	-0.013847295710199f,	// c9
+	-0.087577987756218f,
+	-0.061926989025094f,	// c10
+	-0.231709575926411f,
+	-0.081921706201712f		// c11
+};
+
+static inline void storeIrradiance(float* pDst, float value)
+{
+	*pDst = value;
+}
+
+static inline void storeIrradiance(uint16_t* pDst, float value)
+{
+	*pDst = XUSG::DDS::Writer::FloatToHalf(value);
+}
+
+// Polynomials of (-x, -y, z) in EvaluateSHIrradiance
+template<uint8_t numTerms>
+static inline void evaluateIrradianceTerms(float x, float y, float z, float terms[])
+{
+	terms[0] = 1.0f;
+	terms[1] = y;
+	terms[2] = z;
+	terms[3] = x;
+	if (numTerms < 9) return;
+
+	const auto x2 = x * x;
+	const auto y2 = y * y;
+	const auto z2 = z * z;
+	terms[4] = x * y;
+	terms[5] = y * z;
+	terms[6] = 3.0f * z2 - 1.0f;
+	terms[7] = x * z;
+	terms[8] = x2 - y2;
+	if (numTerms < 18) return;
+
+	terms[9] = x * y * (x2 - y2);
+	terms[10] = y * z * (3.0f * x2 - y2);
+	terms[11] = x * y * (7.0f * z2 - 1.0f);
+	terms[12] = y * z * (7.0f * z2 - 3.0f);
+	terms[13] = z2 * (35.0f * z2 - 30.0f) + 3.0f;
+	terms[14] = x * z * (7.0f * z2 - 3.0f);
+	terms[15] = (x2 - y2) * (7.0f * z2 - 1.0f);
+	terms[16] = x * z * (x2 - 3.0f * y2);
+	terms[17] = x2 * (x2 - 3.0f * y2) - y2 * (3.0f * x2 - y2);
+}
+
+// Terms weighted by pScaled[term * 3 + channel], the scaled coefficients
+template<uint8_t numTerms, typename T>
+static void evaluateIrradiance(const float* pScaled, const float* const pNormals[3],
+	T* const pIrradiance[3], size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		float terms[numTerms];
+		evaluateIrradianceTerms<numTerms>(-pNormals[0][i], -pNormals[1][i], pNormals[2][i], terms);
+
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			auto irradiance = 0.0f;
+			for (uint8_t k = 0; k < numTerms; ++k) irradiance += pScaled[k * 3 + c] * terms[k];
+			storeIrradiance(&pIrradiance[c][i], (max)(irradiance, 0.0f));
+		}
+	}
+}
+
+#if defined(CPU_SIMD_X86)
+CPU_TARGET_AVX2
+static inline void storeIrradianceAVX2(float* pDst, __m256 value)
+{
+	_mm256_storeu_ps(pDst, value);
+}
+
+CPU_TARGET_AVX2
+static inline void storeIrradianceAVX2(uint16_t* pDst, __m256 value)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst), _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+}
+
+template<uint8_t numTerms>
+CPU_TARGET_AVX2
+static inline void evaluateIrradianceAVX2(const __m256* pScaled, __m256 x, __m256 y, __m256 z, __m256 irradiance[3])
+{
+	const auto one = _mm256_set1_ps(1.0f);
+	const auto three = _mm256_set1_ps(3.0f);
+
+	__m256 terms[numTerms];
+	terms[1] = y;
+	terms[2] = z;
+	terms[3] = x;
+	if (numTerms >= 9)
+	{
+		const auto x2 = _mm256_mul_ps(x, x);
+		const auto y2 = _mm256_mul_ps(y, y);
+		const auto z2 = _mm256_mul_ps(z, z);
+		const auto xy = _mm256_mul_ps(x, y);
+		const auto yz = _mm256_mul_ps(y, z);
+		const auto xz = _mm256_mul_ps(x, z);
+		const auto x2my2 = _mm256_sub_ps(x2, y2);
+		terms[4] = xy;
+		terms[5] = yz;
+		terms[6] = _mm256_fmsub_ps(three, z2, one);
+		terms[7] = xz;
+		terms[8] = x2my2;
+
+		if (numTerms >= 18)
+		{
+			const auto x2mThreeY2 = _mm256_fnmadd_ps(three, y2, x2);
+			const auto threeX2mY2 = _mm256_fmsub_ps(three, x2, y2);
+			const auto z7m1 = _mm256_fmsub_ps(_mm256_set1_ps(7.0f), z2, one);
+			const auto z7m3 = _mm256_fmsub_ps(_mm256_set1_ps(7.0f), z2, three);
+			terms[9] = _mm256_mul_ps(xy, x2my2);
+			terms[10] = _mm256_mul_ps(yz, threeX2mY2);
+			terms[11] = _mm256_mul_ps(xy, z7m1);
+			terms[12] = _mm256_mul_ps(yz, z7m3);
+			terms[13] = _mm256_fmadd_ps(z2, _mm256_fmsub_ps(_mm256_set1_ps(35.0f), z2, _mm256_set1_ps(30.0f)), three);
+			terms[14] = _mm256_mul_ps(xz, z7m3);
+			terms[15] = _mm256_mul_ps(x2my2, z7m1);
+			terms[16] = _mm256_mul_ps(xz, x2mThreeY2);
+			terms[17] = _mm256_fmsub_ps(x2, x2mThreeY2, _mm256_mul_ps(y2, threeX2mY2));
+		}
+	}
+
+	for (uint8_t c = 0; c < 3; ++c)
+	{
+		auto sum = pScaled[c];
+		for (uint8_t k = 1; k < numTerms; ++k) sum = _mm256_fmadd_ps(pScaled[k * 3 + c], terms[k], sum);
+		irradiance[c] = _mm256_max_ps(sum, _mm256_setzero_ps());
+	}
+}
+
+template<uint8_t numTerms, typename T>
+CPU_TARGET_AVX2
+static void evaluateIrradianceAVX2(const float* pScaled, const float* const pNormals[3],
+	T* const pIrradiance[3], size_t count)
+{
+	__m256 scaled[numTerms * 3];
+	for (uint8_t i = 0; i < numTerms * 3; ++i) scaled[i] = _mm256_set1_ps(pScaled[i]);
+
+	const auto negZero = _mm256_set1_ps(-0.0f);
+
+	// 16 normals per iteration, as 2 independent groups of 8
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256 irradiance[2][3];
+		evaluateIrradianceAVX2<numTerms>(scaled, _mm256_xor_ps(_mm256_loadu_ps(&pNormals[0][i]), negZero),
+			_mm256_xor_ps(_mm256_loadu_ps(&pNormals[1][i]), negZero), _mm256_loadu_ps(&pNormals[2][i]), irradiance[0]);
+		evaluateIrradianceAVX2<numTerms>(scaled, _mm256_xor_ps(_mm256_loadu_ps(&pNormals[0][i + 8]), negZero),
+			_mm256_xor_ps(_mm256_loadu_ps(&pNormals[1][i + 8]), negZero), _mm256_loadu_ps(&pNormals[2][i + 8]), irradiance[1]);
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			storeIrradianceAVX2(&pIrradiance[c][i], irradiance[0][c]);
+			storeIrradianceAVX2(&pIrradiance[c][i + 8], irradiance[1][c]);
+		}
+	}
+
+	// Then the remainder, padded to groups of 8
+	for (; i < count; i += 8)
+	{
+		const auto n = (min)(count - i, static_cast<size_t>(8));
+		float normals[3][8] = {};
+		for (uint8_t j = 0; j < 3; ++j) memcpy(normals[j], &pNormals[j][i], sizeof(float) * n);
+
+		__m256 irradiance[3];
+		evaluateIrradianceAVX2<numTerms>(scaled, _mm256_xor_ps(_mm256_loadu_ps(normals[0]), negZero),
+			_mm256_xor_ps(_mm256_loadu_ps(normals[1]), negZero), _mm256_loadu_ps(normals[2]), irradiance);
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			T values[8];
+			storeIrradianceAVX2(values, irradiance[c]);
+			memcpy(&pIrradiance[c][i], values, sizeof(T) * n);
+		}
+	}
+}
+#endif
+
+template<uint8_t order, typename T>
+static void evaluateSHIrradiance(const float3 coeffs[], const float* const pNormals[3],
+	T* const pIrradiance[3], size_t count, ISA isa)
+{
+	// Without band 3, as IrradianceScales
+	static const uint8_t numTerms = order > 4 ? 18 : (order > 2 ? 9 : 4);
+
+	float scaled[numTerms * 3];
+	for (uint8_t i = 0; i < numTerms; ++i)
+	{
+		const auto& coeff = coeffs[i < 9 ? i : i + 7];
+		scaled[i * 3] = IrradianceScales[i] * coeff.x;
+		scaled[i * 3 + 1] = IrradianceScales[i] * coeff.y;
+		scaled[i * 3 + 2] = IrradianceScales[i] * coeff.z;
+	}
+
+	switch (isa)
+	{
+#if defined(CPU_SIMD_X86)
+	case ISA::AVX2:
+		evaluateIrradianceAVX2<numTerms>(scaled, pNormals, pIrradiance, count);
+		break;
+#endif
+	default:
+		evaluateIrradiance<numTerms>(scaled, pNormals, pIrradiance, count);
+	}
+}
+
+template<uint8_t order>
+void CPU::EvaluateSHIrradiance(const float3 coeffs[order * order], const float* const pNormals[3],
+	float* const pIrradiance[3], size_t count, ISA isa)
+{
+	evaluateSHIrradiance<order>(coeffs, pNormals, pIrradiance, count, isa);
+}
+
+template<uint8_t order>
+void CPU::EvaluateSHIrradiance(const float3 coeffs[order * order], const float* const pNormals[3],
+	uint16_t* const pIrradiance[3], size_t count, ISA isa)
+{
+	evaluateSHIrradiance<order>(coeffs, pNormals, pIrradiance, count, isa);
+}
+
+//--------------------------------------------------------------------------------------
+// SH rotation
+//--------------------------------------------------------------------------------------
+
+// Rotation matrix of a band in the standard real basis, indexed by m and n from -l to l
+struct BandRotation
+{
+	double Elements[2 * SHMaxOrder - 1][2 * SHMaxOrder - 1];
+	int Band;
+
+	double operator()(int m, int n) const { return Elements[m + Band][n + Band]; }
+	double& operator()(int m, int n) { return Elements[m + Band][n + Band]; }
+};
+
+// Term P of the recurrence, from band 1 and the previous band
+static double rotationP(int i, int a, int b, const BandRotation& r1, const BandRotation& prev)
+{
+	const auto l = prev.Band + 1;
+	if (b == l) return r1(i, 1) * prev(a, l - 1) - r1(i, -1) * prev(a, 1 - l);
+	if (b == -l) return r1(i, 1) * prev(a, 1 - l) + r1(i, -1) * prev(a, l - 1);
+
+	return r1(i, 0) * prev(a, b);
+}
+
+static void computeBandRotation(const BandRotation& r1, const BandRotation& prev, BandRotation& r)
+{
+	const auto l = prev.Band + 1;
+	r.Band = l;
+
+	for (auto m = -l; m <= l; ++m)
+	{
+		const auto absM = abs(m);
+		const auto d = m == 0 ? 1.0 : 0.0;
+
+		for (auto n = -l; n <= l; ++n)
+		{
+			const auto denom = abs(n) == l ? 2.0 * l * (2 * l - 1) : static_cast<double>((l + n) * (l - n));
+			const auto u = sqrt((l + m) * (l - m) / denom);
+			const auto v = 0.5 * sqrt((1.0 + d) * (l + absM - 1) * (l + absM) / denom) * (1.0 - 2.0 * d);
+			const auto w = -0.5 * sqrt((l - absM - 1) * (l - absM) / denom) * (1.0 - d);
+
+			auto value = 0.0;
+			if (u != 0.0) value += u * rotationP(0, m, n, r1, prev);
+			if (v != 0.0)
+			{
+				if (m == 0) value += v * (rotationP(1, 1, n, r1, prev) + rotationP(-1, -1, n, r1, prev));
+				else if (m > 0) value += v * (rotationP(1, m - 1, n, r1, prev) * (m == 1 ? sqrt(2.0) : 1.0)
+					- (m == 1 ? 0.0 : rotationP(-1, 1 - m, n, r1, prev)));
+				else value += v * ((m == -1 ? 0.0 : rotationP(1, m + 1, n, r1, prev))
+					+ rotationP(-1, -m - 1, n, r1, prev) * (m == -1 ? sqrt(2.0) : 1.0));
+			}
+			if (w != 0.0)
+			{
+				if (m > 0) value += w * (rotationP(1, m + 1, n, r1, prev) + rotationP(-1, -m - 1, n, r1, prev));
+				else value += w * (rotationP(1, m - 1, n, r1, prev) - rotationP(-1, 1 - m, n, r1, prev));
+			}
+
+			r(m, n) = value;
+		}
+	}
+}
+
+template<uint8_t order>
+SHRotation<order>::SHRotation()
+{
+	const float identity[3][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	SetRotation(identity);
+}
+
+template<uint8_t order>
+SHRotation<order>::~SHRotation()
+{
+}
+
+template<uint8_t order>
+void SHRotation<order>::SetRotation(const float rotation[3][3])
+{
+	// Band 1 in the order of y, z and x; the basis is the standard one at (-x, -y, z),
+	// so the rotation is conjugated by diag(-1, -1, 1).
+	static const uint8_t axes[] = { 1, 2, 0 };
+	static const double signs[] = { -1.0, -1.0, 1.0 };
+
+	BandRotation r1;
+	r1.Band = 1;
+	for (auto i = 0; i < 3; ++i)
+		for (auto j = 0; j < 3; ++j)
+			r1(i - 1, j - 1) = signs[axes[i]] * signs[axes[j]] * rotation[axes[i]][axes[j]];
+
+	m_matrices[0] = 1.0f;
+	auto pMatrix = &m_matrices[1];
+	auto band = r1;
+	for (auto l = 1; l < order; ++l)
+	{
+		if (l > 1)
+		{
+			const auto prev = band;
+			computeBandRotation(r1, prev, band);
+		}
+
+		for (auto m = -l; m <= l; ++m)
+			for (auto n = -l; n <= l; ++n)
+				*pMatrix++ = static_cast<float>(band(m, n));
+	}
+}
+
+template<uint8_t order>
+void SHRotation<order>::Rotate(const float3 src[NumCoeffs], float3 dst[NumCoeffs]) const
+{
+	auto pMatrix = m_matrices;
+	for (uint8_t l = 0; l < order; ++l)
+	{
+		const auto size = 2 * l + 1;
+		const auto pSrc = &src[l * l];
+		float3 band[2 * SHMaxOrder - 1];
+		copy(pSrc, pSrc + size, band);
+
+		for (auto m = 0; m < size; ++m)
+		{
+			auto& coeff = dst[l * l + m];
+			coeff = float3(0.0f, 0.0f, 0.0f);
+			for (auto n = 0; n < size; ++n)
+			{
+				const auto weight = pMatrix[size * m + n];
+				coeff.x += weight * band[n].x;
+				coeff.y += weight * band[n].y;
+				coeff.z += weight * band[n].z;
+			}
+		}
+
+		pMatrix += size * size;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// SH projector
+//--------------------------------------------------------------------------------------
+
+template<uint8_t order>
+SHProjector<order>::SHProjector() :
+	m_size(0),
+	m_pRadiance(nullptr),
+	m_level(0),
+	m_isa(ISA::SCALAR)
+{
+}
+
+template<uint8_t order>
+SHProjector<order>::~SHProjector()
+{
+}
+
+template<uint8_t order>
+bool SHProjector<order>::Init(const Scheduler::sptr& scheduler)
+{
+	m_scheduler = scheduler;
+	if (!m_scheduler)
+	{
+		m_scheduler = make_shared<Scheduler>();
+		if (!m_scheduler->Init()) return false;
+	}
+
+	return true;
+}
+
+template<uint8_t order>
+bool SHProjector<order>::Project(const CubeMap& radiance, float3 coeffs[NumCoeffs], uint8_t level, ISA isa)
+{
+	if (!m_scheduler || level >= radiance.GetNumMips()) return false;
+
+	prepare(radiance.GetSize(level));
+
+	m_pRadiance = &radiance;
+	m_level = level;
+	m_isa = isa;
+	m_scheduler->Run(m_taskGraph);
+	m_pRadiance = nullptr;
+
+	// Reduce the bands in order
+	double sums[NumCoeffs * 3] = {};
+	const auto numBands = m_bandSums.size() / (NumCoeffs * 3);
+	for (size_t i = 0; i < numBands; ++i)
+		for (uint8_t j = 0; j < NumCoeffs * 3; ++j)
+			sums[j] += m_bandSums[NumCoeffs * 3 * i + j];
+
+	for (uint8_t k = 0; k < NumCoeffs; ++k)
+		coeffs[k] = float3(static_cast<float>(sums[k * 3]), static_cast<float>(sums[k * 3 + 1]),
+			static_cast<float>(sums[k * 3 + 2]));
+
+	return true;
+}
+
+template<uint8_t order>
+void SHProjector<order>::prepare(uint32_t size)
+{
+	if (size == m_size) return;
+	m_size = size;
+
+	m_rows.Init(size);
+
+	// Bands of whole rows of about BandTexels texels; they depend on the size only.
+	static const auto BandTexels = 16384u;
+	const auto rowsPerBand = (min)((max)(BandTexels / size, 1u), size);
+	const auto bandsPerFace = (size + rowsPerBand - 1) / rowsPerBand;
+	m_bandSums.assign(static_cast<size_t>(NumCoeffs) * 3 * bandsPerFace * CubeMap::FaceCount, 0.0);
+
+	m_taskGraph.Clear();
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+	{
+		for (auto i = 0u; i < bandsPerFace; ++i)
+		{
+			const auto rowBegin = rowsPerBand * i;
+			const auto rowEnd = (min)(rowBegin + rowsPerBand, size);
+			const auto pSums = &m_bandSums[static_cast<size_t>(NumCoeffs) * 3 * (bandsPerFace * s + i)];
+			m_taskGraph.AddTask([this, s, rowBegin, rowEnd, pSums]() { projectBand(s, rowBegin, rowEnd, pSums); });
+		}
+	}
+}
+
+template<uint8_t order>
+void SHProjector<order>::projectBand(uint8_t face, uint32_t rowBegin, uint32_t rowEnd, double* pSums) const
+{
+	const auto size = m_size;
+	fill(pSums, pSums + NumCoeffs * 3, 0.0);
+
+	vector<float> dirs(static_cast<size_t>(size) * 3);
+	float* const pDirs[] = { dirs.data(), dirs.data() + size, dirs.data() + size * 2 };
+
+	for (auto i = rowBegin; i < rowEnd; ++i)
+	{
+		const auto offset = static_cast<size_t>(size) * i;
+		const float* const pRows[] =
+		{
+			m_pRadiance->GetPlane(m_level, face, 0) + offset,
+			m_pRadiance->GetPlane(m_level, face, 1) + offset,
+			m_pRadiance->GetPlane(m_level, face, 2) + offset
+		};
+		const auto pSolidAngles = m_rows.GetSolidAngles(i);
+		m_rows.GetDirections(face, i, 0, size, pDirs, m_isa);
+
+		// Rows are summed in single precision, bands in double precision
+		float sums[NumCoeffs * 3] = {};
+		switch (m_isa)
+		{
+#if defined(CPU_SIMD_X86)
+		case ISA::AVX2:
+			projectRowAVX2<order>(pRows, pSolidAngles, pDirs, size, sums);
+			break;
+#endif
+		default:
+			projectRow<order>(pRows, pSolidAngles, pDirs, 0, size, sums);
+		}
+
+		for (uint8_t j = 0; j < NumCoeffs * 3; ++j) pSums[j] += sums[j];
+	}
+}
+
+namespace CPU
+{
+	template void EvaluateSHBasis<2>(const float3&, float[]);
+	template void EvaluateSHBasis<3>(const float3&, float[]);
+	template void EvaluateSHBasis<4>(const float3&, float[]);
+	template void EvaluateSHBasis<5>(const float3&, float[]);
+
+	template void EvaluateSHIrradiance<2>(const float3[], const float* const[], float* const[], size_t, ISA);
+	template void EvaluateSHIrradiance<3>(const float3[], const float* const[], float* const[], size_t, ISA);
+	template void EvaluateSHIrradiance<4>(const float3[], const float* const[], float* const[], size_t, ISA);
+	template void EvaluateSHIrradiance<5>(const float3[], const float* const[], float* const[], size_t, ISA);
+	template void EvaluateSHIrradiance<2>(const float3[], const float* const[], uint16_t* const[], size_t, ISA);
+	template void EvaluateSHIrradiance<3>(const float3[], const float* const[], uint16_t* const[], size_t, ISA);
+	template void EvaluateSHIrradiance<4>(const float3[], const float* const[], uint16_t* const[], size_t, ISA);
+	template void EvaluateSHIrradiance<5>(const float3[], const float* const[], uint16_t* const[], size_t, ISA);
+
+	template class SHRotation<2>;
+	template class SHRotation<3>;
+	template class SHRotation<4>;
+	template class SHRotation<5>;
+
+	template class SHProjector<2>;
+	template class SHProjector<3>;
+	template class SHProjector<4>;
+	template class SHProjector<5>;
+}
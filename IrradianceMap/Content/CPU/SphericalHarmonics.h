@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CubeMap.h"
+#include "Scheduler.h"
+#include "SIMD.h"
+
+namespace CPU
+{
+	//--------------------------------------------------------------------------------------
+	// Spherical harmonics in the basis and layout of the XUSG SH transform, as consumed by
+	// EvaluateSHIrradiance in SHIrradianceTypeless.hlsli: real SH with the Condon-Shortley
+	// phase over the cube-map directions, with coefficient l * l + l + m of band l, and one
+	// float3 (RGB) per coefficient. An order of n holds bands 0 to n - 1.
+	//--------------------------------------------------------------------------------------
+	static const uint8_t SHMinOrder = 2;
+	static const uint8_t SHMaxOrder = 5;
+
+	// Basis functions of a unit direction
+	template<uint8_t order>
+	void EvaluateSHBasis(const float3& dir, float basis[order * order]);
+
+	// Batched EvaluateSHIrradiance, with its constants and axes, for unit normals given as
+	// x, y and z planes. The clamped irradiance is written as R, G and B planes, in single
+	// or half precision; disjoint ranges of normals can be evaluated concurrently.
+	template<uint8_t order = 3>
+	void EvaluateSHIrradiance(const float3 coeffs[order * order], const float* const pNormals[3],
+		float* const pIrradiance[3], size_t count, ISA isa = GetISA());
+	template<uint8_t order = 3>
+	void EvaluateSHIrradiance(const float3 coeffs[order * order], const float* const pNormals[3],
+		uint16_t* const pIrradiance[3], size_t count, ISA isa = GetISA());
+
+	//--------------------------------------------------------------------------------------
+	// Rotation of SH coefficients with per-band matrices, built by the recurrence of Ivanic
+	// and Ruedenberg, so that rotated probes and skies need no re-projection
+	//--------------------------------------------------------------------------------------
+	template<uint8_t order = 3>
+	class SHRotation
+	{
+		static_assert(order >= SHMinOrder && order <= SHMaxOrder, "Unsupported SH order");
+
+	public:
+		SHRotation();
+		virtual ~SHRotation();
+
+		static const uint8_t NumCoeffs = order * order;
+
+		// The rotation maps direction d to rotation * d (rows by column vectors), so rotated
+		// coefficients represent f(inverse(rotation) * d); it must be orthonormal.
+		void SetRotation(const float rotation[3][3]);
+
+		// Source and destination can be the same.
+		void Rotate(const float3 src[NumCoeffs], float3 dst[NumCoeffs]) const;
+
+		using uptr = std::unique_ptr<SHRotation>;
+		using sptr = std::shared_ptr<SHRotation>;
+
+	protected:
+		// Band l is a (2l + 1) x (2l + 1) matrix, after those of the lower bands
+		float m_matrices[order * (2 * order - 1) * (2 * order + 1) / 3];
+	};
+
+	//--------------------------------------------------------------------------------------
+	// SH projection of cube maps on the CPU, replacing XUSG::SphericalHarmonics::Transform;
+	// instantiated for orders SHMinOrder to SHMaxOrder
+	//--------------------------------------------------------------------------------------
+	template<uint8_t order = 3>
+	class SHProjector
+	{
+		static_assert(order >= SHMinOrder && order <= SHMaxOrder, "Unsupported SH order");
+
+	public:
+		SHProjector();
+		virtual ~SHProjector();
+
+		static const uint8_t NumCoeffs = order * order;
+
+		// Without a scheduler, the projector creates one using all hardware threads
+		bool Init(const Scheduler::sptr& scheduler = nullptr);
+
+		// Projects a level of the cube map with each texel weighted by its solid angle.
+		// The faces are split into fixed bands of rows, whose sums are reduced in order,
+		// so the result does not depend on the number of threads.
+		bool Project(const CubeMap& radiance, float3 coeffs[NumCoeffs], uint8_t level = 0, ISA isa = GetISA());
+
+		using uptr = std::unique_ptr<SHProjector>;
+		using sptr = std::shared_ptr<SHProjector>;
+
+	protected:
+		void prepare(uint32_t size);
+		void projectBand(uint8_t face, uint32_t rowBegin, uint32_t rowEnd, double* pSums) const;
+
+		Scheduler::sptr	m_scheduler;
+		TaskGraph		m_taskGraph;
+
+		CubeRowLUT			m_rows;
+		std::vector<double>	m_bandSums;
+
+		uint32_t		m_size;
+
+		// Inputs of the running projection
+		const CubeMap*	m_pRadiance;
+		uint8_t			m_level;
+		ISA				m_isa;
+	};
+}
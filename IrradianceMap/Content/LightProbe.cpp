@@ -3,6 +3,7 @@
 //--------------------------------------------------------------------------------------
 
 #include "LightProbe.h"
+#include "CPU/MipCosine.h"
 
 using namespace std;
 using namespace DirectX;
@@ -12,10 +13,14 @@ struct CBImmutable
 {
 	float		MapSize;
 	uint32_t	NumLevels;
+	uint32_t	Padding[2];
+	float		BlendWeights[CPU::MipCosineMaxLevels];
+	float		PreintBlendWeights[CPU::MipCosineMaxLevels];
 };
 
 LightProbe::LightProbe() :
-	m_groundTruth(nullptr)
+	m_groundTruth(nullptr),
+	m_shOrder(3)
 {
 	m_shaderLib = ShaderLib::MakeShared();
 }
@@ -25,13 +30,15 @@ LightProbe::~LightProbe()
 }
 
 bool LightProbe::Init(CommandList* pCommandList, const DescriptorTableLib::sptr& descriptorTableLib,
-	vector<Resource::uptr>& uploaders, const wstring pFileNames[], uint32_t numFiles, bool typedUAV)
+	vector<Resource::uptr>& uploaders, const wstring pFileNames[], uint32_t numFiles, bool typedUAV,
+	uint8_t shOrder)
 {
 	const auto pDevice = pCommandList->GetDevice();
 	m_graphicsPipelineLib = Graphics::PipelineLib::MakeUnique(pDevice);
 	m_computePipelineLib = Compute::PipelineLib::MakeShared(pDevice);
 	m_pipelineLayoutLib = PipelineLayoutLib::MakeShared(pDevice);
 	m_descriptorTableLib = descriptorTableLib;
+	m_shOrder = shOrder;
 
 	// Load input image
 	auto texWidth = 1u, texHeight = 1u;
@@ -62,9 +69,16 @@ bool LightProbe::Init(CommandList* pCommandList, const DescriptorTableLib::sptr&
 		MemoryFlag::NONE, L"Radiance"), false);
 
 	// Create constant buffers
-	CBImmutable cb;
+	CBImmutable cb = {};
 	cb.NumLevels = m_irradiance->GetNumMips();
 	cb.MapSize = (texWidth + texHeight) * 0.5f;
+	if (cb.NumLevels > CPU::MipCosineMaxLevels) return false;
+
+	const auto numLevels = static_cast<uint8_t>(cb.NumLevels);
+	const auto boxWeights = CPU::GetMipCosineWeights(cb.MapSize, numLevels, false);
+	const auto preintWeights = CPU::GetMipCosineWeights(cb.MapSize, numLevels, true);
+	memcpy(cb.BlendWeights, boxWeights.Weights, sizeof(cb.BlendWeights));
+	memcpy(cb.PreintBlendWeights, preintWeights.Weights, sizeof(cb.PreintBlendWeights));
 
 	m_cbImmutable = ConstantBuffer::MakeUnique();
 	XUSG_N_RETURN(m_cbImmutable->Create(pDevice, sizeof(CBImmutable), 1,
@@ -127,7 +141,7 @@ void LightProbe::Process(CommandList* pCommandList, uint8_t frameIndex, Pipeline
 	case SH:
 	{
 		generateRadianceCompute(pCommandList, frameIndex);
-		m_sphericalHarmonics->Transform(pCommandList, m_radiance.get(), m_srvTables[TABLE_BLIT][0]);
+		m_sphericalHarmonics->Transform(pCommandList, m_radiance.get(), m_srvTables[TABLE_BLIT][0], m_shOrder);
 		break;
 	}
 	default:
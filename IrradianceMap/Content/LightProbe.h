@@ -24,7 +24,7 @@ public:
 
 	bool Init(XUSG::CommandList* pCommandList, const XUSG::DescriptorTableLib::sptr& descriptorTableLib,
 		std::vector<XUSG::Resource::uptr>& uploaders, const std::wstring pFileNames[],
-		uint32_t numFiles, bool typedUAV);
+		uint32_t numFiles, bool typedUAV, uint8_t shOrder = 3);
 	bool CreateDescriptorTables(XUSG::Device* pDevice);
 
 	void UpdateFrame(double time, uint8_t frameIndex);
@@ -107,4 +107,5 @@ protected:
 	XUSG::ConstantBuffer::uptr	m_cbPerFrame;
 
 	uint32_t				m_inputProbeIdx;
+	uint8_t					m_shOrder;
 };
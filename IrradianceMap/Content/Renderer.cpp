@@ -4,7 +4,6 @@
 
 #include "Renderer.h"
 #include "Advanced/XUSGAdvanced.h"
-#include "Optional/XUSGObjLoader.h"
 
 using namespace std;
 using namespace DirectX;
@@ -16,6 +15,9 @@ struct CBBasePass
 	XMFLOAT4X4	WorldViewProjPrev;
 	XMFLOAT3X4	World;
 	XMFLOAT2	ProjBias;
+	XMFLOAT2	Padding;
+	XMFLOAT4	PosScale;
+	XMFLOAT4	PosBias;
 };
 
 struct CBPerFrame
@@ -25,7 +27,11 @@ struct CBPerFrame
 };
 
 Renderer::Renderer() :
-	m_frameParity(0)
+	m_frameParity(0),
+	m_shOrder(3),
+	m_vertexFormat(VERTEX_FLOAT),
+	m_dequantScale(1.0f, 1.0f, 1.0f),
+	m_dequantBias(0.0f, 0.0f, 0.0f)
 {
 	m_shaderLib = ShaderLib::MakeUnique();
 }
@@ -35,7 +41,8 @@ Renderer::~Renderer()
 }
 
 bool Renderer::Init(CommandList* pCommandList, const DescriptorTableLib::sptr& descriptorTableLib,
-	vector<Resource::uptr>& uploaders, const char* fileName, Format rtFormat, const XMFLOAT4& posScale)
+	vector<Resource::uptr>& uploaders, const char* fileName, Format rtFormat, const XMFLOAT4& posScale,
+	VertexFormat vertexFormat, uint8_t shOrder)
 {
 	const auto pDevice = pCommandList->GetDevice();
 	m_graphicsPipelineLib = Graphics::PipelineLib::MakeUnique(pDevice);
@@ -44,11 +51,60 @@ bool Renderer::Init(CommandList* pCommandList, const DescriptorTableLib::sptr& d
 	m_descriptorTableLib = descriptorTableLib;
 
 	m_posScale = posScale;
+	m_vertexFormat = vertexFormat;
+	m_shOrder = shOrder;
 
-	// Load inputs
+	// Load inputs; the processed mesh is cached apart from the imported one for the next runs.
+	static const ObjLoader::Processing processing = { true, 0.0f, 16, 64, 124 };
 	ObjLoader objLoader;
-	if (!objLoader.Import(fileName, true, true)) return false;
-	XUSG_N_RETURN(createVB(pCommandList, objLoader.GetNumVertices(), objLoader.GetVertexStride(), objLoader.GetVertices(), uploaders), false);
+	if (!objLoader.LoadProcessedCache(fileName, processing))
+	{
+		if (!objLoader.Import(fileName, true, true, true, false, true)) return false;
+		objLoader.Weld(processing.WeldEpsilon);
+
+#if defined(_DEBUG)
+		ObjLoader::VertexCacheStats statsBefore, statsAfter;
+		objLoader.Optimize(processing.CacheSize, &statsBefore, &statsAfter);
+
+		char message[MAX_PATH + 128];
+		sprintf_s(message, "%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", fileName,
+			statsBefore.ACMR, statsAfter.ACMR, statsBefore.ATVR, statsAfter.ATVR);
+		OutputDebugStringA(message);
+#else
+		objLoader.Optimize(processing.CacheSize);
+#endif
+
+		objLoader.BuildMeshlets(processing.MaxMeshletVertices, processing.MaxMeshletTriangles);
+		objLoader.UpdateCache();
+	}
+	m_meshlets.assign(objLoader.GetMeshlets(), objLoader.GetMeshlets() + objLoader.GetNumMeshlets());
+
+	if (m_vertexFormat == VERTEX_FLOAT)
+	{
+		XUSG_N_RETURN(createVB(pCommandList, objLoader.GetNumVertices(), objLoader.GetVertexStride(), objLoader.GetVertices(), uploaders), false);
+	}
+	else
+	{
+		// Quantized vertices dequantize against the AABB in the vertex shader
+		const auto encoding = m_vertexFormat == VERTEX_QUANTIZED_OCT8 ? ObjLoader::NORMAL_OCT8 : ObjLoader::NORMAL_OCT16;
+		const auto& aabb = objLoader.GetAABB();
+		vector<uint8_t> vertices;
+#if defined(_DEBUG)
+		ObjLoader::QuantizationError error;
+		if (!objLoader.Quantize(vertices, encoding, &error)) return false;
+
+		char message[MAX_PATH + 128];
+		sprintf_s(message, "%s: position error %g (max) %g (RMS), normal error %.3f (max) %.3f (RMS) degrees\n",
+			fileName, error.MaxPosition, error.RMSPosition, error.MaxNormal, error.RMSNormal);
+		OutputDebugStringA(message);
+#else
+		if (!objLoader.Quantize(vertices, encoding)) return false;
+#endif
+		m_dequantScale = XMFLOAT3(aabb.Max.x - aabb.Min.x, aabb.Max.y - aabb.Min.y, aabb.Max.z - aabb.Min.z);
+		m_dequantBias = XMFLOAT3(aabb.Min.x, aabb.Min.y, aabb.Min.z);
+
+		XUSG_N_RETURN(createVB(pCommandList, objLoader.GetNumVertices(), ObjLoader::GetQuantizedStride(encoding), vertices.data(), uploaders), false);
+	}
 	XUSG_N_RETURN(createIB(pCommandList, objLoader.GetNumIndices(), objLoader.GetIndices(), uploaders), false);
 
 	// Create constant buffers
@@ -144,7 +200,11 @@ void Renderer::UpdateFrame(uint8_t frameIndex, CXMVECTOR eyePt, CXMMATRIX viewPr
 		pCbData->WorldViewProjPrev = m_worldViewProj;
 		XMStoreFloat4x4(&pCbData->WorldViewProj, XMMatrixTranspose(world * viewProj));
 		XMStoreFloat3x4(&pCbData->World, world);
+		pCbData->PosScale = XMFLOAT4(m_dequantScale.x, m_dequantScale.y, m_dequantScale.z, 0.0f);
+		pCbData->PosBias = XMFLOAT4(m_dequantBias.x, m_dequantBias.y, m_dequantBias.z, 0.0f);
 		m_worldViewProj = pCbData->WorldViewProj;
+
+		cullMeshlets(XMVector3TransformCoord(eyePt, XMMatrixInverse(nullptr, world)), world * viewProj);
 	}
 
 	{
@@ -241,7 +301,25 @@ bool Renderer::createInputLayout()
 		{ "NORMAL",		0, Format::R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,	InputClassification::PER_VERTEX_DATA, 0 }
 	};
 
-	XUSG_X_RETURN(m_pInputLayout, m_graphicsPipelineLib->CreateInputLayout(inputElements, static_cast<uint32_t>(size(inputElements))), false);
+	// The octahedral SNORM8 normal is packed in the W of the position.
+	const InputElement inputElementsQuantized[] =
+	{
+		{ "POSITION",	0, Format::R16G16B16A16_UNORM, 0, 0,							InputClassification::PER_VERTEX_DATA, 0 },
+		{ "NORMAL",		0, Format::R16G16_SNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT,		InputClassification::PER_VERTEX_DATA, 0 }
+	};
+
+	switch (m_vertexFormat)
+	{
+	case VERTEX_QUANTIZED_OCT16:
+		XUSG_X_RETURN(m_pInputLayout, m_graphicsPipelineLib->CreateInputLayout(inputElementsQuantized,
+			static_cast<uint32_t>(size(inputElementsQuantized))), false);
+		break;
+	case VERTEX_QUANTIZED_OCT8:
+		XUSG_X_RETURN(m_pInputLayout, m_graphicsPipelineLib->CreateInputLayout(inputElementsQuantized, 1), false);
+		break;
+	default:
+		XUSG_X_RETURN(m_pInputLayout, m_graphicsPipelineLib->CreateInputLayout(inputElements, static_cast<uint32_t>(size(inputElements))), false);
+	}
 
 	return true;
 }
@@ -317,7 +395,8 @@ bool Renderer::createPipelines(Format rtFormat)
 	auto csIndex = 0u;
 
 	// Base pass
-	XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::VS, vsIndex, L"VSBasePass.cso"), false);
+	const wchar_t* vsBasePassFiles[] = { L"VSBasePass.cso", L"VSBasePassOct16.cso", L"VSBasePassOct8.cso" };
+	XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::VS, vsIndex, vsBasePassFiles[m_vertexFormat]), false);
 	{
 		XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::PS, psIndex, L"PSBasePass.cso"), false);
 
@@ -336,7 +415,9 @@ bool Renderer::createPipelines(Format rtFormat)
 
 	// Base pass SH
 	{
-		XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::PS, psIndex, L"PSBasePassSH.cso"), false);
+		// Order 4 shares the order-3 shader, as in CPU::EvaluateSHIrradiance
+		const wchar_t* psBasePassSHFiles[] = { L"PSBasePassSH2.cso", L"PSBasePassSH.cso", L"PSBasePassSH.cso", L"PSBasePassSH5.cso" };
+		XUSG_N_RETURN(m_shaderLib->CreateShader(Shader::Stage::PS, psIndex, psBasePassSHFiles[m_shOrder - 2]), false);
 
 		const auto state = Graphics::State::MakeUnique();
 		state->IASetInputLayout(m_pInputLayout);
@@ -451,6 +532,44 @@ bool Renderer::createDescriptorTables()
 	return true;
 }
 
+void Renderer::cullMeshlets(CXMVECTOR eyePt, CXMMATRIX worldViewProj)
+{
+	m_drawRanges.clear();
+	if (m_meshlets.empty())
+	{
+		m_drawRanges.emplace_back(0, m_numIndices);
+		return;
+	}
+
+	// Frustum planes in object space from the columns of the matrix
+	const auto m = XMMatrixTranspose(worldViewProj);
+	const XMVECTOR planeVectors[] =
+	{
+		m.r[3] + m.r[0], m.r[3] - m.r[0],
+		m.r[3] + m.r[1], m.r[3] - m.r[1],
+		m.r[2], m.r[3] - m.r[2]
+	};
+
+	float planes[6][4];
+	for (uint8_t i = 0; i < 6; ++i) XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(planes[i]), planeVectors[i]);
+
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, eyePt);
+	ObjLoader::CullMeshlets(m_meshlets.data(), static_cast<uint32_t>(m_meshlets.size()),
+		planes, ObjLoader::float3(eye.x, eye.y, eye.z), m_visibleMeshlets);
+
+	// Meshlets cover contiguous index ranges, so adjacent visible ones share a draw.
+	for (const auto& i : m_visibleMeshlets)
+	{
+		const auto& meshlet = m_meshlets[i];
+		const auto start = meshlet.TriangleOffset * 3;
+		const auto count = meshlet.TriangleCount * 3;
+		if (!m_drawRanges.empty() && m_drawRanges.back().x + m_drawRanges.back().y == start)
+			m_drawRanges.back().y += count;
+		else m_drawRanges.emplace_back(start, count);
+	}
+}
+
 void Renderer::render(CommandList* pCommandList, uint8_t frameIndex, RenderMode mode, bool needClear)
 {
 	// Set framebuffer
@@ -486,7 +605,8 @@ void Renderer::render(CommandList* pCommandList, uint8_t frameIndex, RenderMode
 	pCommandList->IASetVertexBuffers(0, 1, &m_vertexBuffer->GetVBV());
 	pCommandList->IASetIndexBuffer(m_indexBuffer->GetIBV());
 
-	pCommandList->DrawIndexed(m_numIndices, 1, 0, 0, 0);
+	for (const auto& range : m_drawRanges)
+		pCommandList->DrawIndexed(range.y, 1, range.x, 0, 0);
 }
 
 void Renderer::environment(const CommandList* pCommandList, uint8_t frameIndex)
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "Core/XUSG.h"
+#include "Optional/XUSGObjLoader.h"
 
 class Renderer
 {
@@ -16,12 +17,20 @@ public:
 		GROUND_TRUTH
 	};
 
+	enum VertexFormat : uint8_t
+	{
+		VERTEX_FLOAT,			// 2 x R32G32B32_FLOAT, 24 bytes
+		VERTEX_QUANTIZED_OCT16,	// R16G16B16A16_UNORM + R16G16_SNORM octahedral normal, 12 bytes
+		VERTEX_QUANTIZED_OCT8	// R16G16B16A16_UNORM with 2 x SNORM8 octahedral normal in W, 8 bytes
+	};
+
 	Renderer();
 	virtual ~Renderer();
 
 	bool Init(XUSG::CommandList* pCommandList, const XUSG::DescriptorTableLib::sptr& descriptorTableCache,
 		std::vector<XUSG::Resource::uptr>& uploaders, const char* fileName, XUSG::Format rtFormat,
-		const DirectX::XMFLOAT4& posScale = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+		const DirectX::XMFLOAT4& posScale = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f),
+		VertexFormat vertexFormat = VERTEX_FLOAT, uint8_t shOrder = 3);
 	bool SetViewport(const XUSG::Device* pDevice, uint32_t width, uint32_t height);
 	bool SetLightProbes(const XUSG::Descriptor& irradiance, const XUSG::Descriptor& radiance);
 	bool SetLightProbesGT(const XUSG::Descriptor& irradiance, const XUSG::Descriptor& radiance);
@@ -103,17 +112,26 @@ protected:
 	bool createPipelines(XUSG::Format rtFormat);
 	bool createDescriptorTables();
 
+	void cullMeshlets(DirectX::CXMVECTOR eyePt, DirectX::CXMMATRIX worldViewProj);
 	void render(XUSG::CommandList* pCommandList, uint8_t frameIndex, RenderMode mode, bool needClear);
 	void environment(const XUSG::CommandList* pCommandList, uint8_t frameIndex);
 	void temporalAA(XUSG::CommandList* pCommandList);
 
 	uint32_t	m_numIndices;
 	uint8_t		m_frameParity;
+	uint8_t		m_shOrder;
+	VertexFormat m_vertexFormat;
 
 	DirectX::XMUINT2	m_viewport;
 	DirectX::XMFLOAT4	m_posScale;
+	DirectX::XMFLOAT3	m_dequantScale;
+	DirectX::XMFLOAT3	m_dequantBias;
 	DirectX::XMFLOAT4X4	m_worldViewProj;
 
+	std::vector<XUSG::ObjLoader::Meshlet> m_meshlets;
+	std::vector<uint32_t>	m_visibleMeshlets;
+	std::vector<DirectX::XMUINT2> m_drawRanges;	// Start index and index count
+
 	const XUSG::InputLayout* m_pInputLayout;
 	XUSG::PipelineLayout	m_pipelineLayouts[NUM_PIPELINE];
 	XUSG::Pipeline			m_pipelines[NUM_PIPELINE];
@@ -2,7 +2,10 @@
 // Copyright (c) XU, Tianchen. All rights reserved.
 //--------------------------------------------------------------------------------------
 
+#ifndef SH_ORDER
 #define SH_ORDER 3
+#endif
+
 #include "SHIrradiance.hlsli"
 #include "PSBasePass.hlsl"
 
@@ -0,0 +1,7 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#define SH_ORDER 2
+
+#include "PSBasePassSH.hlsl"
@@ -5,11 +5,21 @@
 //--------------------------------------------------------------------------------------
 // Structs
 //--------------------------------------------------------------------------------------
+#ifdef _QUANTIZED_
+struct VSIn
+{
+	float4	Pos	: POSITION;	// 16-bit UNORM against the AABB
+#ifndef _NORMAL_OCT8_
+	float2	Nrm	: NORMAL;	// Octahedral SNORM16
+#endif
+};
+#else
 struct VSIn
 {
 	float3	Pos	: POSITION;
 	float3	Nrm	: NORMAL;
 };
+#endif
 
 struct VSOut
 {
@@ -29,8 +39,24 @@ cbuffer cbPerObject
 	matrix	g_worldViewProjPrev;
 	float4x3 g_world;
 	float2	g_projBias;
+	float3	g_posScale;
+	float3	g_posBias;
 };
 
+#ifdef _QUANTIZED_
+//--------------------------------------------------------------------------------------
+// Octahedral normal decoding
+//--------------------------------------------------------------------------------------
+float3 DecodeOctahedron(float2 e)
+{
+	float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+	const float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0 ? -t : t;
+
+	return normalize(n);
+}
+#endif
+
 //--------------------------------------------------------------------------------------
 // Base geometry pass
 //--------------------------------------------------------------------------------------
@@ -38,14 +64,27 @@ VSOut main(VSIn input)
 {
 	VSOut output;
 
+#ifdef _QUANTIZED_
+	const float4 pos = { input.Pos.xyz * g_posScale + g_posBias, 1.0 };
+#ifdef _NORMAL_OCT8_
+	// 2 x SNORM8 packed in W
+	const uint packed = uint(round(input.Pos.w * 65535.0));
+	const int2 e = int2(packed << uint2(24, 16)) >> 24;
+	const float3 nrm = DecodeOctahedron(max(e / 127.0, -1.0));
+#else
+	const float3 nrm = DecodeOctahedron(input.Nrm);
+#endif
+#else
 	const float4 pos = { input.Pos, 1.0 };
+	const float3 nrm = input.Nrm;
+#endif
 	output.Pos = mul(pos, g_worldViewProj);
 	output.WSPos = mul(pos, g_world);
 	output.TSPos = mul(pos, g_worldViewProjPrev);
 	output.CSPos = output.Pos;
 
 	output.Pos.xy += g_projBias * output.Pos.w;
-	output.Norm = mul(input.Nrm, (float3x3)g_world);
+	output.Norm = mul(nrm, (float3x3)g_world);
 
 	return output;
 }
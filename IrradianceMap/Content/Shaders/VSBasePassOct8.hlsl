@@ -0,0 +1,8 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#define _QUANTIZED_
+#define _NORMAL_OCT8_
+
+#include "VSBasePass.hlsl"
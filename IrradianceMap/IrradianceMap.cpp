@@ -34,6 +34,8 @@ IrradianceMap::IrradianceMap(uint32_t width, uint32_t height, wstring name) :
 	m_tracking(false),
 	m_meshFileName("Assets/bunny.obj"),
 	m_meshPosScale(0.0f, 0.0f, 0.0f, 1.0f),
+	m_vertexFormat(Renderer::VERTEX_FLOAT),
+	m_shOrder(3),
 	m_screenShot(0)
 {
 #if defined (_DEBUG)
@@ -188,11 +190,11 @@ void IrradianceMap::LoadAssets()
 
 	m_lightProbe = make_unique<LightProbe>();
 	XUSG_N_RETURN(m_lightProbe->Init(pCommandList, m_descriptorTableLib, uploaders, m_envFileNames.data(),
-		static_cast<uint32_t>(m_envFileNames.size()), m_typedUAV), ThrowIfFailed(E_FAIL));
+		static_cast<uint32_t>(m_envFileNames.size()), m_typedUAV, m_shOrder), ThrowIfFailed(E_FAIL));
 
 	m_renderer = make_unique<Renderer>();
 	XUSG_N_RETURN(m_renderer->Init(pCommandList, m_descriptorTableLib, uploaders,
-		m_meshFileName.c_str(), g_backBufferFormat, m_meshPosScale), ThrowIfFailed(E_FAIL));
+		m_meshFileName.c_str(), g_backBufferFormat, m_meshPosScale, m_vertexFormat, m_shOrder), ThrowIfFailed(E_FAIL));
 
 	if (g_renderMode == Renderer::GROUND_TRUTH)
 	{
@@ -508,6 +510,18 @@ void IrradianceMap::ParseCommandLineArgs(wchar_t* argv[], int argc)
 			if (hasNextArgValue(i)) i += swscanf_s(argv[i + 1], L"%f", &m_meshPosScale.z);
 			if (hasNextArgValue(i)) i += swscanf_s(argv[i + 1], L"%f", &m_meshPosScale.w);
 		}
+		else if (isArgMatched(i, L"quantize"))
+		{
+			auto normalBits = 16u;
+			if (hasNextArgValue(i)) i += swscanf_s(argv[i + 1], L"%u", &normalBits);
+			m_vertexFormat = normalBits <= 8 ? Renderer::VERTEX_QUANTIZED_OCT8 : Renderer::VERTEX_QUANTIZED_OCT16;
+		}
+		else if (isArgMatched(i, L"shorder"))
+		{
+			auto shOrder = 3u;
+			if (hasNextArgValue(i)) i += swscanf_s(argv[i + 1], L"%u", &shOrder);
+			m_shOrder = static_cast<uint8_t>((min)((max)(shOrder, 2u), 5u));
+		}
 		else if (isArgMatched(i, L"env"))
 		{
 			m_envFileNames.clear();
@@ -100,6 +100,8 @@ private:
 	std::string m_meshFileName;
 	std::vector<std::wstring> m_envFileNames;
 	XMFLOAT4 m_meshPosScale;
+	Renderer::VertexFormat m_vertexFormat;
+	uint8_t m_shOrder;
 
 	// Screen-shot helpers and state
 	XUSG::Buffer::uptr	m_readBuffer;
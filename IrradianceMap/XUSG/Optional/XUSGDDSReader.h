@@ -0,0 +1,803 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "XUSGMappedFile.h"
+
+namespace XUSG
+{
+	namespace DDS
+	{
+		//--------------------------------------------------------------------------------------
+		// Read-only view of an array of T
+		//--------------------------------------------------------------------------------------
+		template<typename T>
+		class Span
+		{
+		public:
+			Span() : m_pData(nullptr), m_size(0) {}
+			Span(const T* pData, size_t size) : m_pData(pData), m_size(size) {}
+
+			const T* data() const { return m_pData; }
+			size_t size() const { return m_size; }
+			bool empty() const { return m_size == 0; }
+
+			const T* begin() const { return m_pData; }
+			const T* end() const { return m_pData + m_size; }
+			const T& operator[](size_t i) const { return m_pData[i]; }
+
+		protected:
+			const T* m_pData;
+			size_t m_size;
+		};
+
+		// Values of DXGI_FORMAT
+		enum DXGIFormat : uint32_t
+		{
+			FORMAT_UNKNOWN = 0,
+			FORMAT_R32G32B32A32_FLOAT = 2,
+			FORMAT_R32G32B32_FLOAT = 6,
+			FORMAT_R16G16B16A16_FLOAT = 10,
+			FORMAT_R11G11B10_FLOAT = 26,
+			FORMAT_R8G8B8A8_UNORM = 28,
+			FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+			FORMAT_R32_FLOAT = 41,
+			FORMAT_R16_FLOAT = 54,
+			FORMAT_R9G9B9E5_SHAREDEXP = 67,
+			FORMAT_B8G8R8A8_UNORM = 87,
+			FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+			FORMAT_BC6H_UF16 = 95,
+			FORMAT_BC6H_SF16 = 96
+		};
+
+		//--------------------------------------------------------------------------------------
+		// A mip level of an array slice (or cube face), pointing into the mapped file
+		//--------------------------------------------------------------------------------------
+		struct Surface
+		{
+			const uint8_t* pData;
+			size_t		Size;
+			uint32_t	Width;
+			uint32_t	Height;
+			uint32_t	RowPitch;	// Bytes per row of texels, or of 4x4 blocks when compressed
+			uint32_t	NumRows;	// Rows of texels, or of 4x4 blocks when compressed
+
+			template<typename T>
+			Span<T> As() const { return Span<T>(reinterpret_cast<const T*>(pData), Size / sizeof(T)); }
+		};
+
+		//--------------------------------------------------------------------------------------
+		// Header-only DDS parser over a memory-mapped file: surfaces are exposed in place,
+		// and only converted (decoded) on request
+		//--------------------------------------------------------------------------------------
+		class Reader
+		{
+		public:
+			Reader();
+			virtual ~Reader();
+
+			bool Open(const char* fileName);
+			bool Open(const uint8_t* pData, size_t size);	// The memory must outlive the reader
+			void Close();
+
+			uint32_t GetWidth() const;
+			uint32_t GetHeight() const;
+			uint32_t GetMipLevels() const;
+			uint32_t GetArraySize() const;	// Number of 2D slices, 6 per cube
+			DXGIFormat GetFormat() const;
+			bool IsCubeMap() const;
+
+			// Zero-copy access; for cube maps, item = cube * 6 + face
+			Surface GetSurface(uint32_t item, uint32_t mip) const;
+
+			// Converts a surface into numChannels (1 to 4) interleaved floats per texel
+			bool Decode(uint32_t item, uint32_t mip, float* pDst, uint8_t numChannels = 4) const;
+
+			static bool IsSupported(DXGIFormat format);
+			static bool IsBlockCompressed(DXGIFormat format);
+			static uint32_t GetBytesPerElement(DXGIFormat format);	// Per texel or per 4x4 block
+
+			static float HalfToFloat(uint16_t h);
+			static void DecodeBC6H(const uint8_t* pBlock, float pTexels[16][3], bool isSigned);
+
+		protected:
+			bool parse();
+			void decodeTexel(const uint8_t* pSrc, float rgba[4]) const;
+
+			MappedFile	m_file;
+			const uint8_t* m_pData;
+			size_t		m_size;
+
+			DXGIFormat	m_format;
+			uint32_t	m_width;
+			uint32_t	m_height;
+			uint32_t	m_mipLevels;
+			uint32_t	m_arraySize;
+			bool		m_isCubeMap;
+
+			std::vector<size_t> m_surfaceOffsets;
+		};
+
+		//--------------------------------------------------------------------------------------
+		// Implementations
+		//--------------------------------------------------------------------------------------
+
+		namespace Detail
+		{
+			static const uint32_t Magic = 0x20534444;	// "DDS "
+
+			enum : uint32_t
+			{
+				PF_ALPHAPIXELS = 0x1,
+				PF_FOURCC = 0x4,
+				PF_RGB = 0x40,
+
+				CAPS2_CUBEMAP = 0x200,
+				CAPS2_CUBEMAP_ALLFACES = 0xfc00,
+				CAPS2_VOLUME = 0x200000,
+
+				MISC_TEXTURECUBE = 0x4,
+				DIMENSION_TEXTURE2D = 3
+			};
+
+			struct PixelFormat
+			{
+				uint32_t Size;
+				uint32_t Flags;
+				uint32_t FourCC;
+				uint32_t RGBBitCount;
+				uint32_t RBitMask;
+				uint32_t GBitMask;
+				uint32_t BBitMask;
+				uint32_t ABitMask;
+			};
+
+			struct Header
+			{
+				uint32_t Size;
+				uint32_t Flags;
+				uint32_t Height;
+				uint32_t Width;
+				uint32_t PitchOrLinearSize;
+				uint32_t Depth;
+				uint32_t MipMapCount;
+				uint32_t Reserved1[11];
+				PixelFormat Format;
+				uint32_t Caps;
+				uint32_t Caps2;
+				uint32_t Caps3;
+				uint32_t Caps4;
+				uint32_t Reserved2;
+			};
+
+			struct HeaderDXT10
+			{
+				uint32_t DXGIFormat;
+				uint32_t ResourceDimension;
+				uint32_t MiscFlag;
+				uint32_t ArraySize;
+				uint32_t MiscFlags2;
+			};
+
+			constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+			{
+				return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+					(static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+			}
+
+			inline DXGIFormat GetLegacyFormat(const PixelFormat& pf)
+			{
+				if (pf.Flags & PF_FOURCC)
+				{
+					// D3DFMT values stored as FourCC
+					switch (pf.FourCC)
+					{
+					case 111: return FORMAT_R16_FLOAT;
+					case 113: return FORMAT_R16G16B16A16_FLOAT;
+					case 114: return FORMAT_R32_FLOAT;
+					case 116: return FORMAT_R32G32B32A32_FLOAT;
+					default: return FORMAT_UNKNOWN;
+					}
+				}
+
+				if ((pf.Flags & PF_RGB) && pf.RGBBitCount == 32)
+				{
+					if (pf.RBitMask == 0x000000ff && pf.GBitMask == 0x0000ff00 && pf.BBitMask == 0x00ff0000)
+						return FORMAT_R8G8B8A8_UNORM;
+					if (pf.RBitMask == 0x00ff0000 && pf.GBitMask == 0x0000ff00 && pf.BBitMask == 0x000000ff)
+						return FORMAT_B8G8R8A8_UNORM;
+				}
+
+				return FORMAT_UNKNOWN;
+			}
+
+			inline float SRGBToLinear(float c)
+			{
+				return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+
+			// Small float with a 5-bit exponent and no sign, as in R11G11B10_FLOAT
+			inline float UFloatToFloat(uint32_t bits, uint32_t mantissaBits)
+			{
+				const auto exponent = (bits >> mantissaBits) & 0x1f;
+				const auto mantissa = bits & ((1u << mantissaBits) - 1);
+				const auto halfBits = (exponent << 10) | (mantissa << (10 - mantissaBits));
+
+				return Reader::HalfToFloat(static_cast<uint16_t>(halfBits));
+			}
+
+			//--------------------------------------------------------------------------------------
+			// BC6H
+			//--------------------------------------------------------------------------------------
+
+			// A run of endpoint bits in stream order: component (endpoint * 3 + channel),
+			// and the bits from first to last, which are reversed when first > last
+			struct BitField
+			{
+				uint8_t Component;
+				uint8_t First;
+				uint8_t Last;
+			};
+
+			struct BC6HMode
+			{
+				uint8_t ModeBits;
+				uint8_t NumRegions;
+				bool Transformed;
+				uint8_t EndpointBits;
+				uint8_t DeltaBits[3];
+				uint8_t NumFields;
+				BitField Fields[28];
+			};
+
+			enum : uint8_t
+			{
+				RW, GW, BW,	// Endpoint 0 of region 0 (the base)
+				RX, GX, BX,	// Endpoint 1 of region 0
+				RY, GY, BY,	// Endpoint 0 of region 1
+				RZ, GZ, BZ	// Endpoint 1 of region 1
+			};
+
+			// Endpoint layouts of the 14 modes, indexed by the 5-bit mode value
+			inline const BC6HMode* GetBC6HMode(uint32_t mode)
+			{
+				static const BC6HMode modes[] =
+				{
+					{ 0x00, 2, true, 10, { 5, 5, 5 }, 19, {
+						{ GY, 4, 4 }, { BY, 4, 4 }, { BZ, 4, 4 }, { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 },
+						{ RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 },
+						{ BX, 0, 4 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 },
+						{ BZ, 3, 3 } } },
+					{ 0x01, 2, true, 7, { 6, 6, 6 }, 23, {
+						{ GY, 5, 5 }, { GZ, 4, 4 }, { GZ, 5, 5 }, { RW, 0, 6 }, { BZ, 0, 0 }, { BZ, 1, 1 },
+						{ BY, 4, 4 }, { GW, 0, 6 }, { BY, 5, 5 }, { BZ, 2, 2 }, { GY, 4, 4 }, { BW, 0, 6 },
+						{ BZ, 3, 3 }, { BZ, 5, 5 }, { BZ, 4, 4 }, { RX, 0, 5 }, { GY, 0, 3 }, { GX, 0, 5 },
+						{ GZ, 0, 3 }, { BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 5 }, { RZ, 0, 5 } } },
+					{ 0x02, 2, true, 11, { 5, 4, 4 }, 18, {
+						{ RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 4 }, { RW, 10, 10 }, { GY, 0, 3 },
+						{ GX, 0, 3 }, { GW, 10, 10 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 3 }, { BW, 10, 10 },
+						{ BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 } } },
+					{ 0x06, 2, true, 11, { 4, 5, 4 }, 20, {
+						{ RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 10, 10 }, { GZ, 4, 4 },
+						{ GY, 0, 3 }, { GX, 0, 4 }, { GW, 10, 10 }, { GZ, 0, 3 }, { BX, 0, 3 }, { BW, 10, 10 },
+						{ BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 3 }, { BZ, 0, 0 }, { BZ, 2, 2 }, { RZ, 0, 3 },
+						{ GY, 4, 4 }, { BZ, 3, 3 } } },
+					{ 0x0a, 2, true, 11, { 4, 4, 5 }, 20, {
+						{ RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 10, 10 }, { BY, 4, 4 },
+						{ GY, 0, 3 }, { GX, 0, 3 }, { GW, 10, 10 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 },
+						{ BW, 10, 10 }, { BY, 0, 3 }, { RY, 0, 3 }, { BZ, 1, 1 }, { BZ, 2, 2 }, { RZ, 0, 3 },
+						{ BZ, 4, 4 }, { BZ, 3, 3 } } },
+					{ 0x0e, 2, true, 9, { 5, 5, 5 }, 19, {
+						{ RW, 0, 8 }, { BY, 4, 4 }, { GW, 0, 8 }, { GY, 4, 4 }, { BW, 0, 8 }, { BZ, 4, 4 },
+						{ RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 },
+						{ BX, 0, 4 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 },
+						{ BZ, 3, 3 } } },
+					{ 0x12, 2, true, 8, { 6, 5, 5 }, 19, {
+						{ RW, 0, 7 }, { GZ, 4, 4 }, { BY, 4, 4 }, { GW, 0, 7 }, { BZ, 2, 2 }, { GY, 4, 4 },
+						{ BW, 0, 7 }, { BZ, 3, 3 }, { BZ, 4, 4 }, { RX, 0, 5 }, { GY, 0, 3 }, { GX, 0, 4 },
+						{ BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 5 },
+						{ RZ, 0, 5 } } },
+					{ 0x16, 2, true, 8, { 5, 6, 5 }, 21, {
+						{ RW, 0, 7 }, { BZ, 0, 0 }, { BY, 4, 4 }, { GW, 0, 7 }, { GY, 5, 5 }, { GY, 4, 4 },
+						{ BW, 0, 7 }, { GZ, 5, 5 }, { BZ, 4, 4 }, { RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 },
+						{ GX, 0, 5 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 },
+						{ BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 } } },
+					{ 0x1a, 2, true, 8, { 5, 5, 6 }, 21, {
+						{ RW, 0, 7 }, { BZ, 1, 1 }, { BY, 4, 4 }, { GW, 0, 7 }, { BY, 5, 5 }, { GY, 4, 4 },
+						{ BW, 0, 7 }, { BZ, 5, 5 }, { BZ, 4, 4 }, { RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 },
+						{ GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 4 },
+						{ BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 } } },
+					{ 0x1e, 2, false, 6, { 6, 6, 6 }, 23, {
+						{ RW, 0, 5 }, { GZ, 4, 4 }, { BZ, 0, 0 }, { BZ, 1, 1 }, { BY, 4, 4 }, { GW, 0, 5 },
+						{ GY, 5, 5 }, { BY, 5, 5 }, { BZ, 2, 2 }, { GY, 4, 4 }, { BW, 0, 5 }, { GZ, 5, 5 },
+						{ BZ, 3, 3 }, { BZ, 5, 5 }, { BZ, 4, 4 }, { RX, 0, 5 }, { GY, 0, 3 }, { GX, 0, 5 },
+						{ GZ, 0, 3 }, { BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 5 }, { RZ, 0, 5 } } },
+					{ 0x03, 1, false, 10, { 10, 10, 10 }, 6, {
+						{ RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 9 }, { GX, 0, 9 }, { BX, 0, 9 } } },
+					{ 0x07, 1, true, 11, { 9, 9, 9 }, 9, {
+						{ RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 8 }, { RW, 10, 10 }, { GX, 0, 8 },
+						{ GW, 10, 10 }, { BX, 0, 8 }, { BW, 10, 10 } } },
+					{ 0x0b, 1, true, 12, { 8, 8, 8 }, 9, {
+						{ RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 7 }, { RW, 11, 10 }, { GX, 0, 7 },
+						{ GW, 11, 10 }, { BX, 0, 7 }, { BW, 11, 10 } } },
+					{ 0x0f, 1, true, 16, { 4, 4, 4 }, 9, {
+						{ RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 15, 10 }, { GX, 0, 3 },
+						{ GW, 15, 10 }, { BX, 0, 3 }, { BW, 15, 10 } } }
+				};
+
+				for (const auto& m : modes)
+					if (m.ModeBits == mode) return &m;
+
+				return nullptr;
+			}
+
+			// Two-region partitions, as 16-bit masks of the texels in region 1
+			static const uint16_t BC6HPartitions[32] =
+			{
+				0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+				0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+				0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+				0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c
+			};
+
+			// Anchor texels of region 1
+			static const uint8_t BC6HAnchors[32] =
+			{
+				15, 15, 15, 15, 15, 15, 15, 15,
+				15, 15, 15, 15, 15, 15, 15, 15,
+				15, 2, 8, 2, 2, 8, 8, 15,
+				2, 8, 2, 2, 8, 8, 2, 2
+			};
+
+			class BitReader
+			{
+			public:
+				BitReader(const uint8_t* pData) : m_pData(pData), m_pos(0) {}
+
+				uint32_t Read(uint32_t numBits)
+				{
+					auto bits = 0u;
+					for (auto i = 0u; i < numBits; ++i, ++m_pos)
+						bits |= ((m_pData[m_pos >> 3] >> (m_pos & 7)) & 1u) << i;
+
+					return bits;
+				}
+
+			protected:
+				const uint8_t* m_pData;
+				uint32_t m_pos;
+			};
+
+			inline int32_t SignExtend(int32_t value, uint32_t numBits)
+			{
+				const auto shift = 32 - numBits;
+
+				return static_cast<int32_t>(static_cast<uint32_t>(value) << shift) >> shift;
+			}
+
+			inline int32_t Unquantize(int32_t comp, uint32_t numBits, bool isSigned)
+			{
+				if (!isSigned)
+				{
+					if (numBits >= 15) return comp;
+					if (comp == 0) return 0;
+					if (comp == (1 << numBits) - 1) return 0xffff;
+
+					return ((comp << 16) + 0x8000) >> numBits;
+				}
+
+				if (numBits >= 16) return comp;
+
+				const auto isNegative = comp < 0;
+				comp = isNegative ? -comp : comp;
+
+				int32_t unq;
+				if (comp == 0) unq = 0;
+				else if (comp >= (1 << (numBits - 1)) - 1) unq = 0x7fff;
+				else unq = ((comp << 15) + 0x4000) >> (numBits - 1);
+
+				return isNegative ? -unq : unq;
+			}
+
+			inline float FinishUnquantize(int32_t comp, bool isSigned)
+			{
+				if (!isSigned) return Reader::HalfToFloat(static_cast<uint16_t>((comp * 31) >> 6));
+
+				const auto h = comp < 0 ? 0x8000 | ((-comp * 31) >> 5) : (comp * 31) >> 5;
+
+				return Reader::HalfToFloat(static_cast<uint16_t>(h));
+			}
+		}
+
+		inline Reader::Reader() :
+			m_pData(nullptr),
+			m_size(0),
+			m_format(FORMAT_UNKNOWN),
+			m_width(0),
+			m_height(0),
+			m_mipLevels(0),
+			m_arraySize(0),
+			m_isCubeMap(false)
+		{
+		}
+
+		inline Reader::~Reader()
+		{
+		}
+
+		inline bool Reader::Open(const char* fileName)
+		{
+			Close();
+			if (!m_file.Open(fileName)) return false;
+
+			m_pData = m_file.GetData();
+			m_size = m_file.GetSize();
+
+			return parse();
+		}
+
+		inline bool Reader::Open(const uint8_t* pData, size_t size)
+		{
+			Close();
+			m_pData = pData;
+			m_size = size;
+
+			return parse();
+		}
+
+		inline void Reader::Close()
+		{
+			m_file.Close();
+			m_pData = nullptr;
+			m_size = 0;
+			m_format = FORMAT_UNKNOWN;
+			m_width = m_height = m_mipLevels = m_arraySize = 0;
+			m_isCubeMap = false;
+			m_surfaceOffsets.clear();
+		}
+
+		inline uint32_t Reader::GetWidth() const
+		{
+			return m_width;
+		}
+
+		inline uint32_t Reader::GetHeight() const
+		{
+			return m_height;
+		}
+
+		inline uint32_t Reader::GetMipLevels() const
+		{
+			return m_mipLevels;
+		}
+
+		inline uint32_t Reader::GetArraySize() const
+		{
+			return m_arraySize;
+		}
+
+		inline DXGIFormat Reader::GetFormat() const
+		{
+			return m_format;
+		}
+
+		inline bool Reader::IsCubeMap() const
+		{
+			return m_isCubeMap;
+		}
+
+		inline Surface Reader::GetSurface(uint32_t item, uint32_t mip) const
+		{
+			Surface surface = {};
+			if (item >= m_arraySize || mip >= m_mipLevels) return surface;
+
+			const auto i = item * m_mipLevels + mip;
+			surface.Width = (m_width >> mip) > 1 ? m_width >> mip : 1;
+			surface.Height = (m_height >> mip) > 1 ? m_height >> mip : 1;
+			surface.NumRows = IsBlockCompressed(m_format) ? (surface.Height + 3) / 4 : surface.Height;
+			surface.RowPitch = (IsBlockCompressed(m_format) ? (surface.Width + 3) / 4 : surface.Width) *
+				GetBytesPerElement(m_format);
+			surface.pData = m_pData + m_surfaceOffsets[i];
+			surface.Size = m_surfaceOffsets[i + 1] - m_surfaceOffsets[i];
+
+			return surface;
+		}
+
+		inline bool Reader::Decode(uint32_t item, uint32_t mip, float* pDst, uint8_t numChannels) const
+		{
+			const auto surface = GetSurface(item, mip);
+			if (!surface.pData || numChannels < 1 || numChannels > 4) return false;
+
+			const auto width = surface.Width;
+			const auto height = surface.Height;
+
+			if (IsBlockCompressed(m_format))
+			{
+				const auto isSigned = m_format == FORMAT_BC6H_SF16;
+				float texels[16][3];
+				for (auto by = 0u; by < surface.NumRows; ++by)
+					for (auto bx = 0u; bx * 4 < width; ++bx)
+					{
+						DecodeBC6H(&surface.pData[surface.RowPitch * by + 16 * bx], texels, isSigned);
+						for (auto i = 0u; i < 16; ++i)
+						{
+							const auto x = bx * 4 + (i & 3);
+							const auto y = by * 4 + (i >> 2);
+							if (x >= width || y >= height) continue;
+
+							const float rgba[] = { texels[i][0], texels[i][1], texels[i][2], 1.0f };
+							memcpy(&pDst[(static_cast<size_t>(width) * y + x) * numChannels], rgba, sizeof(float) * numChannels);
+						}
+					}
+
+				return true;
+			}
+
+			const auto bpp = GetBytesPerElement(m_format);
+			for (auto y = 0u; y < height; ++y)
+				for (auto x = 0u; x < width; ++x)
+				{
+					float rgba[4];
+					decodeTexel(&surface.pData[surface.RowPitch * y + bpp * x], rgba);
+					memcpy(&pDst[(static_cast<size_t>(width) * y + x) * numChannels], rgba, sizeof(float) * numChannels);
+				}
+
+			return true;
+		}
+
+		inline bool Reader::IsSupported(DXGIFormat format)
+		{
+			return GetBytesPerElement(format) > 0;
+		}
+
+		inline bool Reader::IsBlockCompressed(DXGIFormat format)
+		{
+			return format == FORMAT_BC6H_UF16 || format == FORMAT_BC6H_SF16;
+		}
+
+		inline uint32_t Reader::GetBytesPerElement(DXGIFormat format)
+		{
+			switch (format)
+			{
+			case FORMAT_R32G32B32A32_FLOAT:
+			case FORMAT_BC6H_UF16:
+			case FORMAT_BC6H_SF16:
+				return 16;
+			case FORMAT_R32G32B32_FLOAT:
+				return 12;
+			case FORMAT_R16G16B16A16_FLOAT:
+				return 8;
+			case FORMAT_R11G11B10_FLOAT:
+			case FORMAT_R8G8B8A8_UNORM:
+			case FORMAT_R8G8B8A8_UNORM_SRGB:
+			case FORMAT_R32_FLOAT:
+			case FORMAT_R9G9B9E5_SHAREDEXP:
+			case FORMAT_B8G8R8A8_UNORM:
+			case FORMAT_B8G8R8A8_UNORM_SRGB:
+				return 4;
+			case FORMAT_R16_FLOAT:
+				return 2;
+			default:
+				return 0;
+			}
+		}
+
+		inline float Reader::HalfToFloat(uint16_t h)
+		{
+			const auto sign = (h >> 15) & 1;
+			const auto exponent = (h >> 10) & 0x1f;
+			const auto mantissa = h & 0x3ff;
+
+			float value;
+			if (exponent == 0) value = std::ldexp(static_cast<float>(mantissa), -24);
+			else if (exponent == 31) value = mantissa ? NAN : INFINITY;
+			else value = std::ldexp(static_cast<float>(mantissa | 0x400), exponent - 25);
+
+			return sign ? -value : value;
+		}
+
+		inline void Reader::DecodeBC6H(const uint8_t* pBlock, float pTexels[16][3], bool isSigned)
+		{
+			using namespace Detail;
+
+			BitReader bits(pBlock);
+			auto mode = bits.Read(2);
+			if (mode > 1) mode |= bits.Read(3) << 2;
+
+			// Reserved modes decode to black
+			const auto pMode = GetBC6HMode(mode);
+			if (!pMode)
+			{
+				memset(pTexels, 0, sizeof(float[16][3]));
+
+				return;
+			}
+
+			// Endpoints
+			int32_t endpoints[4][3] = {};
+			for (auto i = 0u; i < pMode->NumFields; ++i)
+			{
+				const auto& field = pMode->Fields[i];
+				auto& comp = endpoints[field.Component / 3][field.Component % 3];
+				const auto step = field.First <= field.Last ? 1 : -1;
+				for (auto b = static_cast<int32_t>(field.First);; b += step)
+				{
+					comp |= bits.Read(1) << b;
+					if (b == field.Last) break;
+				}
+			}
+
+			const uint32_t partition = pMode->NumRegions > 1 ? bits.Read(5) : 0;
+			const auto numEndpoints = pMode->NumRegions * 2u;
+			const auto epb = pMode->EndpointBits;
+			for (uint8_t c = 0; c < 3; ++c)
+			{
+				if (isSigned) endpoints[0][c] = SignExtend(endpoints[0][c], epb);
+
+				for (auto i = 1u; i < numEndpoints; ++i)
+				{
+					auto& comp = endpoints[i][c];
+					if (pMode->Transformed || isSigned)
+						comp = SignExtend(comp, pMode->Transformed ? pMode->DeltaBits[c] : epb);
+
+					// Deltas to the base endpoint
+					if (pMode->Transformed)
+					{
+						comp = (endpoints[0][c] + comp) & ((1 << epb) - 1);
+						if (isSigned) comp = SignExtend(comp, epb);
+					}
+				}
+
+				for (auto i = 0u; i < numEndpoints; ++i)
+					endpoints[i][c] = Unquantize(endpoints[i][c], epb, isSigned);
+			}
+
+			// Indices, where the anchors are one bit shorter
+			static const int32_t weights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+			static const int32_t weights4[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+			const auto indexBits = pMode->NumRegions > 1 ? 3u : 4u;
+			const auto pWeights = pMode->NumRegions > 1 ? weights3 : weights4;
+			const auto anchor = pMode->NumRegions > 1 ? BC6HAnchors[partition] : 0u;
+			for (auto i = 0u; i < 16; ++i)
+			{
+				const auto isAnchor = i == 0 || (pMode->NumRegions > 1 && i == anchor);
+				const auto w = pWeights[bits.Read(isAnchor ? indexBits - 1 : indexBits)];
+				const auto region = pMode->NumRegions > 1 ? (BC6HPartitions[partition] >> i) & 1 : 0;
+				const auto e0 = endpoints[region * 2];
+				const auto e1 = endpoints[region * 2 + 1];
+
+				for (uint8_t c = 0; c < 3; ++c)
+					pTexels[i][c] = FinishUnquantize((e0[c] * (64 - w) + e1[c] * w + 32) >> 6, isSigned);
+			}
+		}
+
+		inline bool Reader::parse()
+		{
+			using namespace Detail;
+
+			if (!m_pData || m_size < sizeof(uint32_t) + sizeof(Header)) return false;
+
+			uint32_t magic;
+			Header header;
+			memcpy(&magic, m_pData, sizeof(uint32_t));
+			memcpy(&header, m_pData + sizeof(uint32_t), sizeof(Header));
+			if (magic != Magic || header.Size != sizeof(Header) || header.Format.Size != sizeof(PixelFormat))
+				return false;
+
+			auto offset = sizeof(uint32_t) + sizeof(Header);
+			m_width = header.Width;
+			m_height = header.Height;
+			m_mipLevels = header.MipMapCount > 0 ? header.MipMapCount : 1;
+			if (header.Caps2 & CAPS2_VOLUME) return false;
+
+			if ((header.Format.Flags & PF_FOURCC) && header.Format.FourCC == MakeFourCC('D', 'X', '1', '0'))
+			{
+				if (m_size < offset + sizeof(HeaderDXT10)) return false;
+
+				HeaderDXT10 header10;
+				memcpy(&header10, m_pData + offset, sizeof(HeaderDXT10));
+				offset += sizeof(HeaderDXT10);
+				if (header10.ResourceDimension != DIMENSION_TEXTURE2D) return false;
+
+				m_format = static_cast<DXGIFormat>(header10.DXGIFormat);
+				m_isCubeMap = (header10.MiscFlag & MISC_TEXTURECUBE) != 0;
+				m_arraySize = (header10.ArraySize > 0 ? header10.ArraySize : 1) * (m_isCubeMap ? 6 : 1);
+			}
+			else
+			{
+				m_format = GetLegacyFormat(header.Format);
+				m_isCubeMap = (header.Caps2 & CAPS2_CUBEMAP) != 0;
+				if (m_isCubeMap && (header.Caps2 & CAPS2_CUBEMAP_ALLFACES) != CAPS2_CUBEMAP_ALLFACES) return false;
+				m_arraySize = m_isCubeMap ? 6 : 1;
+			}
+
+			if (!IsSupported(m_format) || m_width == 0 || m_height == 0) return false;
+
+			// Surfaces are stored slice by slice, each with its full mip chain
+			m_surfaceOffsets.resize(static_cast<size_t>(m_arraySize) * m_mipLevels + 1);
+			auto i = 0u;
+			for (auto item = 0u; item < m_arraySize; ++item)
+				for (auto mip = 0u; mip < m_mipLevels; ++mip)
+				{
+					m_surfaceOffsets[i++] = offset;
+					const auto width = (m_width >> mip) > 1 ? m_width >> mip : 1;
+					const auto height = (m_height >> mip) > 1 ? m_height >> mip : 1;
+					const auto numRows = IsBlockCompressed(m_format) ? (height + 3) / 4 : height;
+					const auto rowPitch = (IsBlockCompressed(m_format) ? (width + 3) / 4 : width) * GetBytesPerElement(m_format);
+					offset += static_cast<size_t>(rowPitch) * numRows;
+				}
+			m_surfaceOffsets[i] = offset;
+
+			return offset <= m_size;
+		}
+
+		inline void Reader::decodeTexel(const uint8_t* pSrc, float rgba[4]) const
+		{
+			using namespace Detail;
+
+			rgba[0] = rgba[1] = rgba[2] = 0.0f;
+			rgba[3] = 1.0f;
+
+			switch (m_format)
+			{
+			case FORMAT_R32G32B32A32_FLOAT:
+				memcpy(rgba, pSrc, sizeof(float[4]));
+				break;
+			case FORMAT_R32G32B32_FLOAT:
+				memcpy(rgba, pSrc, sizeof(float[3]));
+				break;
+			case FORMAT_R32_FLOAT:
+				memcpy(rgba, pSrc, sizeof(float));
+				break;
+			case FORMAT_R16G16B16A16_FLOAT:
+			case FORMAT_R16_FLOAT:
+			{
+				uint16_t h[4];
+				const auto numChannels = m_format == FORMAT_R16_FLOAT ? 1u : 4u;
+				memcpy(h, pSrc, sizeof(uint16_t) * numChannels);
+				for (auto i = 0u; i < numChannels; ++i) rgba[i] = HalfToFloat(h[i]);
+				break;
+			}
+			case FORMAT_R11G11B10_FLOAT:
+			{
+				uint32_t v;
+				memcpy(&v, pSrc, sizeof(uint32_t));
+				rgba[0] = UFloatToFloat(v & 0x7ff, 6);
+				rgba[1] = UFloatToFloat((v >> 11) & 0x7ff, 6);
+				rgba[2] = UFloatToFloat(v >> 22, 5);
+				break;
+			}
+			case FORMAT_R9G9B9E5_SHAREDEXP:
+			{
+				uint32_t v;
+				memcpy(&v, pSrc, sizeof(uint32_t));
+				const auto scale = std::ldexp(1.0f, static_cast<int>(v >> 27) - 24);
+				rgba[0] = (v & 0x1ff) * scale;
+				rgba[1] = ((v >> 9) & 0x1ff) * scale;
+				rgba[2] = ((v >> 18) & 0x1ff) * scale;
+				break;
+			}
+			case FORMAT_R8G8B8A8_UNORM:
+			case FORMAT_R8G8B8A8_UNORM_SRGB:
+			case FORMAT_B8G8R8A8_UNORM:
+			case FORMAT_B8G8R8A8_UNORM_SRGB:
+			{
+				const auto isBGRA = m_format == FORMAT_B8G8R8A8_UNORM || m_format == FORMAT_B8G8R8A8_UNORM_SRGB;
+				const auto isSRGB = m_format == FORMAT_R8G8B8A8_UNORM_SRGB || m_format == FORMAT_B8G8R8A8_UNORM_SRGB;
+				for (auto i = 0u; i < 4; ++i) rgba[i] = pSrc[i] / 255.0f;
+				if (isBGRA) std::swap(rgba[0], rgba[2]);
+				if (isSRGB) for (auto i = 0u; i < 3; ++i) rgba[i] = SRGBToLinear(rgba[i]);
+				break;
+			}
+			default:
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,253 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include "XUSGDDSReader.h"
+
+namespace XUSG
+{
+	namespace DDS
+	{
+		//--------------------------------------------------------------------------------------
+		// Header-only DDS writer for uncompressed float textures with the DX10 header, laid
+		// out as the reader expects: slice by slice, each with its full mip chain
+		//--------------------------------------------------------------------------------------
+		class Writer
+		{
+		public:
+			Writer();
+			virtual ~Writer();
+
+			// For cube maps, arraySize counts the cubes; mipLevels = 0 takes the full chain
+			bool Create(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t arraySize,
+				DXGIFormat format, bool isCubeMap = false);
+
+			// Converts numChannels (1 to 4) interleaved floats per texel into a surface;
+			// for cube maps, item = cube * 6 + face
+			bool Encode(uint32_t item, uint32_t mip, const float* pSrc, uint8_t numChannels = 4);
+
+			bool Save(const char* fileName) const;
+
+			const uint8_t* GetData() const;
+			size_t GetSize() const;
+
+			uint32_t GetMipLevels() const;
+			uint32_t GetArraySize() const;	// Number of 2D slices, 6 per cube
+
+			static bool IsSupported(DXGIFormat format);
+
+			// Round to nearest even, as F16C
+			static uint16_t FloatToHalf(float value);
+
+		protected:
+			DXGIFormat	m_format;
+			uint32_t	m_width;
+			uint32_t	m_height;
+			uint32_t	m_mipLevels;
+			uint32_t	m_arraySize;
+
+			std::vector<uint8_t> m_data;
+			std::vector<size_t> m_surfaceOffsets;
+		};
+
+		//--------------------------------------------------------------------------------------
+		// Implementations
+		//--------------------------------------------------------------------------------------
+
+		inline Writer::Writer() :
+			m_format(FORMAT_UNKNOWN),
+			m_width(0),
+			m_height(0),
+			m_mipLevels(0),
+			m_arraySize(0)
+		{
+		}
+
+		inline Writer::~Writer()
+		{
+		}
+
+		inline bool Writer::Create(uint32_t width, uint32_t height, uint32_t mipLevels,
+			uint32_t arraySize, DXGIFormat format, bool isCubeMap)
+		{
+			using namespace Detail;
+
+			if (!IsSupported(format) || width == 0 || height == 0 || arraySize == 0) return false;
+			if (isCubeMap && width != height) return false;
+
+			auto maxMips = 1u;
+			while (((width | height) >> maxMips) > 0) ++maxMips;
+			mipLevels = mipLevels ? (std::min)(mipLevels, maxMips) : maxMips;
+
+			m_format = format;
+			m_width = width;
+			m_height = height;
+			m_mipLevels = mipLevels;
+			m_arraySize = arraySize * (isCubeMap ? 6 : 1);
+
+			Header header = {};
+			header.Size = sizeof(Header);
+			header.Flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x8;	// Caps, height, width, pixel format, pitch
+			if (mipLevels > 1) header.Flags |= 0x20000;		// Mip-map count
+			header.Height = height;
+			header.Width = width;
+			header.PitchOrLinearSize = width * Reader::GetBytesPerElement(format);
+			header.MipMapCount = mipLevels;
+			header.Format.Size = sizeof(PixelFormat);
+			header.Format.Flags = PF_FOURCC;
+			header.Format.FourCC = MakeFourCC('D', 'X', '1', '0');
+			header.Caps = 0x1000;							// Texture
+			if (mipLevels > 1 || isCubeMap) header.Caps |= 0x8;	// Complex
+			if (mipLevels > 1) header.Caps |= 0x400000;		// Mip map
+			if (isCubeMap) header.Caps2 = CAPS2_CUBEMAP | CAPS2_CUBEMAP_ALLFACES;
+
+			HeaderDXT10 header10 = {};
+			header10.DXGIFormat = format;
+			header10.ResourceDimension = DIMENSION_TEXTURE2D;
+			header10.MiscFlag = isCubeMap ? static_cast<uint32_t>(MISC_TEXTURECUBE) : 0u;
+			header10.ArraySize = arraySize;
+
+			// Surface offsets
+			auto offset = sizeof(uint32_t) + sizeof(Header) + sizeof(HeaderDXT10);
+			m_surfaceOffsets.resize(static_cast<size_t>(m_arraySize) * m_mipLevels + 1);
+			auto i = 0u;
+			for (auto item = 0u; item < m_arraySize; ++item)
+				for (auto mip = 0u; mip < m_mipLevels; ++mip)
+				{
+					m_surfaceOffsets[i++] = offset;
+					const auto w = (width >> mip) > 1 ? width >> mip : 1;
+					const auto h = (height >> mip) > 1 ? height >> mip : 1;
+					offset += static_cast<size_t>(w) * h * Reader::GetBytesPerElement(format);
+				}
+			m_surfaceOffsets[i] = offset;
+
+			m_data.assign(offset, 0);
+			memcpy(m_data.data(), &Magic, sizeof(uint32_t));
+			memcpy(&m_data[sizeof(uint32_t)], &header, sizeof(Header));
+			memcpy(&m_data[sizeof(uint32_t) + sizeof(Header)], &header10, sizeof(HeaderDXT10));
+
+			return true;
+		}
+
+		inline bool Writer::Encode(uint32_t item, uint32_t mip, const float* pSrc, uint8_t numChannels)
+		{
+			if (item >= m_arraySize || mip >= m_mipLevels || numChannels < 1 || numChannels > 4) return false;
+
+			const auto i = item * m_mipLevels + mip;
+			const auto pDst = &m_data[m_surfaceOffsets[i]];
+			const auto bpp = Reader::GetBytesPerElement(m_format);
+			const auto numTexels = (m_surfaceOffsets[i + 1] - m_surfaceOffsets[i]) / bpp;
+			for (size_t j = 0; j < numTexels; ++j)
+			{
+				float rgba[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+				memcpy(rgba, &pSrc[numChannels * j], sizeof(float) * numChannels);
+
+				const auto pTexel = &pDst[bpp * j];
+				switch (m_format)
+				{
+				case FORMAT_R32G32B32A32_FLOAT:
+				case FORMAT_R32G32B32_FLOAT:
+				case FORMAT_R32_FLOAT:
+					memcpy(pTexel, rgba, bpp);
+					break;
+				case FORMAT_R16G16B16A16_FLOAT:
+				case FORMAT_R16_FLOAT:
+				{
+					uint16_t h[4];
+					const auto numHalves = bpp / sizeof(uint16_t);
+					for (auto k = 0u; k < numHalves; ++k) h[k] = FloatToHalf(rgba[k]);
+					memcpy(pTexel, h, bpp);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		inline bool Writer::Save(const char* fileName) const
+		{
+			if (m_data.empty()) return false;
+
+			std::ofstream file(fileName, std::ios::binary);
+			if (!file) return false;
+
+			file.write(reinterpret_cast<const char*>(m_data.data()), m_data.size());
+
+			return static_cast<bool>(file);
+		}
+
+		inline const uint8_t* Writer::GetData() const
+		{
+			return m_data.data();
+		}
+
+		inline size_t Writer::GetSize() const
+		{
+			return m_data.size();
+		}
+
+		inline uint32_t Writer::GetMipLevels() const
+		{
+			return m_mipLevels;
+		}
+
+		inline uint32_t Writer::GetArraySize() const
+		{
+			return m_arraySize;
+		}
+
+		inline bool Writer::IsSupported(DXGIFormat format)
+		{
+			switch (format)
+			{
+			case FORMAT_R32G32B32A32_FLOAT:
+			case FORMAT_R32G32B32_FLOAT:
+			case FORMAT_R16G16B16A16_FLOAT:
+			case FORMAT_R32_FLOAT:
+			case FORMAT_R16_FLOAT:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		inline uint16_t Writer::FloatToHalf(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+			bits &= 0x7fffffff;
+
+			if (bits > 0x7f800000) return sign | 0x7e00;	// NaN
+			if (bits >= 0x47800000) return sign | 0x7c00;	// Inf
+			if (bits < 0x33000000) return sign;				// Zero
+
+			uint32_t half, remainder, halfway;
+			if (bits < 0x38800000)
+			{
+				// Denormal
+				const auto shift = 126 - (bits >> 23);
+				const auto mantissa = (bits & 0x7fffff) | 0x800000;
+				half = mantissa >> shift;
+				remainder = mantissa & ((1u << shift) - 1);
+				halfway = 1u << (shift - 1);
+			}
+			else
+			{
+				half = (bits - 0x38000000) >> 13;
+				remainder = bits & 0x1fff;
+				halfway = 0x1000;
+			}
+			if (remainder > halfway || (remainder == halfway && (half & 1))) ++half;
+
+			return sign | static_cast<uint16_t>(half);
+		}
+	}
+}
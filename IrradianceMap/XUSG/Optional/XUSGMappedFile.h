@@ -0,0 +1,162 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace XUSG
+{
+	//--------------------------------------------------------------------------------------
+	// Read-only memory-mapped file (header only)
+	//--------------------------------------------------------------------------------------
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		virtual ~MappedFile();
+
+		bool Open(const char* fileName);
+		void Close();
+
+		const uint8_t* GetData() const;
+		size_t GetSize() const;
+
+	protected:
+#ifdef _WIN32
+		HANDLE		m_file;
+		HANDLE		m_mapping;
+#else
+		int			m_file;
+#endif
+		const uint8_t* m_pData;
+		size_t		m_size;
+	};
+
+	//--------------------------------------------------------------------------------------
+	// Implementations
+	//--------------------------------------------------------------------------------------
+
+	inline MappedFile::MappedFile() :
+#ifdef _WIN32
+		m_file(INVALID_HANDLE_VALUE),
+		m_mapping(nullptr),
+#else
+		m_file(-1),
+#endif
+		m_pData(nullptr),
+		m_size(0)
+	{
+	}
+
+	inline MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	inline bool MappedFile::Open(const char* fileName)
+	{
+		Close();
+
+#ifdef _WIN32
+		m_file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_file, &fileSize))
+		{
+			Close();
+
+			return false;
+		}
+		m_size = static_cast<size_t>(fileSize.QuadPart);
+
+		// Empty files cannot be mapped
+		if (m_size > 0)
+		{
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!m_mapping)
+			{
+				Close();
+
+				return false;
+			}
+
+			m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+#else
+		m_file = open(fileName, O_RDONLY);
+		if (m_file < 0) return false;
+
+		struct stat fileStat;
+		if (fstat(m_file, &fileStat) != 0)
+		{
+			Close();
+
+			return false;
+		}
+		m_size = static_cast<size_t>(fileStat.st_size);
+
+		// Empty files cannot be mapped
+		if (m_size > 0)
+		{
+			const auto pData = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+			m_pData = pData != MAP_FAILED ? static_cast<const uint8_t*>(pData) : nullptr;
+			if (m_pData) madvise(const_cast<uint8_t*>(m_pData), m_size, MADV_SEQUENTIAL);
+		}
+#endif
+
+		if (m_size > 0 && !m_pData)
+		{
+			Close();
+
+			return false;
+		}
+
+		return true;
+	}
+
+	inline void MappedFile::Close()
+	{
+#ifdef _WIN32
+		if (m_pData) UnmapViewOfFile(m_pData);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		if (m_pData) munmap(const_cast<uint8_t*>(m_pData), m_size);
+		if (m_file >= 0) close(m_file);
+		m_file = -1;
+#endif
+		m_pData = nullptr;
+		m_size = 0;
+	}
+
+	inline const uint8_t* MappedFile::GetData() const
+	{
+		return m_pData;
+	}
+
+	inline size_t MappedFile::GetSize() const
+	{
+		return m_size;
+	}
+}
@@ -2,11 +2,297 @@
 // Copyright (c) XU, Tianchen. All rights reserved.
 //--------------------------------------------------------------------------------------
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <sys/stat.h>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define XUSG_OBJ_SSE2
+#endif
 #include "XUSGObjLoader.h"
+#include "XUSGMappedFile.h"
 
 using namespace std;
 using namespace XUSG;
 
+#ifndef _WIN32
+// The bounds-checked CRT functions of MSVC; the buffer sizes after %s are ignored, as
+// the variadic arguments beyond those of the format are
+static int fopen_s(FILE** ppFile, const char* fileName, const char* mode)
+{
+	*ppFile = fopen(fileName, mode);
+
+	return *ppFile ? 0 : -1;
+}
+
+static int fscanf_s(FILE* pFile, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	const auto result = vfscanf(pFile, format, args);
+	va_end(args);
+
+	return result;
+}
+
+static int sscanf_s(const char* buffer, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	const auto result = vsscanf(buffer, format, args);
+	va_end(args);
+
+	return result;
+}
+#endif
+
+namespace
+{
+	// Layout of mesh cache files, all little endian:
+	// CacheHeader, source path, then each padded to 16 bytes: vertices, indices, meshlets,
+	// meshlet vertices, and meshlet triangles. The processing fields are all zero in the
+	// cache of Import.
+	struct CacheHeader
+	{
+		char		Magic[4];
+		uint32_t	Version;
+		uint64_t	FileSize;
+		int64_t		FileTime;
+		uint32_t	Flags;
+		uint32_t	PathLength;
+		uint32_t	Stride;
+		uint32_t	NumVertices;
+		uint32_t	NumIndices;
+		ObjLoader::AABB AABB;
+		uint32_t	NumMeshlets;
+		uint64_t	VertexOffset;
+		uint64_t	IndexOffset;
+		uint32_t	NumMeshletVertices;
+		uint32_t	NumMeshletTriangles;
+		uint64_t	MeshletOffset;
+		uint64_t	MeshletVertexOffset;
+		uint64_t	MeshletTriangleOffset;
+		uint32_t	Welded;
+		float		WeldEpsilon;
+		uint32_t	CacheSize;
+		uint32_t	MaxMeshletVertices;
+		uint32_t	MaxMeshletTriangles;
+	};
+
+	static const char CacheMagic[] = { 'X', 'M', 'S', 'H' };
+	static const uint32_t CacheVersion = 3;
+
+	inline string getCacheFileName(const char* pszFilename, bool isProcessed)
+	{
+		return string(pszFilename) + (isProcessed ? ".opt.cache" : ".cache");
+	}
+
+	inline uint64_t alignCacheOffset(uint64_t offset)
+	{
+		return (offset + 15) & ~static_cast<uint64_t>(15);
+	}
+
+	inline bool isLittleEndian()
+	{
+		const uint16_t value = 1;
+
+		return *reinterpret_cast<const uint8_t*>(&value) == 1;
+	}
+
+	inline bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline void skipBlanks(const char*& p, const char* pEnd)
+	{
+		while (p < pEnd && isBlank(*p)) ++p;
+	}
+
+	inline void skipLine(const char*& p, const char* pEnd)
+	{
+		while (p < pEnd && *p != '\n') ++p;
+	}
+
+	bool parseInt(const char*& p, const char* pEnd, int64_t& value)
+	{
+		auto q = p;
+		const auto isNegative = q < pEnd && *q == '-';
+		if (q < pEnd && (*q == '-' || *q == '+')) ++q;
+		if (q >= pEnd || !isDigit(*q)) return false;
+
+		value = 0;
+		while (q < pEnd && isDigit(*q)) value = value * 10 + (*q++ - '0');
+		value = isNegative ? -value : value;
+		p = q;
+
+		return true;
+	}
+
+	// Decimal to float with the same (correctly rounded) result as strtof: the
+	// common short numbers take an exact double computation, the rest falls back.
+	bool parseFloat(const char*& p, const char* pEnd, float& value)
+	{
+		static const double powersOf10[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const auto pBegin = p;
+		auto q = p;
+		const auto isNegative = q < pEnd && *q == '-';
+		if (q < pEnd && (*q == '-' || *q == '+')) ++q;
+
+		uint64_t mantissa = 0;
+		auto numDigits = 0;
+		auto exponent = 0;
+		auto hasDigits = false;
+		for (; q < pEnd && isDigit(*q); ++q, hasDigits = true)
+		{
+			if (mantissa == 0 && *q == '0') continue;
+			if (numDigits++ < 19) mantissa = mantissa * 10 + (*q - '0');
+			else ++exponent;
+		}
+		if (q < pEnd && *q == '.')
+			for (++q; q < pEnd && isDigit(*q); ++q, hasDigits = true)
+			{
+				if (mantissa == 0 && *q == '0')
+				{
+					--exponent;
+					continue;
+				}
+				if (numDigits++ < 19)
+				{
+					mantissa = mantissa * 10 + (*q - '0');
+					--exponent;
+				}
+			}
+		if (!hasDigits) return false;
+
+		if (q < pEnd && (*q == 'e' || *q == 'E'))
+		{
+			auto r = q + 1;
+			int64_t e;
+			if (parseInt(r, pEnd, e))
+			{
+				exponent += static_cast<int>((max)((min)(e, static_cast<int64_t>(INT16_MAX)), static_cast<int64_t>(INT16_MIN)));
+				q = r;
+			}
+		}
+		p = q;
+
+		// Both operands are exact, so the double result is correctly rounded. Rounding
+		// it again to float is only wrong when it lands exactly halfway between floats.
+		if (numDigits <= 19 && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22)
+		{
+			auto d = static_cast<double>(mantissa);
+			d = exponent < 0 ? d / powersOf10[-exponent] : d * powersOf10[exponent];
+
+			uint64_t bits;
+			memcpy(&bits, &d, sizeof(bits));
+			if ((bits & 0x1fffffff) != 0x10000000 || mantissa == 0)
+			{
+				value = static_cast<float>(isNegative ? -d : d);
+
+				return true;
+			}
+		}
+
+		char buffer[128];
+		const auto length = (min)(static_cast<size_t>(p - pBegin), sizeof(buffer) - 1);
+		memcpy(buffer, pBegin, length);
+		buffer[length] = '\0';
+		value = strtof(buffer, nullptr);
+
+		return true;
+	}
+
+	bool parseFloat3(const char*& p, const char* pEnd, ObjLoader::float3& f, bool forDX, bool swapYZ)
+	{
+		float v[3];
+		for (auto& c : v)
+		{
+			skipBlanks(p, pEnd);
+			if (!parseFloat(p, pEnd, c)) return false;
+		}
+
+		f = swapYZ ? ObjLoader::float3(v[0], v[2], v[1]) : ObjLoader::float3(v);
+		f.z = forDX ? -f.z : f.z;
+
+		return true;
+	}
+
+	// Resolves 1-based or negative (relative to the current count) OBJ indices
+	inline uint32_t resolveIndex(int64_t i, size_t count)
+	{
+		return static_cast<uint32_t>(i < 0 ? i + static_cast<int64_t>(count) : i - 1);
+	}
+
+	inline uint64_t hashMix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+
+		return h ^ (h >> 33);
+	}
+
+	inline uint64_t hashBytes(const uint8_t* pData, uint32_t size)
+	{
+		auto h = static_cast<uint64_t>(size);
+		for (auto i = 0u; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t))
+		{
+			uint32_t word;
+			memcpy(&word, &pData[i], sizeof(uint32_t));
+			h = hashMix(h ^ word);
+		}
+
+		return h;
+	}
+
+	inline uint32_t getHashTableSize(uint32_t count)
+	{
+		auto size = 1u;
+		while (size < count + count / 2) size <<= 1;
+
+		return size;
+	}
+
+	// Enough work per thread to amortize its start and its partial results
+	static const uint32_t minItemsPerThread = 1 << 16;
+
+	template<typename Func>
+	void parallelFor(uint32_t count, uint32_t numThreads, const Func& func)
+	{
+		numThreads = (min)(numThreads, count);
+		if (numThreads <= 1)
+		{
+			for (auto i = 0u; i < count; ++i) func(i);
+
+			return;
+		}
+
+		vector<thread> threads;
+		threads.reserve(numThreads - 1);
+		for (auto t = 1u; t < numThreads; ++t)
+			threads.emplace_back([&, t]() { for (auto i = t; i < count; i += numThreads) func(i); });
+		for (auto i = 0u; i < count; i += numThreads) func(i);
+		for (auto& t : threads) t.join();
+	}
+}
+
 ObjLoader::ObjLoader()
 {
 }
@@ -15,30 +301,588 @@ ObjLoader::~ObjLoader()
 {
 }
 
-bool ObjLoader::Import(const char* pszFilename, bool needNorm, bool needAABB, bool forDX, bool swapYZ)
+bool ObjLoader::Import(const char* pszFilename, bool needNorm, bool needAABB,
+	bool forDX, bool swapYZ, bool useCache, uint32_t numThreads)
 {
-	FILE* pFile;
-	fopen_s(&pFile, pszFilename, "r");
-
-	if (!pFile) return false;
+	m_meshlets.clear();
+	m_meshletVertices.clear();
+	m_meshletTriangles.clear();
+	m_cacheFileName.clear();
+	m_processing = {};
+
+	CacheKey cacheKey;
+	useCache = useCache && isLittleEndian() && getCacheKey(pszFilename, needNorm, forDX, swapYZ, cacheKey);
+	if (useCache)
+	{
+		m_cacheFileName = pszFilename;
+		m_cacheKey = cacheKey;
+		if (loadCache(pszFilename, cacheKey)) return true;
+	}
 
 	m_stride = sizeof(float3);
 	m_stride += needNorm ? sizeof(float3) : 0;
+	numThreads = numThreads ? numThreads : (max)(thread::hardware_concurrency(), 1u);
+
+	// Import the OBJ file in a single pass over the mapped text,
+	// or in two passes of file reads if it cannot be mapped.
+	uint32_t numNorm;
+	MappedFile file;
+	if (file.Open(pszFilename))
+		importGeometry(reinterpret_cast<const char*>(file.GetData()), file.GetSize(), numThreads, numNorm, forDX, swapYZ);
+	else
+	{
+		FILE* pFile;
+		fopen_s(&pFile, pszFilename, "r");
+
+		if (!pFile) return false;
 
-	// Import the OBJ file.
-	uint32_t numTexc, numNorm;
-	importGeometryFirstPass(pFile, numTexc, numNorm);
-	rewind(pFile);
-	importGeometrySecondPass(pFile, numTexc, numNorm, forDX, swapYZ);
-	fclose(pFile);
+		uint32_t numTexc;
+		importGeometryFirstPass(pFile, numTexc, numNorm);
+		rewind(pFile);
+		importGeometrySecondPass(pFile, numTexc, numNorm, forDX, swapYZ);
+		fclose(pFile);
+	}
 
 	// Perform post import tasks.
-	if (needNorm && !numNorm) recomputeNormals();
-	if (needAABB) computeAABB();
+	if (needNorm && !numNorm) recomputeNormals(numThreads);
+	if (needAABB || useCache) computeAABB(numThreads);
+	if (useCache) saveCache(pszFilename, cacheKey);
+
+	return true;
+}
+
+bool ObjLoader::LoadProcessedCache(const char* pszFilename, const Processing& processing,
+	bool needNorm, bool forDX, bool swapYZ)
+{
+	m_cacheFileName.clear();
+
+	CacheKey cacheKey;
+	if (!isLittleEndian() || !getCacheKey(pszFilename, needNorm, forDX, swapYZ, cacheKey) ||
+		!loadCache(pszFilename, cacheKey, &processing)) return false;
+
+	m_cacheFileName = pszFilename;
+	m_cacheKey = cacheKey;
+
+	return true;
+}
+
+uint32_t ObjLoader::Weld(float epsilon)
+{
+	const auto numVert = GetNumVertices();
+	const auto stride = GetVertexStride();
+	const auto numFloats = stride / sizeof(float);
+	if (numVert == 0) return 0;
+
+	m_processing = {};
+	m_processing.Welded = true;
+	m_processing.WeldEpsilon = epsilon;
+	m_meshlets.clear();
+	m_meshletVertices.clear();
+	m_meshletTriangles.clear();
+
+	// Maps each vertex to the first vertex it merges with
+	vector<uint32_t> remap(numVert);
+	const auto tableSize = getHashTableSize(numVert);
+	const auto mask = tableSize - 1;
+
+	if (epsilon <= 0.0f)
+	{
+		// Open addressing on the hash of the whole vertex
+		vector<uint32_t> table(tableSize, UINT32_MAX);
+		for (auto i = 0u; i < numVert; ++i)
+		{
+			const auto pVertex = &m_vertices[stride * i];
+			auto slot = static_cast<uint32_t>(hashBytes(pVertex, stride)) & mask;
+			while (table[slot] != UINT32_MAX && memcmp(&m_vertices[stride * table[slot]], pVertex, stride) != 0)
+				slot = (slot + 1) & mask;
+
+			if (table[slot] == UINT32_MAX) table[slot] = i;
+			remap[i] = table[slot];
+		}
+	}
+	else
+	{
+		// Grid of position cells of at least epsilon: the vertices within epsilon of a
+		// vertex are in its own or the 26 neighboring cells. Each cell keeps a chain of
+		// the vertices that are kept.
+		struct Cell
+		{
+			int32_t Coord[3];
+			uint32_t Head;
+		};
+
+		// Larger cells only lengthen the chains, so they grow with the extent of the finite
+		// positions to keep the cell coordinates within 2^29; the coordinates of the others
+		// are clamped, as they are never within epsilon of anything.
+		auto maxCoord = 0.0;
+		for (auto i = 0u; i < numVert; ++i)
+		{
+			const auto& p = getPosition(i);
+			for (const auto& x : { p.x, p.y, p.z })
+				if (isfinite(x)) maxCoord = (max)(maxCoord, fabs(static_cast<double>(x)));
+		}
+		const auto cellSize = (max)(static_cast<double>(epsilon), maxCoord / (1 << 29));
+
+		const auto cellOf = [cellSize](const float3& p, int32_t coord[3])
+		{
+			static const auto limit = 1 << 30;
+			const double x[] = { floor(p.x / cellSize), floor(p.y / cellSize), floor(p.z / cellSize) };
+			for (uint8_t i = 0; i < 3; ++i)
+				coord[i] = x[i] < limit ? (x[i] > -limit ? static_cast<int32_t>(x[i]) : -limit) : limit;
+		};
+
+		const auto hashCell = [](const int32_t coord[3])
+		{
+			return hashMix((static_cast<uint64_t>(static_cast<uint32_t>(coord[0])) << 32 |
+				static_cast<uint32_t>(coord[1])) ^ hashMix(static_cast<uint32_t>(coord[2])));
+		};
+
+		const auto isNear = [&](uint32_t a, uint32_t b)
+		{
+			const auto pA = reinterpret_cast<const float*>(&m_vertices[stride * a]);
+			const auto pB = reinterpret_cast<const float*>(&m_vertices[stride * b]);
+			for (auto i = 0u; i < numFloats; ++i)
+				if (!(fabs(pA[i] - pB[i]) <= epsilon)) return false;
+
+			return true;
+		};
+
+		vector<Cell> table(tableSize, { { 0, 0, 0 }, UINT32_MAX });
+		vector<uint32_t> next(numVert, UINT32_MAX);
+		const auto findCell = [&](const int32_t coord[3])
+		{
+			auto slot = static_cast<uint32_t>(hashCell(coord)) & mask;
+			while (table[slot].Head != UINT32_MAX && memcmp(table[slot].Coord, coord, sizeof(Cell::Coord)) != 0)
+				slot = (slot + 1) & mask;
+
+			return slot;
+		};
+
+		for (auto i = 0u; i < numVert; ++i)
+		{
+			int32_t coord[3];
+			cellOf(getPosition(i), coord);
+
+			remap[i] = UINT32_MAX;
+			for (auto k = 0u; k < 27 && remap[i] == UINT32_MAX; ++k)
+			{
+				const auto n = (k + 13) % 27;	// Own cell first
+				const int32_t neighbor[] = { coord[0] + static_cast<int32_t>(n % 3) - 1,
+					coord[1] + static_cast<int32_t>(n / 3 % 3) - 1, coord[2] + static_cast<int32_t>(n / 9) - 1 };
+				for (auto j = table[findCell(neighbor)].Head; j != UINT32_MAX; j = next[j])
+				{
+					if (isNear(i, j))
+					{
+						remap[i] = j;
+						break;
+					}
+				}
+			}
+
+			if (remap[i] == UINT32_MAX)
+			{
+				// Keep the vertex
+				auto& cell = table[findCell(coord)];
+				memcpy(cell.Coord, coord, sizeof(Cell::Coord));
+				next[i] = cell.Head;
+				cell.Head = i;
+				remap[i] = i;
+			}
+		}
+	}
+
+	// Compact the kept vertices in their original order.
+	auto numWelded = 0u;
+	for (auto i = 0u; i < numVert; ++i)
+	{
+		if (remap[i] == i)
+		{
+			const auto j = numWelded++;
+			if (j != i) memcpy(getVertex(j), getVertex(i), stride);
+			remap[i] = j;
+		}
+		else remap[i] = remap[remap[i]];
+	}
+	m_vertices.resize(stride * numWelded);
+	m_vertices.shrink_to_fit();
+
+	// Remap the indices, dropping the collapsed triangles.
+	const auto numTri = GetNumIndices() / 3;
+	auto numKept = 0u;
+	for (auto i = 0u; i < numTri; ++i)
+	{
+		const auto v0 = remap[m_indices[i * 3]];
+		const auto v1 = remap[m_indices[i * 3 + 1]];
+		const auto v2 = remap[m_indices[i * 3 + 2]];
+		if (v0 == v1 || v1 == v2 || v2 == v0) continue;
+
+		m_indices[numKept * 3] = v0;
+		m_indices[numKept * 3 + 1] = v1;
+		m_indices[numKept * 3 + 2] = v2;
+		++numKept;
+	}
+	m_indices.resize(numKept * 3);
+
+	return numVert - numWelded;
+}
+
+void ObjLoader::Optimize(uint32_t cacheSize, VertexCacheStats* pStatsBefore, VertexCacheStats* pStatsAfter)
+{
+	if (pStatsBefore) *pStatsBefore = GetVertexCacheStats(cacheSize);
+
+	m_processing.CacheSize = cacheSize;
+	m_processing.MaxMeshletVertices = 0;
+	m_processing.MaxMeshletTriangles = 0;
+	m_meshlets.clear();
+	m_meshletVertices.clear();
+	m_meshletTriangles.clear();
+	reorderTriangles(cacheSize);
+	reorderVertices();
+
+	if (pStatsAfter) *pStatsAfter = GetVertexCacheStats(cacheSize);
+}
+
+ObjLoader::VertexCacheStats ObjLoader::GetVertexCacheStats(uint32_t cacheSize) const
+{
+	const auto numVert = GetNumVertices();
+	const auto numIdx = GetNumIndices();
+
+	// FIFO cache: a vertex is a hit while fewer than cacheSize misses followed its own.
+	vector<uint32_t> cacheTimes(numVert, 0);
+	vector<bool> isUsed(numVert, false);
+	auto numMisses = 0u;
+	auto numUsed = 0u;
+	for (auto i = 0u; i < numIdx; ++i)
+	{
+		const auto v = m_indices[i];
+		if (!isUsed[v])
+		{
+			isUsed[v] = true;
+			++numUsed;
+		}
+
+		if (cacheTimes[v] == 0 || numMisses - cacheTimes[v] >= cacheSize)
+			cacheTimes[v] = ++numMisses;
+	}
+
+	VertexCacheStats stats;
+	stats.ACMR = numIdx ? static_cast<float>(numMisses) / (numIdx / 3) : 0.0f;
+	stats.ATVR = numUsed ? static_cast<float>(numMisses) / numUsed : 0.0f;
+
+	return stats;
+}
+
+uint32_t ObjLoader::BuildMeshlets(uint32_t maxVertices, uint32_t maxTriangles)
+{
+	// Local triangle indices are 8-bit.
+	maxVertices = (min)((max)(maxVertices, 3u), 256u);
+	maxTriangles = (max)(maxTriangles, 1u);
+
+	const auto numTri = GetNumIndices() / 3;
+	m_processing.MaxMeshletVertices = maxVertices;
+	m_processing.MaxMeshletTriangles = maxTriangles;
+	m_meshlets.clear();
+	m_meshletVertices.clear();
+	m_meshletTriangles.clear();
+	m_meshletTriangles.reserve(numTri * 3);
+
+	// Greedily appends the triangles in order, so that the meshlets follow the
+	// vertex cache order and each covers a contiguous index range.
+	vector<uint32_t> localIndices(GetNumVertices(), UINT32_MAX);
+	Meshlet meshlet = {};
+	const auto finishMeshlet = [&]()
+	{
+		for (auto i = 0u; i < meshlet.VertexCount; ++i)
+			localIndices[m_meshletVertices[meshlet.VertexOffset + i]] = UINT32_MAX;
+		computeMeshletBounds(meshlet);
+		m_meshlets.push_back(meshlet);
+
+		meshlet = {};
+		meshlet.VertexOffset = static_cast<uint32_t>(m_meshletVertices.size());
+		meshlet.TriangleOffset = static_cast<uint32_t>(m_meshletTriangles.size() / 3);
+	};
+
+	for (auto i = 0u; i < numTri; ++i)
+	{
+		const auto pTri = &m_indices[i * 3];
+		auto numNew = 0u;
+		for (uint8_t j = 0; j < 3; ++j)
+			if (localIndices[pTri[j]] == UINT32_MAX && (j < 1 || pTri[j] != pTri[0]) && (j < 2 || pTri[j] != pTri[1]))
+				++numNew;
+
+		if (meshlet.VertexCount + numNew > maxVertices || meshlet.TriangleCount >= maxTriangles) finishMeshlet();
+
+		for (uint8_t j = 0; j < 3; ++j)
+		{
+			auto& localIndex = localIndices[pTri[j]];
+			if (localIndex == UINT32_MAX)
+			{
+				localIndex = meshlet.VertexCount++;
+				m_meshletVertices.push_back(pTri[j]);
+			}
+			m_meshletTriangles.push_back(static_cast<uint8_t>(localIndex));
+		}
+		++meshlet.TriangleCount;
+	}
+	if (meshlet.TriangleCount > 0) finishMeshlet();
+
+	return GetNumMeshlets();
+}
+
+uint32_t ObjLoader::CullMeshlets(const Meshlet* pMeshlets, uint32_t numMeshlets, const float planes[6][4],
+	const float3& eyePt, vector<uint32_t>& visible)
+{
+	float normPlanes[6][4];
+	for (uint8_t i = 0; i < 6; ++i)
+	{
+		const auto l = sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+		for (uint8_t j = 0; j < 4; ++j) normPlanes[i][j] = l > 0.0f ? planes[i][j] / l : 0.0f;
+	}
+
+	visible.clear();
+	for (auto i = 0u; i < numMeshlets; ++i)
+	{
+		const auto& meshlet = pMeshlets[i];
+		const auto& c = meshlet.Center;
+
+		// Frustum culling of the bounding sphere
+		auto isVisible = true;
+		for (uint8_t j = 0; j < 6 && isVisible; ++j)
+			isVisible = normPlanes[j][0] * c.x + normPlanes[j][1] * c.y + normPlanes[j][2] * c.z +
+			normPlanes[j][3] >= -meshlet.Radius;
+
+		// Backface culling of the normal cone
+		if (isVisible)
+		{
+			const float3 v(c.x - eyePt.x, c.y - eyePt.y, c.z - eyePt.z);
+			const auto& a = meshlet.ConeAxis;
+			isVisible = v.x * a.x + v.y * a.y + v.z * a.z <
+				sqrt(v.x * v.x + v.y * v.y + v.z * v.z) * meshlet.ConeCutoff + meshlet.Radius;
+		}
+
+		if (isVisible) visible.push_back(i);
+	}
+
+	return static_cast<uint32_t>(visible.size());
+}
+
+bool ObjLoader::UpdateCache() const
+{
+	return !m_cacheFileName.empty() && saveCache(m_cacheFileName.c_str(), m_cacheKey, &m_processing);
+}
+
+bool ObjLoader::Quantize(vector<uint8_t>& vertices, NormalEncoding encoding, QuantizationError* pError) const
+{
+	const auto numVert = GetNumVertices();
+	const auto srcStride = GetVertexStride();
+	const auto dstStride = GetQuantizedStride(encoding);
+	if (srcStride < sizeof(float3[2])) return false;
+
+	const float aabbMin[] = { m_aabb.Min.x, m_aabb.Min.y, m_aabb.Min.z };
+	const float extent[] = { m_aabb.Max.x - m_aabb.Min.x, m_aabb.Max.y - m_aabb.Min.y, m_aabb.Max.z - m_aabb.Min.z };
+	float scale[3], invScale[3];
+	for (uint8_t i = 0; i < 3; ++i)
+	{
+		scale[i] = extent[i] > 0.0f ? 65535.0f / extent[i] : 0.0f;
+		invScale[i] = extent[i] / 65535.0f;
+	}
+	const auto normalMax = encoding == NORMAL_OCT8 ? 127.0f : 32767.0f;
+
+	vertices.resize(static_cast<size_t>(dstStride) * numVert);
+	auto maxPosError = 0.0f, maxNormalError = 0.0f;
+	auto sumPosError = 0.0, sumNormalError = 0.0;
+
+	// Processes 4 vertices in SIMD; the tail is padded into a local copy.
+#ifdef XUSG_OBJ_SSE2
+	const auto vMin = [&](uint8_t i) { return _mm_set1_ps(aabbMin[i]); };
+	const auto vScale = [&](uint8_t i) { return _mm_set1_ps(scale[i]); };
+	const auto vInvScale = [&](uint8_t i) { return _mm_set1_ps(invScale[i]); };
+	const auto zero = _mm_setzero_ps();
+	const auto one = _mm_set1_ps(1.0f);
+	const auto signMask = _mm_set1_ps(-0.0f);
+	const auto vNormalMax = _mm_set1_ps(normalMax);
+	const auto vNormalMaxInv = _mm_set1_ps(1.0f / normalMax);
+	const auto vPosMax = _mm_set1_ps(65535.0f);
+	const auto absf = [signMask](__m128 v) { return _mm_andnot_ps(signMask, v); };
+	const auto signNotZero = [signMask, one](__m128 v) { return _mm_or_ps(one, _mm_and_ps(v, signMask)); };
+	const auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+
+	vector<uint8_t> tail(srcStride * 4, 0);
+	for (auto i = 0u; i < numVert; i += 4)
+	{
+		const auto numLanes = (min)(numVert - i, 4u);
+		const uint8_t* pSrc = &m_vertices[static_cast<size_t>(srcStride) * i];
+		if (numLanes < 4)
+		{
+			memcpy(tail.data(), pSrc, static_cast<size_t>(srcStride) * numLanes);
+			pSrc = tail.data();
+		}
+
+		// AoS to SoA: rows of (x, y, z, nx) and of (z, nx, ny, nz)
+		__m128 p[4], n[4];
+		for (uint8_t j = 0; j < 4; ++j)
+		{
+			const auto pVertex = reinterpret_cast<const float*>(pSrc + srcStride * j);
+			p[j] = _mm_loadu_ps(pVertex);
+			n[j] = _mm_loadu_ps(pVertex + 2);
+		}
+		_MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+		_MM_TRANSPOSE4_PS(n[0], n[1], n[2], n[3]);
+		const auto& nx = n[1];
+		const auto& ny = n[2];
+		const auto& nz = n[3];
+
+		// Positions
+		__m128i qp[3];
+		auto posError = zero;
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			auto q = _mm_mul_ps(_mm_sub_ps(p[c], vMin(c)), vScale(c));
+			q = _mm_min_ps(_mm_max_ps(q, zero), vPosMax);
+			qp[c] = _mm_cvtps_epi32(q);
+
+			const auto d = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(qp[c]), vInvScale(c)), vMin(c)), p[c]);
+			posError = _mm_add_ps(posError, _mm_mul_ps(d, d));
+		}
+		posError = _mm_sqrt_ps(posError);
+
+		// Octahedral normals
+		const auto l1 = _mm_add_ps(_mm_add_ps(absf(nx), absf(ny)), absf(nz));
+		const auto invL1 = _mm_div_ps(one, _mm_max_ps(l1, _mm_set1_ps(1e-20f)));
+		auto ox = _mm_mul_ps(nx, invL1);
+		auto oy = _mm_mul_ps(ny, invL1);
+		const auto isLower = _mm_cmplt_ps(nz, zero);
+		const auto fx = _mm_mul_ps(_mm_sub_ps(one, absf(oy)), signNotZero(ox));
+		const auto fy = _mm_mul_ps(_mm_sub_ps(one, absf(ox)), signNotZero(oy));
+		ox = select(isLower, fx, ox);
+		oy = select(isLower, fy, oy);
+		const auto qx = _mm_cvtps_epi32(_mm_mul_ps(ox, vNormalMax));
+		const auto qy = _mm_cvtps_epi32(_mm_mul_ps(oy, vNormalMax));
+
+		// Decode to measure the angular error
+		auto dx = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(qx), vNormalMaxInv), _mm_set1_ps(-1.0f));
+		auto dy = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(qy), vNormalMaxInv), _mm_set1_ps(-1.0f));
+		const auto dz = _mm_sub_ps(_mm_sub_ps(one, absf(dx)), absf(dy));
+		const auto t = _mm_max_ps(_mm_sub_ps(zero, dz), zero);
+		dx = _mm_add_ps(dx, select(_mm_cmpge_ps(dx, zero), _mm_sub_ps(zero, t), t));
+		dy = _mm_add_ps(dy, select(_mm_cmpge_ps(dy, zero), _mm_sub_ps(zero, t), t));
+		const auto dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, nx), _mm_mul_ps(dy, ny)), _mm_mul_ps(dz, nz));
+		const auto cx = _mm_sub_ps(_mm_mul_ps(dy, nz), _mm_mul_ps(dz, ny));
+		const auto cy = _mm_sub_ps(_mm_mul_ps(dz, nx), _mm_mul_ps(dx, nz));
+		const auto cz = _mm_sub_ps(_mm_mul_ps(dx, ny), _mm_mul_ps(dy, nx));
+		const auto cross = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz)));
+
+		// Write out
+		alignas(16) int32_t qpx[4], qpy[4], qpz[4], qnx[4], qny[4];
+		alignas(16) float posErrors[4], dots[4], crosses[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(qpx), qp[0]);
+		_mm_store_si128(reinterpret_cast<__m128i*>(qpy), qp[1]);
+		_mm_store_si128(reinterpret_cast<__m128i*>(qpz), qp[2]);
+		_mm_store_si128(reinterpret_cast<__m128i*>(qnx), qx);
+		_mm_store_si128(reinterpret_cast<__m128i*>(qny), qy);
+		_mm_store_ps(posErrors, posError);
+		_mm_store_ps(dots, dot);
+		_mm_store_ps(crosses, cross);
+		for (auto j = 0u; j < numLanes; ++j)
+		{
+			uint16_t v[4] = { static_cast<uint16_t>(qpx[j]), static_cast<uint16_t>(qpy[j]), static_cast<uint16_t>(qpz[j]), 0 };
+			const auto pDst = &vertices[static_cast<size_t>(dstStride) * (i + j)];
+			if (encoding == NORMAL_OCT8)
+				v[3] = static_cast<uint16_t>(static_cast<uint8_t>(qnx[j]) | (static_cast<uint8_t>(qny[j]) << 8));
+			else
+			{
+				const int16_t e[] = { static_cast<int16_t>(qnx[j]), static_cast<int16_t>(qny[j]) };
+				memcpy(pDst + sizeof(v), e, sizeof(e));
+			}
+			memcpy(pDst, v, sizeof(v));
+
+			if (pError)
+			{
+				const auto angle = atan2(crosses[j], dots[j]);
+				maxPosError = (max)(maxPosError, posErrors[j]);
+				maxNormalError = (max)(maxNormalError, angle);
+				sumPosError += posErrors[j] * posErrors[j];
+				sumNormalError += angle * angle;
+			}
+		}
+	}
+#else
+	for (auto i = 0u; i < numVert; ++i)
+	{
+		const auto pSrc = reinterpret_cast<const float*>(&m_vertices[static_cast<size_t>(srcStride) * i]);
+		const auto pDst = &vertices[static_cast<size_t>(dstStride) * i];
+
+		uint16_t v[4] = {};
+		auto posError = 0.0f;
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			const auto q = (min)((max)((pSrc[c] - aabbMin[c]) * scale[c], 0.0f), 65535.0f);
+			v[c] = static_cast<uint16_t>(nearbyint(q));
+			const auto d = v[c] * invScale[c] + aabbMin[c] - pSrc[c];
+			posError += d * d;
+		}
+		posError = sqrt(posError);
+
+		const auto& nx = pSrc[3];
+		const auto& ny = pSrc[4];
+		const auto& nz = pSrc[5];
+		const auto invL1 = 1.0f / (max)(fabs(nx) + fabs(ny) + fabs(nz), 1e-20f);
+		auto ox = nx * invL1;
+		auto oy = ny * invL1;
+		if (nz < 0.0f)
+		{
+			const auto fx = (1.0f - fabs(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+			oy = (1.0f - fabs(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+			ox = fx;
+		}
+		const auto qx = static_cast<int32_t>(nearbyint(ox * normalMax));
+		const auto qy = static_cast<int32_t>(nearbyint(oy * normalMax));
+
+		if (encoding == NORMAL_OCT8) v[3] = static_cast<uint16_t>(static_cast<uint8_t>(qx) | (static_cast<uint8_t>(qy) << 8));
+		else
+		{
+			const int16_t e[] = { static_cast<int16_t>(qx), static_cast<int16_t>(qy) };
+			memcpy(pDst + sizeof(v), e, sizeof(e));
+		}
+		memcpy(pDst, v, sizeof(v));
+		if (!pError) continue;
+
+		// Decode to measure the angular error
+		auto dx = (max)(qx / normalMax, -1.0f);
+		auto dy = (max)(qy / normalMax, -1.0f);
+		const auto dz = 1.0f - fabs(dx) - fabs(dy);
+		const auto t = (max)(-dz, 0.0f);
+		dx += dx >= 0.0f ? -t : t;
+		dy += dy >= 0.0f ? -t : t;
+		const auto cx = dy * nz - dz * ny;
+		const auto cy = dz * nx - dx * nz;
+		const auto cz = dx * ny - dy * nx;
+		const auto angle = atan2(sqrt(cx * cx + cy * cy + cz * cz), dx * nx + dy * ny + dz * nz);
+
+		maxPosError = (max)(maxPosError, posError);
+		maxNormalError = (max)(maxNormalError, angle);
+		sumPosError += posError * posError;
+		sumNormalError += angle * angle;
+	}
+#endif
+
+	if (pError)
+	{
+		static const auto radToDeg = 180.0 / 3.14159265358979323846;
+		pError->MaxPosition = maxPosError;
+		pError->RMSPosition = numVert ? static_cast<float>(sqrt(sumPosError / numVert)) : 0.0f;
+		pError->MaxNormal = static_cast<float>(maxNormalError * radToDeg);
+		pError->RMSNormal = numVert ? static_cast<float>(sqrt(sumNormalError / numVert) * radToDeg) : 0.0f;
+	}
 
 	return true;
 }
 
+uint32_t ObjLoader::GetQuantizedStride(NormalEncoding encoding)
+{
+	return encoding == NORMAL_OCT8 ? sizeof(uint16_t[4]) : sizeof(uint16_t[4]) + sizeof(int16_t[2]);
+}
+
 const uint32_t ObjLoader::GetNumVertices() const
 {
 	return static_cast<uint32_t>(m_vertices.size() / GetVertexStride());
@@ -64,11 +908,485 @@ const uint32_t* ObjLoader::GetIndices() const
 	return m_indices.data();
 }
 
+const uint32_t ObjLoader::GetNumMeshlets() const
+{
+	return static_cast<uint32_t>(m_meshlets.size());
+}
+
+const ObjLoader::Meshlet* ObjLoader::GetMeshlets() const
+{
+	return m_meshlets.data();
+}
+
+const uint32_t* ObjLoader::GetMeshletVertices() const
+{
+	return m_meshletVertices.data();
+}
+
+const uint8_t* ObjLoader::GetMeshletTriangles() const
+{
+	return m_meshletTriangles.data();
+}
+
 const ObjLoader::AABB& ObjLoader::GetAABB() const
 {
 	return m_aabb;
 }
 
+const ObjLoader::Processing& ObjLoader::GetProcessing() const
+{
+	return m_processing;
+}
+
+bool ObjLoader::loadCache(const char* pszFilename, const CacheKey& key, const Processing* pProcessing)
+{
+	const auto pathLength = static_cast<uint32_t>(strlen(pszFilename));
+	const auto processing = pProcessing ? *pProcessing : Processing();
+
+	MappedFile file;
+	if (!file.Open(getCacheFileName(pszFilename, pProcessing != nullptr).c_str())) return false;
+
+	const auto pData = file.GetData();
+	const auto size = file.GetSize();
+	if (size < sizeof(CacheHeader)) return false;
+
+	CacheHeader header;
+	memcpy(&header, pData, sizeof(CacheHeader));
+	if (memcmp(header.Magic, CacheMagic, sizeof(CacheMagic)) != 0 || header.Version != CacheVersion ||
+		header.FileSize != key.FileSize || header.FileTime != key.FileTime || header.Flags != key.Flags ||
+		header.PathLength != pathLength || sizeof(CacheHeader) + pathLength > size ||
+		memcmp(pData + sizeof(CacheHeader), pszFilename, pathLength) != 0)
+		return false;
+	if (header.Welded != (processing.Welded ? 1u : 0u) || header.WeldEpsilon != processing.WeldEpsilon ||
+		header.CacheSize != processing.CacheSize || header.MaxMeshletVertices != processing.MaxMeshletVertices ||
+		header.MaxMeshletTriangles != processing.MaxMeshletTriangles)
+		return false;
+
+	const auto vertexBytes = static_cast<uint64_t>(header.Stride) * header.NumVertices;
+	const auto indexBytes = sizeof(uint32_t) * static_cast<uint64_t>(header.NumIndices);
+	const auto meshletBytes = sizeof(Meshlet) * static_cast<uint64_t>(header.NumMeshlets);
+	const auto meshletVertexBytes = sizeof(uint32_t) * static_cast<uint64_t>(header.NumMeshletVertices);
+	const auto meshletTriangleBytes = 3 * static_cast<uint64_t>(header.NumMeshletTriangles);
+	if (header.Stride < sizeof(float3) || header.VertexOffset + vertexBytes > size ||
+		header.IndexOffset + indexBytes > size || header.MeshletOffset + meshletBytes > size ||
+		header.MeshletVertexOffset + meshletVertexBytes > size ||
+		header.MeshletTriangleOffset + meshletTriangleBytes > size) return false;
+
+	// The buffers are stored in their in-memory layout, so loading is a copy each.
+	const auto pVertices = pData + header.VertexOffset;
+	const auto pIndices = reinterpret_cast<const uint32_t*>(pData + header.IndexOffset);
+	m_stride = header.Stride;
+	m_aabb = header.AABB;
+	m_vertices.assign(pVertices, pVertices + vertexBytes);
+	m_indices.assign(pIndices, pIndices + header.NumIndices);
+
+	const auto pMeshlets = reinterpret_cast<const Meshlet*>(pData + header.MeshletOffset);
+	const auto pMeshletVertices = reinterpret_cast<const uint32_t*>(pData + header.MeshletVertexOffset);
+	const auto pMeshletTriangles = pData + header.MeshletTriangleOffset;
+	m_meshlets.assign(pMeshlets, pMeshlets + header.NumMeshlets);
+	m_meshletVertices.assign(pMeshletVertices, pMeshletVertices + header.NumMeshletVertices);
+	m_meshletTriangles.assign(pMeshletTriangles, pMeshletTriangles + meshletTriangleBytes);
+	m_processing = processing;
+
+	return true;
+}
+
+bool ObjLoader::saveCache(const char* pszFilename, const CacheKey& key, const Processing* pProcessing) const
+{
+	const auto processing = pProcessing ? *pProcessing : Processing();
+
+	CacheHeader header = {};
+	memcpy(header.Magic, CacheMagic, sizeof(CacheMagic));
+	header.Version = CacheVersion;
+	header.FileSize = key.FileSize;
+	header.FileTime = key.FileTime;
+	header.Flags = key.Flags;
+	header.PathLength = static_cast<uint32_t>(strlen(pszFilename));
+	header.Stride = m_stride;
+	header.NumVertices = GetNumVertices();
+	header.NumIndices = GetNumIndices();
+	header.AABB = m_aabb;
+	header.VertexOffset = alignCacheOffset(sizeof(CacheHeader) + header.PathLength);
+	header.IndexOffset = alignCacheOffset(header.VertexOffset + m_vertices.size());
+	header.NumMeshlets = GetNumMeshlets();
+	header.NumMeshletVertices = static_cast<uint32_t>(m_meshletVertices.size());
+	header.NumMeshletTriangles = static_cast<uint32_t>(m_meshletTriangles.size() / 3);
+	header.MeshletOffset = alignCacheOffset(header.IndexOffset + sizeof(uint32_t) * m_indices.size());
+	header.MeshletVertexOffset = alignCacheOffset(header.MeshletOffset + sizeof(Meshlet) * m_meshlets.size());
+	header.MeshletTriangleOffset = alignCacheOffset(header.MeshletVertexOffset + sizeof(uint32_t) * m_meshletVertices.size());
+	header.Welded = processing.Welded ? 1 : 0;
+	header.WeldEpsilon = processing.WeldEpsilon;
+	header.CacheSize = processing.CacheSize;
+	header.MaxMeshletVertices = processing.MaxMeshletVertices;
+	header.MaxMeshletTriangles = processing.MaxMeshletTriangles;
+
+	FILE* pFile;
+	fopen_s(&pFile, getCacheFileName(pszFilename, pProcessing != nullptr).c_str(), "wb");
+	if (!pFile) return false;
+
+	// The header goes last, so that an interrupted write leaves an invalid cache.
+	static const uint8_t padding[16] = {};
+	const CacheHeader invalidHeader = {};
+	uint64_t offset = sizeof(CacheHeader) + header.PathLength;
+	const auto writeSection = [&](uint64_t sectionOffset, const void* pSection, uint64_t sectionSize)
+	{
+		const auto paddingSize = static_cast<size_t>(sectionOffset - offset);
+		offset = sectionOffset + sectionSize;
+
+		return fwrite(padding, 1, paddingSize, pFile) == paddingSize &&
+			fwrite(pSection, 1, static_cast<size_t>(sectionSize), pFile) == sectionSize;
+	};
+
+	auto success = fwrite(&invalidHeader, sizeof(CacheHeader), 1, pFile) == 1;
+	success = success && fwrite(pszFilename, 1, header.PathLength, pFile) == header.PathLength;
+	success = success && writeSection(header.VertexOffset, m_vertices.data(), m_vertices.size());
+	success = success && writeSection(header.IndexOffset, m_indices.data(), sizeof(uint32_t) * m_indices.size());
+	success = success && writeSection(header.MeshletOffset, m_meshlets.data(), sizeof(Meshlet) * m_meshlets.size());
+	success = success && writeSection(header.MeshletVertexOffset, m_meshletVertices.data(), sizeof(uint32_t) * m_meshletVertices.size());
+	success = success && writeSection(header.MeshletTriangleOffset, m_meshletTriangles.data(), m_meshletTriangles.size());
+	success = success && fflush(pFile) == 0 && fseek(pFile, 0, SEEK_SET) == 0;
+	success = success && fwrite(&header, sizeof(CacheHeader), 1, pFile) == 1;
+	success = fclose(pFile) == 0 && success;
+
+	return success;
+}
+
+bool ObjLoader::getCacheKey(const char* pszFilename, bool needNorm, bool forDX, bool swapYZ, CacheKey& key)
+{
+#ifdef _WIN32
+	struct _stat64 fileStat;
+	if (_stat64(pszFilename, &fileStat) != 0) return false;
+#else
+	struct stat fileStat;
+	if (stat(pszFilename, &fileStat) != 0) return false;
+#endif
+
+	key.FileSize = static_cast<uint64_t>(fileStat.st_size);
+	key.FileTime = static_cast<int64_t>(fileStat.st_mtime);
+	key.Flags = (needNorm ? 1 : 0) | (forDX ? 2 : 0) | (swapYZ ? 4 : 0);
+
+	return true;
+}
+
+void ObjLoader::reorderTriangles(uint32_t cacheSize)
+{
+	// Tipsify [Sander et al. 2007]
+	const auto numVert = GetNumVertices();
+	const auto numTri = GetNumIndices() / 3;
+	if (numTri == 0) return;
+
+	// Vertex-triangle adjacency
+	vector<uint32_t> adjOffsets(numVert + 1, 0), adjacency(numTri * 3);
+	for (auto i = 0u; i < numTri * 3; ++i) ++adjOffsets[m_indices[i] + 1];
+	for (auto v = 0u; v < numVert; ++v) adjOffsets[v + 1] += adjOffsets[v];
+	vector<uint32_t> liveCounts(numVert);
+	for (auto v = 0u; v < numVert; ++v) liveCounts[v] = adjOffsets[v + 1] - adjOffsets[v];
+	{
+		auto cursors = adjOffsets;
+		for (auto i = 0u; i < numTri * 3; ++i) adjacency[cursors[m_indices[i]]++] = i / 3;
+	}
+
+	vector<uint32_t> cacheTimes(numVert, 0), deadEnds, candidates, indices;
+	vector<bool> isEmitted(numTri, false);
+	deadEnds.reserve(numTri * 3);
+	indices.reserve(numTri * 3);
+	auto time = cacheSize + 1;
+	auto cursor = 0u;
+
+	const auto skipDeadEnd = [&]()
+	{
+		// The most recently referenced vertex that still has live triangles
+		while (!deadEnds.empty())
+		{
+			const auto v = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveCounts[v] > 0) return v;
+		}
+
+		// Else, the next vertex in input order
+		for (; cursor < numVert; ++cursor)
+			if (liveCounts[cursor] > 0) return cursor;
+
+		return UINT32_MAX;
+	};
+
+	for (auto fan = 0u; fan != UINT32_MAX;)
+	{
+		// Emit all the remaining triangles around the fanning vertex.
+		candidates.clear();
+		for (auto j = adjOffsets[fan]; j < adjOffsets[fan + 1]; ++j)
+		{
+			const auto t = adjacency[j];
+			if (isEmitted[t]) continue;
+
+			for (uint8_t k = 0; k < 3; ++k)
+			{
+				const auto v = m_indices[t * 3 + k];
+				indices.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				--liveCounts[v];
+				if (time - cacheTimes[v] > cacheSize) cacheTimes[v] = time++;
+			}
+			isEmitted[t] = true;
+		}
+
+		// Next fanning vertex: the one that stays in the cache the longest after
+		// emitting its remaining triangles
+		auto next = UINT32_MAX;
+		auto bestPriority = -1;
+		for (const auto& v : candidates)
+		{
+			if (liveCounts[v] == 0) continue;
+
+			auto priority = 0;
+			if (time - cacheTimes[v] + 2 * liveCounts[v] <= cacheSize)
+				priority = static_cast<int>(time - cacheTimes[v]);
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		fan = next != UINT32_MAX ? next : skipDeadEnd();
+	}
+
+	m_indices.swap(indices);
+}
+
+void ObjLoader::reorderVertices()
+{
+	const auto numVert = GetNumVertices();
+	const auto stride = GetVertexStride();
+
+	// New indices in order of first use, with unreferenced vertices last
+	vector<uint32_t> remap(numVert, UINT32_MAX);
+	auto numRemapped = 0u;
+	for (auto& i : m_indices)
+	{
+		if (remap[i] == UINT32_MAX) remap[i] = numRemapped++;
+		i = remap[i];
+	}
+	for (auto& i : remap) if (i == UINT32_MAX) i = numRemapped++;
+
+	vector<uint8_t> vertices(m_vertices.size());
+	for (auto i = 0u; i < numVert; ++i)
+		memcpy(&vertices[stride * remap[i]], getVertex(i), stride);
+	m_vertices.swap(vertices);
+}
+
+void ObjLoader::computeMeshletBounds(Meshlet& meshlet)
+{
+	const auto pVertices = &m_meshletVertices[meshlet.VertexOffset];
+	const auto pTriangles = &m_meshletTriangles[meshlet.TriangleOffset * 3];
+
+	// Bounding sphere around the center of the AABB
+	float3 minPt(FLT_MAX, FLT_MAX, FLT_MAX), maxPt(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (auto i = 0u; i < meshlet.VertexCount; ++i)
+	{
+		const auto& p = getPosition(pVertices[i]);
+		minPt = float3((min)(minPt.x, p.x), (min)(minPt.y, p.y), (min)(minPt.z, p.z));
+		maxPt = float3((max)(maxPt.x, p.x), (max)(maxPt.y, p.y), (max)(maxPt.z, p.z));
+	}
+
+	meshlet.Center = float3((minPt.x + maxPt.x) * 0.5f, (minPt.y + maxPt.y) * 0.5f, (minPt.z + maxPt.z) * 0.5f);
+	const auto& c = meshlet.Center;
+	auto radiusSq = 0.0f;
+	for (auto i = 0u; i < meshlet.VertexCount; ++i)
+	{
+		const auto& p = getPosition(pVertices[i]);
+		const float3 d(p.x - c.x, p.y - c.y, p.z - c.z);
+		radiusSq = (max)(radiusSq, d.x * d.x + d.y * d.y + d.z * d.z);
+	}
+	meshlet.Radius = sqrt(radiusSq);
+
+	// Normal cone around the average face normal, wound as in recomputeNormals()
+	vector<float3> normals(meshlet.TriangleCount);
+	float3 axis(0.0f, 0.0f, 0.0f);
+	for (auto i = 0u; i < meshlet.TriangleCount; ++i)
+	{
+		const auto& p0 = getPosition(pVertices[pTriangles[i * 3]]);
+		const auto& p1 = getPosition(pVertices[pTriangles[i * 3 + 1]]);
+		const auto& p2 = getPosition(pVertices[pTriangles[i * 3 + 2]]);
+		const float3 e1(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+		const float3 e2(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z);
+		auto& n = normals[i];
+		n = float3(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+		const auto l = sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+		n = l > 0.0f ? float3(n.x / l, n.y / l, n.z / l) : float3(0.0f, 0.0f, 0.0f);
+		axis = float3(axis.x + n.x, axis.y + n.y, axis.z + n.z);
+	}
+
+	const auto l = sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+	meshlet.ConeAxis = l > 0.0f ? float3(axis.x / l, axis.y / l, axis.z / l) : float3(0.0f, 0.0f, 1.0f);
+	auto minDot = l > 0.0f ? 1.0f : -1.0f;
+	for (const auto& n : normals)
+		minDot = (min)(minDot, n.x * meshlet.ConeAxis.x + n.y * meshlet.ConeAxis.y + n.z * meshlet.ConeAxis.z);
+
+	// The cutoff is the sine of the cone angle; cones of 90 degrees or wider never cull.
+	meshlet.ConeCutoff = minDot > 0.0f ? sqrt(1.0f - minDot * minDot) : 1.0f;
+}
+
+void ObjLoader::importGeometry(const char* pData, size_t size, uint32_t numThreads,
+	uint32_t& numNorm, bool forDX, bool swapYZ)
+{
+	// Split the file into line-aligned chunks of at least 1 MB.
+	static const size_t minChunkSize = 1 << 20;
+	const auto numChunks = static_cast<uint32_t>((max)((min)(static_cast<size_t>(numThreads), size / minChunkSize), size_t(1)));
+	const auto pEnd = pData + size;
+
+	vector<const char*> bounds(numChunks + 1, pEnd);
+	bounds[0] = pData;
+	for (auto i = 1u; i < numChunks; ++i)
+	{
+		auto p = (max)(pData + size / numChunks * i, bounds[i - 1]);
+		skipLine(p, pEnd);
+		bounds[i] = p < pEnd ? p + 1 : pEnd;
+	}
+
+	vector<Chunk> chunks(numChunks);
+	parallelFor(numChunks, numThreads, [&](uint32_t i)
+	{
+		parseChunk(bounds[i], bounds[i + 1], chunks[i], forDX, swapYZ);
+	});
+
+	// Prefix sums of the per-chunk counts give the global numbering.
+	vector<uint32_t> vertexBases(numChunks + 1, 0), normalBases(numChunks + 1, 0);
+	vector<size_t> indexBases(numChunks + 1, 0);
+	auto numTexc = 0u;
+	for (auto i = 0u; i < numChunks; ++i)
+	{
+		vertexBases[i + 1] = vertexBases[i] + static_cast<uint32_t>(chunks[i].Positions.size());
+		normalBases[i + 1] = normalBases[i] + static_cast<uint32_t>(chunks[i].Normals.size());
+		indexBases[i + 1] = indexBases[i] + chunks[i].Indices.size();
+		numTexc += chunks[i].NumTexc;
+	}
+
+	// Interleave the vertices in the same layout as the two-pass import.
+	const auto numVert = vertexBases[numChunks];
+	numNorm = normalBases[numChunks];
+	m_stride += m_stride <= sizeof(float3) && numNorm ? sizeof(float3) : 0;
+	m_stride += numTexc ? sizeof(float[2]) : 0;
+	m_vertices.clear();
+	m_vertices.resize(m_stride * numVert);
+
+	vector<float3> normals;
+	vector<uint32_t> nIndices;
+	if (numChunks == 1)
+	{
+		m_indices = move(chunks[0].Indices);
+		nIndices = move(chunks[0].NIndices);
+		normals = move(chunks[0].Normals);
+	}
+	else
+	{
+		m_indices.resize(indexBases[numChunks]);
+		nIndices.resize(indexBases[numChunks]);
+		normals.resize(numNorm);
+	}
+
+	parallelFor(numChunks, numThreads, [&](uint32_t i)
+	{
+		auto& chunk = chunks[i];
+		const auto numPositions = static_cast<uint32_t>(chunk.Positions.size());
+		for (auto j = 0u; j < numPositions; ++j) getPosition(vertexBases[i] + j) = chunk.Positions[j];
+		if (numChunks == 1) return;
+
+		for (const auto& slot : chunk.RelIndices) chunk.Indices[slot] += vertexBases[i];
+		for (const auto& slot : chunk.RelNIndices) chunk.NIndices[slot] += normalBases[i];
+		copy(chunk.Indices.cbegin(), chunk.Indices.cend(), m_indices.begin() + indexBases[i]);
+		copy(chunk.NIndices.cbegin(), chunk.NIndices.cend(), nIndices.begin() + indexBases[i]);
+		copy(chunk.Normals.cbegin(), chunk.Normals.cend(), normals.begin() + normalBases[i]);
+	});
+	chunks.clear();
+
+	computePerVertexNormals(normals, nIndices);
+
+	if ((forDX && !swapYZ) || (!forDX && swapYZ)) reverse(m_indices.begin(), m_indices.end());
+}
+
+void ObjLoader::parseChunk(const char* pData, const char* pEnd, Chunk& chunk, bool forDX, bool swapYZ)
+{
+	auto& positions = chunk.Positions;
+	auto& normals = chunk.Normals;
+	auto& indices = chunk.Indices;
+	auto& nIndices = chunk.NIndices;
+	chunk.NumTexc = 0;
+
+	// Grow the arrays by an estimate from the chunk size to limit reallocations.
+	const auto size = static_cast<size_t>(pEnd - pData);
+	positions.reserve(size / 96);
+	indices.reserve(size / 32);
+
+	for (auto p = pData; p < pEnd; ++p)
+	{
+		skipBlanks(p, pEnd);
+		if (p + 1 >= pEnd)
+		{
+			skipLine(p, pEnd);
+			continue;
+		}
+
+		if (p[0] == 'v' && isBlank(p[1])) // v
+		{
+			float3 v;
+			++p;
+			if (parseFloat3(p, pEnd, v, forDX, swapYZ)) positions.push_back(v);
+		}
+		else if (p[0] == 'v' && p[1] == 'n') // vn
+		{
+			float3 n;
+			p += 2;
+			if (parseFloat3(p, pEnd, n, forDX, swapYZ)) normals.push_back(n);
+		}
+		else if (p[0] == 'v' && p[1] == 't') ++chunk.NumTexc; // vt
+		else if (p[0] == 'f' && isBlank(p[1])) // v, v//vn, v/vt, or v/vt/vn, as a triangle fan
+		{
+			uint32_t v[3], vn[3] = {};
+			bool isRel[3] = {}, isNRel[3] = {};
+			auto numCorners = 0u;
+			++p;
+			for (;;)
+			{
+				int64_t i;
+				skipBlanks(p, pEnd);
+				if (!parseInt(p, pEnd, i)) break;
+
+				const auto corner = (min)(numCorners++, 2u);
+				v[corner] = resolveIndex(i, positions.size());
+				isRel[corner] = i < 0;
+				if (p < pEnd && *p == '/')
+				{
+					if (++p < pEnd && *p != '/') parseInt(p, pEnd, i);	// Texcoords are not imported
+					if (p < pEnd && *p == '/' && parseInt(++p, pEnd, i))
+					{
+						vn[corner] = resolveIndex(i, normals.size());
+						isNRel[corner] = i < 0;
+					}
+				}
+
+				if (numCorners >= 3)
+				{
+					for (uint8_t j = 0; j < 3; ++j)
+					{
+						if (isRel[j]) chunk.RelIndices.push_back(static_cast<uint32_t>(indices.size()));
+						if (isNRel[j]) chunk.RelNIndices.push_back(static_cast<uint32_t>(nIndices.size()));
+						indices.push_back(v[j]);
+						nIndices.push_back(vn[j]);
+					}
+					v[1] = v[2];
+					vn[1] = vn[2];
+					isRel[1] = isRel[2];
+					isNRel[1] = isNRel[2];
+				}
+			}
+		}
+
+		skipLine(p, pEnd);
+	}
+}
+
 void ObjLoader::importGeometryFirstPass(FILE* pFile, uint32_t& numTexc, uint32_t& numNorm)
 {
 	auto v = 0u;
@@ -334,85 +1652,201 @@ void ObjLoader::computePerVertexNormals(const vector<float3>& normals, const vec
 	m_vertices.shrink_to_fit();
 }
 
-void ObjLoader::recomputeNormals()
+void ObjLoader::recomputeNormals(uint32_t numThreads)
 {
-	float3 e1, e2, n;
+	const auto numTri = GetNumIndices() / 3;
+	const auto numVert = GetNumVertices();
 
-	const auto numTri = static_cast<uint32_t>(m_indices.size()) / 3;
-	for (auto i = 0u; i < numTri; i++)
+	// Blocks of at least minItemsPerThread triangles; they depend on the mesh only, so
+	// the normals are the same for any number of threads. Each block accumulates the
+	// face normals of its triangles into its own partial sums (x, y, z, 0 per vertex)
+	// over the index range that the triangles reference. The sums are padded to whole
+	// SIMD vectors of vertices. Normals follow positions, so loading 4 floats from a
+	// position is safe.
+	const auto numBlocks = (max)(numTri / minItemsPerThread, 1u);
+	vector<vector<float>> partials(numBlocks);
+	vector<uint32_t> partialBases(numBlocks, 0);
+	parallelFor(numBlocks, numThreads, [&](uint32_t b)
 	{
-		const auto pv0 = &getPosition(m_indices[i * 3]);
-		const auto pv1 = &getPosition(m_indices[i * 3 + 1]);
-		const auto pv2 = &getPosition(m_indices[i * 3 + 2]);
-		e1.x = pv1->x - pv0->x;
-		e1.y = pv1->y - pv0->y;
-		e1.z = pv1->z - pv0->z;
-		e2.x = pv2->x - pv1->x;
-		e2.y = pv2->y - pv1->y;
-		e2.z = pv2->z - pv1->z;
-		n.x = e1.y * e2.z - e1.z * e2.y;
-		n.y = e1.z * e2.x - e1.x * e2.z;
-		n.z = e1.x * e2.y - e1.y * e2.x;
-		const auto l = sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
-		n.x /= l;
-		n.y /= l;
-		n.z /= l;
+		const auto begin = static_cast<uint32_t>(static_cast<uint64_t>(numTri) * b / numBlocks);
+		const auto end = static_cast<uint32_t>(static_cast<uint64_t>(numTri) * (b + 1) / numBlocks);
+		auto count = numVert;
+		if (numBlocks > 1)
+		{
+			const auto minMax = minmax_element(&m_indices[begin * 3], &m_indices[end * 3]);
+			partialBases[b] = *minMax.first;
+			count = *minMax.second - *minMax.first + 1;
+		}
+		partials[b].resize((static_cast<size_t>(count) + 3) / 4 * 16);
+		const auto pSums = partials[b].data() - static_cast<size_t>(partialBases[b]) * 4;
 
-		const auto pVn0 = &getNormal(m_indices[i * 3]);
-		const auto pVn1 = &getNormal(m_indices[i * 3 + 1]);
-		const auto pVn2 = &getNormal(m_indices[i * 3 + 2]);
-		pVn0->x += n.x;
-		pVn0->y += n.y;
-		pVn0->z += n.z;
-		pVn1->x += n.x;
-		pVn1->y += n.y;
-		pVn1->z += n.z;
-		pVn2->x += n.x;
-		pVn2->y += n.y;
-		pVn2->z += n.z;
-	}
+		auto i = begin;
+#ifdef XUSG_OBJ_SSE2
+		// 4 triangles at a time, transposed to SoA
+		for (; i + 4 <= end; i += 4)
+		{
+			const auto pIdx = &m_indices[i * 3];
+			__m128 p[3][4];
+			for (uint8_t j = 0; j < 3; ++j)
+			{
+				for (uint8_t k = 0; k < 4; ++k) p[j][k] = _mm_loadu_ps(&getPosition(pIdx[k * 3 + j]).x);
+				_MM_TRANSPOSE4_PS(p[j][0], p[j][1], p[j][2], p[j][3]);
+			}
 
-	const auto numVert = GetNumVertices();
-	for (auto i = 0u; i < numVert; ++i)
+			const auto e1x = _mm_sub_ps(p[1][0], p[0][0]), e1y = _mm_sub_ps(p[1][1], p[0][1]), e1z = _mm_sub_ps(p[1][2], p[0][2]);
+			const auto e2x = _mm_sub_ps(p[2][0], p[1][0]), e2y = _mm_sub_ps(p[2][1], p[1][1]), e2z = _mm_sub_ps(p[2][2], p[1][2]);
+			__m128 n[] =
+			{
+				_mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y)),
+				_mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z)),
+				_mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x)),
+				_mm_setzero_ps()
+			};
+
+			// Degenerate triangles contribute nothing.
+			const auto l = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(n[0], n[0]), _mm_mul_ps(n[1], n[1])), _mm_mul_ps(n[2], n[2])));
+			const auto mask = _mm_cmpgt_ps(l, _mm_setzero_ps());
+			for (uint8_t c = 0; c < 3; ++c) n[c] = _mm_and_ps(_mm_div_ps(n[c], l), mask);
+
+			// Back to a normal per triangle
+			_MM_TRANSPOSE4_PS(n[0], n[1], n[2], n[3]);
+			for (uint8_t k = 0; k < 4; ++k)
+				for (uint8_t j = 0; j < 3; ++j)
+				{
+					const auto pSum = &pSums[pIdx[k * 3 + j] * 4];
+					_mm_storeu_ps(pSum, _mm_add_ps(_mm_loadu_ps(pSum), n[k]));
+				}
+		}
+#endif
+		for (; i < end; ++i)
+		{
+			const auto pTri = &m_indices[i * 3];
+			const auto& p0 = getPosition(pTri[0]);
+			const auto& p1 = getPosition(pTri[1]);
+			const auto& p2 = getPosition(pTri[2]);
+			const float3 e1(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+			const float3 e2(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z);
+			const float n[] = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+			const auto l = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (l > 0.0f)
+				for (uint8_t j = 0; j < 3; ++j)
+					for (uint8_t c = 0; c < 3; ++c) pSums[pTri[j] * 4 + c] += n[c] / l;
+		}
+	});
+
+	// Reduce the partial sums in block order and normalize, over vertex ranges that
+	// do not change the per-vertex results; vertices without triangles keep zero normals.
+	numThreads = (max)((min)(numThreads, numVert / minItemsPerThread), 1u);
+	parallelFor(numThreads, numThreads, [&](uint32_t t)
 	{
-		const auto pVn = &getNormal(i);
-		const auto l = sqrt(pVn->x * pVn->x + pVn->y * pVn->y + pVn->z * pVn->z);
-		pVn->x /= l;
-		pVn->y /= l;
-		pVn->z /= l;
-	}
+		const auto begin = static_cast<uint32_t>(static_cast<uint64_t>(numVert) * t / numThreads);
+		const auto end = static_cast<uint32_t>(static_cast<uint64_t>(numVert) * (t + 1) / numThreads);
+		vector<float> sums;
+		if (numBlocks > 1) sums.resize((static_cast<size_t>(end - begin) + 3) / 4 * 16);
+		for (auto j = 0u; j < numBlocks && numBlocks > 1; ++j)
+		{
+			const auto first = (max)(begin, partialBases[j]);
+			const auto last = static_cast<uint32_t>((min)(static_cast<size_t>(end), partialBases[j] + partials[j].size() / 4));
+			const auto pSrc = &partials[j][(static_cast<size_t>(first) - partialBases[j]) * 4];
+			const auto pDst = &sums[(static_cast<size_t>(first) - begin) * 4];
+			for (auto i = 0u; first + i < last; ++i)
+			{
+#ifdef XUSG_OBJ_SSE2
+				_mm_storeu_ps(&pDst[i * 4], _mm_add_ps(_mm_loadu_ps(&pDst[i * 4]), _mm_loadu_ps(&pSrc[i * 4])));
+#else
+				for (uint8_t c = 0; c < 3; ++c) pDst[i * 4 + c] += pSrc[i * 4 + c];
+#endif
+			}
+		}
+
+		for (auto i = begin; i < end; i += 4)
+		{
+			alignas(16) float n[4][4];
+			const auto pSums = numBlocks > 1 ? &sums[(i - begin) * 4] : &partials[0][i * 4];
+#ifdef XUSG_OBJ_SSE2
+			// 4 vertices at a time, transposed to SoA
+			__m128 v[4];
+			for (uint8_t k = 0; k < 4; ++k) v[k] = _mm_loadu_ps(&pSums[k * 4]);
+			_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+			const auto l = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v[0], v[0]), _mm_mul_ps(v[1], v[1])), _mm_mul_ps(v[2], v[2])));
+			const auto mask = _mm_cmpgt_ps(l, _mm_setzero_ps());
+			for (uint8_t c = 0; c < 3; ++c) v[c] = _mm_and_ps(_mm_div_ps(v[c], l), mask);
+			_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+			for (uint8_t k = 0; k < 4; ++k) _mm_store_ps(n[k], v[k]);
+#else
+			for (uint8_t k = 0; k < 4; ++k)
+			{
+				const auto pSum = &pSums[k * 4];
+				const auto l = sqrt(pSum[0] * pSum[0] + pSum[1] * pSum[1] + pSum[2] * pSum[2]);
+				for (uint8_t c = 0; c < 3; ++c) n[k][c] = l > 0.0f ? pSum[c] / l : 0.0f;
+			}
+#endif
+			const auto numLanes = (min)(end - i, 4u);
+			for (auto k = 0u; k < numLanes; ++k) getNormal(i + k) = float3(n[k]);
+		}
+	});
 }
 
-void ObjLoader::computeAABB()
+void ObjLoader::computeAABB(uint32_t numThreads)
 {
-	float xMax, xMin, yMax, yMin, zMax, zMin;
-	const auto& p = getPosition(0);
-	xMax = xMin = p.x;
-	yMax = yMin = p.y;
-	zMax = zMin = p.z;
+	const auto numVert = GetNumVertices();
+	if (numVert == 0)
+	{
+		m_aabb.Min = m_aabb.Max = float3(0.0f, 0.0f, 0.0f);
 
-	auto x = 0.0f, y = 0.0f, z = 0.0f;
+		return;
+	}
 
-	const auto numVert = GetNumVertices();
-	for (auto i = 1u; i < numVert; ++i)
+	// Per-thread bounds of vertex ranges, then a reduction
+	numThreads = (max)((min)(numThreads, numVert / minItemsPerThread), 1u);
+	vector<AABB> partials(numThreads);
+	parallelFor(numThreads, numThreads, [&](uint32_t t)
 	{
-		const auto& p = getPosition(i);
-		x = p.x;
-		y = p.y;
-		z = p.z;
+		const auto begin = static_cast<uint32_t>(static_cast<uint64_t>(numVert) * t / numThreads);
+		const auto end = static_cast<uint32_t>(static_cast<uint64_t>(numVert) * (t + 1) / numThreads);
+		auto& aabb = partials[t];
+#ifdef XUSG_OBJ_SSE2
+		// Loads 4 floats per position, except for the last vertex of a position-only buffer
+		const auto loadPosition = [this](uint32_t i)
+		{
+			const auto& p = getPosition(i);
 
-		if (x < xMin) xMin = x;
-		else if (x > xMax) xMax = x;
+			return i + 1 < GetNumVertices() || m_stride > sizeof(float3) ?
+				_mm_loadu_ps(&p.x) : _mm_set_ps(0.0f, p.z, p.y, p.x);
+		};
 
-		if (y < yMin) yMin = y;
-		else if (y > yMax) yMax = y;
+		auto minPt = loadPosition(begin);
+		auto maxPt = minPt;
+		for (auto i = begin + 1; i < end; ++i)
+		{
+			const auto p = loadPosition(i);
+			minPt = _mm_min_ps(minPt, p);
+			maxPt = _mm_max_ps(maxPt, p);
+		}
 
-		if (z < zMin) zMin = z;
-		else if (z > zMax) zMax = z;
-	}
+		alignas(16) float bounds[2][4];
+		_mm_store_ps(bounds[0], minPt);
+		_mm_store_ps(bounds[1], maxPt);
+		aabb.Min = float3(bounds[0]);
+		aabb.Max = float3(bounds[1]);
+#else
+		aabb.Min = aabb.Max = getPosition(begin);
+		for (auto i = begin + 1; i < end; ++i)
+		{
+			const auto& p = getPosition(i);
+			aabb.Min = float3((min)(aabb.Min.x, p.x), (min)(aabb.Min.y, p.y), (min)(aabb.Min.z, p.z));
+			aabb.Max = float3((max)(aabb.Max.x, p.x), (max)(aabb.Max.y, p.y), (max)(aabb.Max.z, p.z));
+		}
+#endif
+	});
 
-	m_aabb.Min = float3(xMin, yMin, zMin);
-	m_aabb.Max = float3(xMax, yMax, zMax);
+	m_aabb = partials[0];
+	for (auto t = 1u; t < numThreads; ++t)
+	{
+		const auto& aabb = partials[t];
+		m_aabb.Min = float3((min)(m_aabb.Min.x, aabb.Min.x), (min)(m_aabb.Min.y, aabb.Min.y), (min)(m_aabb.Min.z, aabb.Min.z));
+		m_aabb.Max = float3((max)(m_aabb.Max.x, aabb.Max.x), (max)(m_aabb.Max.y, aabb.Max.y), (max)(m_aabb.Max.z, aabb.Max.z));
+	}
 }
 
 void* ObjLoader::getVertex(uint32_t i)
@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace XUSG
 {
 	class ObjLoader
@@ -18,8 +22,9 @@ namespace XUSG
 			float3() = default;
 			constexpr float3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
 			explicit float3(const float* pArray) : x(pArray[0]), y(pArray[1]), z(pArray[2]) {}
+			float3(const float3& Float3) = default;
 
-			float3& operator= (const float3& Float3) { x = Float3.x; y = Float3.y; z = Float3.z; return *this; }
+			float3& operator= (const float3& Float3) = default;
 		};
 
 		struct AABB
@@ -28,11 +33,103 @@ namespace XUSG
 			float3 Max;
 		};
 
+		// Octahedral normal encodings of the quantized vertex format
+		enum NormalEncoding : uint8_t
+		{
+			NORMAL_OCT16,	// R16G16B16A16_UNORM position + R16G16_SNORM normal, 12 bytes
+			NORMAL_OCT8		// R16G16B16A16_UNORM position with the 2 x SNORM8 normal in W, 8 bytes
+		};
+
+		struct QuantizationError
+		{
+			float MaxPosition;	// Object-space distance
+			float RMSPosition;
+			float MaxNormal;	// Angle in degrees
+			float RMSNormal;
+		};
+
+		// Simulated FIFO post-transform vertex cache efficiency
+		struct VertexCacheStats
+		{
+			float ACMR;	// Average cache miss ratio: vertex shader invocations per triangle
+			float ATVR;	// Average transform to vertex ratio: invocations per unique vertex
+		};
+
+		// Cluster of triangles, which are the contiguous index range from 3 * TriangleOffset.
+		// Its vertices are listed at VertexOffset of the meshlet vertices, and its local
+		// triangles (3 x uint8_t each) at 3 * TriangleOffset of the meshlet triangles.
+		struct Meshlet
+		{
+			uint32_t VertexOffset;
+			uint32_t VertexCount;
+			uint32_t TriangleOffset;
+			uint32_t TriangleCount;
+			float3 Center;		// Bounding sphere
+			float Radius;
+			float3 ConeAxis;	// Normal cone: all triangles face away from the eye when
+			float ConeCutoff;	// dot(Center - eye, ConeAxis) >= |Center - eye| * ConeCutoff + Radius
+		};
+
+		// Processing applied since the import, by the last call of each step; a Weld or an
+		// Optimize resets the steps after it, as they discard their results.
+		struct Processing
+		{
+			bool		Welded;
+			float		WeldEpsilon;
+			uint32_t	CacheSize;			// Of Optimize, or 0 if not optimized
+			uint32_t	MaxMeshletVertices;	// Of BuildMeshlets, or 0 without meshlets
+			uint32_t	MaxMeshletTriangles;
+		};
+
 		ObjLoader();
 		virtual ~ObjLoader();
 
-		bool Import(const char* pszFilename, bool needNorm = true,
-			bool needAABB = true, bool forDX = true, bool swapYZ = false);
+		// useCache loads the imported mesh from a binary sidecar (<file>.cache) when it
+		// matches the source file and flags, and writes the sidecar otherwise; the sidecar
+		// only ever holds the mesh as imported. numThreads = 0 parses large files on all
+		// hardware threads.
+		bool Import(const char* pszFilename, bool needNorm = true, bool needAABB = true,
+			bool forDX = true, bool swapYZ = false, bool useCache = false, uint32_t numThreads = 0);
+
+		// Loads the mesh written by UpdateCache (<file>.opt.cache) in place of Import with
+		// useCache, if it matches the source file, the flags, and the processing exactly;
+		// returns false otherwise, so that the caller imports and processes the mesh.
+		bool LoadProcessedCache(const char* pszFilename, const Processing& processing,
+			bool needNorm = true, bool forDX = true, bool swapYZ = false);
+
+		// Merges vertices whose attributes are all bit-identical (epsilon = 0) or within
+		// epsilon of each other, remaps the indices, and drops the triangles that become
+		// degenerate. Returns the number of vertices removed.
+		uint32_t Weld(float epsilon = 0.0f);
+
+		// Reorders the triangles for post-transform vertex cache locality (Tipsify), then
+		// the vertices in order of first use for vertex fetch locality
+		void Optimize(uint32_t cacheSize = 16, VertexCacheStats* pStatsBefore = nullptr,
+			VertexCacheStats* pStatsAfter = nullptr);
+		VertexCacheStats GetVertexCacheStats(uint32_t cacheSize = 16) const;
+
+		// Partitions the triangles in their current order into meshlets with bounding
+		// spheres and normal cones. Weld and Optimize discard the meshlets, so they go
+		// last. Returns the number of meshlets.
+		uint32_t BuildMeshlets(uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+
+		// Collects the meshlets that intersect the frustum and are not entirely back
+		// facing. The planes (a, b, c, d) hold ax + by + cz + d >= 0 inside, and the
+		// planes and the eye point are in object space. Returns the number visible.
+		static uint32_t CullMeshlets(const Meshlet* pMeshlets, uint32_t numMeshlets, const float planes[6][4],
+			const float3& eyePt, std::vector<uint32_t>& visible);
+
+		// Writes the current data, with the results of Weld, Optimize, and BuildMeshlets,
+		// to <file>.opt.cache, tagged with GetProcessing(), after an import with useCache.
+		// The cache of Import is left alone.
+		bool UpdateCache() const;
+
+		// Exports the vertices with positions quantized to 16 bits against the AABB, which
+		// dequantize as AABB.Min + p * (AABB.Max - AABB.Min), and octahedral normals.
+		// Requires normals and the AABB from the import. The error is only measured for pError.
+		bool Quantize(std::vector<uint8_t>& vertices, NormalEncoding encoding = NORMAL_OCT16,
+			QuantizationError* pError = nullptr) const;
+		static uint32_t GetQuantizedStride(NormalEncoding encoding);
 
 		const uint32_t GetNumVertices() const;
 		const uint32_t GetNumIndices() const;
@@ -40,16 +137,56 @@ namespace XUSG
 		const uint8_t* GetVertices() const;
 		const uint32_t* GetIndices() const;
 
+		const uint32_t GetNumMeshlets() const;
+		const Meshlet* GetMeshlets() const;
+		const uint32_t* GetMeshletVertices() const;
+		const uint8_t* GetMeshletTriangles() const;
+
 		const AABB& GetAABB() const;
+		const Processing& GetProcessing() const;
 
 	protected:
+		// Geometry of a line-aligned range of the file. Negative OBJ indices are
+		// resolved against the chunk only; the slots listed in RelIndices and
+		// RelNIndices are offset by the counts of the preceding chunks when merging.
+		struct Chunk
+		{
+			std::vector<float3>		Positions;
+			std::vector<float3>		Normals;
+			std::vector<uint32_t>	Indices;
+			std::vector<uint32_t>	NIndices;
+			std::vector<uint32_t>	RelIndices;
+			std::vector<uint32_t>	RelNIndices;
+			uint32_t				NumTexc;
+		};
+
+		// Identifies the source of a cache: file size, modification time, and import flags
+		struct CacheKey
+		{
+			uint64_t	FileSize;
+			int64_t		FileTime;
+			uint32_t	Flags;
+		};
+
+		// Without the processing, the cache of Import; with it, that of UpdateCache
+		bool loadCache(const char* pszFilename, const CacheKey& key, const Processing* pProcessing = nullptr);
+		bool saveCache(const char* pszFilename, const CacheKey& key, const Processing* pProcessing = nullptr) const;
+		static bool getCacheKey(const char* pszFilename, bool needNorm, bool forDX, bool swapYZ, CacheKey& key);
+
+		void reorderTriangles(uint32_t cacheSize);
+		void reorderVertices();
+		void computeMeshletBounds(Meshlet& meshlet);
+
+		void importGeometry(const char* pData, size_t size, uint32_t numThreads,
+			uint32_t& numNorm, bool forDX, bool swapYZ);
+		static void parseChunk(const char* pData, const char* pEnd, Chunk& chunk, bool forDX, bool swapYZ);
 		void importGeometryFirstPass(FILE* pFile, uint32_t& numTexc, uint32_t& numNorm);
 		void importGeometrySecondPass(FILE* pFile, uint32_t numTexc, uint32_t numNorm, bool forDX, bool swapYZ);
 		void loadIndices(FILE* pFile, uint32_t& numTri, uint32_t numTexc, uint32_t numNorm,
 			std::vector<uint32_t>& nIndices, std::vector<uint32_t>& tIndices);
 		void computePerVertexNormals(const std::vector<float3>& normals, const std::vector<uint32_t>& nIndices);
-		void recomputeNormals();
-		void computeAABB();
+		void recomputeNormals(uint32_t numThreads = 1);
+		void computeAABB(uint32_t numThreads = 1);
 
 		void* getVertex(uint32_t i);
 		float3& getPosition(uint32_t i);
@@ -58,8 +195,17 @@ namespace XUSG
 		std::vector<uint8_t>	m_vertices;
 		std::vector<uint32_t>	m_indices;
 
+		std::vector<Meshlet>	m_meshlets;
+		std::vector<uint32_t>	m_meshletVertices;
+		std::vector<uint8_t>	m_meshletTriangles;
+
 		uint32_t	m_stride;
 
 		AABB		m_aabb;
+
+		Processing	m_processing;
+
+		std::string	m_cacheFileName;
+		CacheKey	m_cacheKey;
 	};
 }
@@ -10,6 +10,10 @@
 #define SH_COEFFS shCoeffs
 #endif
 
+#ifndef SH_ORDER
+#define SH_ORDER 3
+#endif
+
 //--------------------------------------------------------------------------------------
 // SH irradiance evaluation using normal
 //--------------------------------------------------------------------------------------
@@ -24,20 +28,47 @@ float4 EvaluateSHIrradiance(T SH_COEFFS, float3 norm)
 	const float y = -norm.y;
 	const float z = norm.z;
 
-	const float3 irradiance = max(0.0,
-		(c1 * (x * x - y * y)) * shCoeffs[8]											// c1 * L22.(x^2 - y^2)
+	float3 irradiance = c4 * shCoeffs[0]												// c4 * L00 
+		+ 2.0 * c2 * (shCoeffs[3] * x + shCoeffs[1] * y + shCoeffs[2] * z);			// 2c2(L11.x + L1-1.y + L10.z)
+
+#if SH_ORDER > 2
+	irradiance += (c1 * (x * x - y * y)) * shCoeffs[8]									// c1 * L22.(x^2 - y^2)
 		+ (c3 * (3.0 * z * z - 1.0)) * shCoeffs[6]										// c3 * L20.(3z^2 - 1)
-		+ c4 * shCoeffs[0]																// c4 * L00 
-		+ 2.0 * c1 * (shCoeffs[4] * x * y + shCoeffs[7] * x * z + shCoeffs[5] * y * z)	// 2c1(L2-2.xy + L21.xz + L2-1.yz)
-		+ 2.0 * c2 * (shCoeffs[3] * x + shCoeffs[1] * y + shCoeffs[2] * z));			// 2c2(L11.x + L1-1.y + L10.z)
+		+ 2.0 * c1 * (shCoeffs[4] * x * y + shCoeffs[7] * x * z + shCoeffs[5] * y * z);	// 2c1(L2-2.xy + L21.xz + L2-1.yz)
+#endif
+
+	// No band 3, as in CPU::EvaluateSHIrradiance (SphericalHarmonics.cpp)
+#if SH_ORDER > 4
+	const float c5 = -0.32768682480684946;	// A4 * Y4-4 = -PI/24 * 3/4 * sqrt(35/PI)
+	const float c6 = -0.23170957592641145;	// A4 * Y4-3 = -PI/24 * 3/4 * sqrt(35/(2PI))
+	const float c7 = -0.12385397805018784;	// A4 * Y4-2 = -PI/24 * 3/4 * sqrt(5/PI)
+	const float c8 = -0.087577987756217626;	// A4 * Y4-1 = -PI/24 * 3/4 * sqrt(5/(2PI))
+	const float c9 = -0.013847295710199343;	// A4 * Y40 = -PI/24 * 3/16 * sqrt(1/PI)
+	const float c10 = -0.061926989025093922;	// A4 * Y42 = -PI/24 * 3/8 * sqrt(5/PI)
+	const float c11 = -0.081921706201712366;	// A4 * Y44 = -PI/24 * 3/16 * sqrt(35/PI)
+
+	const float x2 = x * x;
+	const float y2 = y * y;
+	const float z2 = z * z;
+	irradiance += (c5 * x * y * (x2 - y2)) * shCoeffs[16]								// c5 * L4-4.xy(x^2 - y^2)
+		+ (c6 * y * z * (3.0 * x2 - y2)) * shCoeffs[17]								// c6 * L4-3.yz(3x^2 - y^2)
+		+ (c7 * x * y * (7.0 * z2 - 1.0)) * shCoeffs[18]								// c7 * L4-2.xy(7z^2 - 1)
+		+ (c8 * y * z * (7.0 * z2 - 3.0)) * shCoeffs[19]								// c8 * L4-1.yz(7z^2 - 3)
+		+ (c9 * (z2 * (35.0 * z2 - 30.0) + 3.0)) * shCoeffs[20]						// c9 * L40.(35z^4 - 30z^2 + 3)
+		+ (c8 * x * z * (7.0 * z2 - 3.0)) * shCoeffs[21]								// c8 * L41.xz(7z^2 - 3)
+		+ (c10 * (x2 - y2) * (7.0 * z2 - 1.0)) * shCoeffs[22]							// c10 * L42.(x^2 - y^2)(7z^2 - 1)
+		+ (c6 * x * z * (x2 - 3.0 * y2)) * shCoeffs[23]								// c6 * L43.xz(x^2 - 3y^2)
+		+ (c11 * (x2 * (x2 - 3.0 * y2) - y2 * (3.0 * x2 - y2))) * shCoeffs[24];		// c11 * L44.(x^4 - 6x^2y^2 + y^4)
+#endif
 
 	const float avgLum = dot(shCoeffs[0], float3(0.25, 0.5, 0.25));
 
-	return float4(irradiance, avgLum);
+	return float4(max(irradiance, 0.0), avgLum);
 }
 
 //--------------------------------------------------------------------------------------
-// SH irradiance evaluation using tangent for hair
+// SH irradiance evaluation using tangent for hair (bands 0 to 2); SH_ORDER 2 has
+// no band-2 coefficients, so only bands 0 and 1 are evaluated then
 //--------------------------------------------------------------------------------------
 float4 EvaluateHairSHIrradiance(T SH_COEFFS, float3 tan)
 {
@@ -50,14 +81,16 @@ float4 EvaluateHairSHIrradiance(T SH_COEFFS, float3 tan)
 	const float y = -tan.y;
 	const float z = tan.z;
 
-	const float3 irradiance = max(0.0,
-		(c1 * (x * x - y * y)) * shCoeffs[8]											// c1 * L22.(x^2 - y^2)
+	float3 irradiance = c4 * shCoeffs[0]												// c4 * L00 
+		+ 2.0 * c2 * (shCoeffs[3] * x + shCoeffs[1] * y + shCoeffs[2] * z);			// 2c2(L11.x + L1-1.y + L10.z)
+
+#if SH_ORDER > 2
+	irradiance += (c1 * (x * x - y * y)) * shCoeffs[8]									// c1 * L22.(x^2 - y^2)
 		+ (c3 * (3.0 * z * z - 1.0)) * shCoeffs[6]										// c3 * L20.(3z^2 - 1)
-		+ c4 * shCoeffs[0]																// c4 * L00 
-		+ 2.0 * c1 * (shCoeffs[4] * x * y + shCoeffs[7] * x * z + shCoeffs[5] * y * z)	// 2c1(L2-2.xy + L21.xz + L2-1.yz)
-		+ 2.0 * c2 * (shCoeffs[3] * x + shCoeffs[1] * y + shCoeffs[2] * z));			// 2c2(L11.x + L1-1.y + L10.z)
+		+ 2.0 * c1 * (shCoeffs[4] * x * y + shCoeffs[7] * x * z + shCoeffs[5] * y * z);	// 2c1(L2-2.xy + L21.xz + L2-1.yz)
+#endif
 
 	const float avgLum = dot(shCoeffs[0], float3(0.25, 0.5, 0.25));
 
-	return float4(irradiance, avgLum);
+	return float4(max(irradiance, 0.0), avgLum);
 }
@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// The box downsampler of the mip chain
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include "CPU/BoxFilter.h"
+#include "TestUtils.h"
+
+using namespace std;
+using namespace CPU;
+
+static vector<float> randomFace(uint32_t size)
+{
+	vector<float> face(static_cast<size_t>(size) * size);
+	auto seed = size;
+	for (auto& value : face)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		value = (seed >> 8) * (1.0f / 16777216.0f);
+	}
+
+	return face;
+}
+
+TEST(BoxFilter, ScalarAveragesQuads)
+{
+	static const auto srcSize = 6u;
+	const auto src = randomFace(srcSize);
+
+	vector<float> dst(srcSize / 2 * srcSize / 2);
+	BoxDownsampleScalar(dst.data(), src.data(), srcSize, 0, srcSize / 2);
+	for (auto y = 0u; y < srcSize / 2; ++y)
+		for (auto x = 0u; x < srcSize / 2; ++x)
+		{
+			const auto p = &src[y * 2 * srcSize + x * 2];
+			EXPECT_FLOAT_EQ((p[0] + p[1] + p[srcSize] + p[srcSize + 1]) * 0.25f, dst[y * srcSize / 2 + x]);
+		}
+}
+
+TEST(BoxFilter, SIMDMatchesScalar)
+{
+	if (GetNativeISA() == ISA::SCALAR) GTEST_SKIP() << "No SIMD instruction set on this processor";
+
+	// Sizes around the SIMD width, including rows with a remainder
+	for (const auto srcSize : { 2u, 6u, 16u, 18u, 34u, 64u, 130u })
+	{
+		const auto dstSize = srcSize / 2;
+		const auto src = randomFace(srcSize);
+
+		vector<float> expected(static_cast<size_t>(dstSize) * dstSize), result(expected.size());
+		BoxDownsampleScalar(expected.data(), src.data(), srcSize, 0, dstSize);
+		BoxDownsample(result.data(), src.data(), srcSize, GetNativeISA());
+		EXPECT_EQ(0, memcmp(expected.data(), result.data(), sizeof(float) * expected.size())) << "size " << srcSize;
+	}
+}
+
+TEST(BoxFilter, CubeLevelsMustHalve)
+{
+	CubeMap src, dst;
+	ASSERT_TRUE(src.Create(16, 0));
+	ASSERT_TRUE(dst.Create(16, 0));
+	TestUtils::FillRandom(src, 16);
+
+	EXPECT_TRUE(BoxDownsample(dst, 1, src, 0));
+	EXPECT_FALSE(BoxDownsample(dst, 2, src, 0));
+	EXPECT_FALSE(BoxDownsample(dst, 0, src, 0));
+
+	const auto dstSize = dst.GetSize(1);
+	vector<float> expected(static_cast<size_t>(dstSize) * dstSize);
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+		{
+			BoxDownsampleScalar(expected.data(), src.GetPlane(0, s, c), 16, 0, dstSize);
+			EXPECT_EQ(0, memcmp(expected.data(), dst.GetPlane(1, s, c), sizeof(float) * expected.size()));
+		}
+}
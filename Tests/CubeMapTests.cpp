@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// The per-row direction and solid angle tables of the cube faces
+//--------------------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include "CPU/CubeMap.h"
+
+using namespace std;
+using namespace CPU;
+
+TEST(CubeRowLUT, SIMDMatchesScalar)
+{
+	if (GetNativeISA() == ISA::SCALAR) GTEST_SKIP() << "No SIMD instruction set on this processor";
+
+	for (const auto size : { 1u, 3u, 7u, 8u, 9u, 17u, 32u, 127u })
+	{
+		CubeRowLUT lut;
+		ASSERT_TRUE(lut.Init(size));
+
+		vector<float> expected(static_cast<size_t>(size) * 3), result(expected.size());
+		float* const pExpected[] = { expected.data(), expected.data() + size, expected.data() + size * 2 };
+		float* const pResult[] = { result.data(), result.data() + size, result.data() + size * 2 };
+		for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+			for (auto y = 0u; y < size; ++y)
+				for (const auto xBegin : { 0u, size / 3 })
+				{
+					const auto count = size - xBegin;
+					lut.GetDirections(s, y, xBegin, size, pExpected, ISA::SCALAR);
+					lut.GetDirections(s, y, xBegin, size, pResult, GetNativeISA());
+					for (uint8_t c = 0; c < 3; ++c)
+						ASSERT_EQ(0, memcmp(pExpected[c], pResult[c], sizeof(float) * count))
+							<< "size " << size << ", face " << static_cast<int>(s) << ", row " << y;
+				}
+	}
+}
+
+TEST(CubeRowLUT, MatchesGetCubeTexcoord)
+{
+	static const auto size = 24u;
+	CubeRowLUT lut;
+	ASSERT_TRUE(lut.Init(size));
+
+	vector<float> dirs(size * 3);
+	float* const pDirs[] = { dirs.data(), dirs.data() + size, dirs.data() + size * 2 };
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto y = 0u; y < size; ++y)
+		{
+			lut.GetDirections(s, y, 0, size, pDirs);
+			for (auto x = 0u; x < size; ++x)
+			{
+				const auto texcoord = GetCubeTexcoord(x, y, s, size);
+				const auto len = sqrt(texcoord.x * texcoord.x + texcoord.y * texcoord.y + texcoord.z * texcoord.z);
+				EXPECT_NEAR(texcoord.x / len, pDirs[0][x], 1.0e-6f);
+				EXPECT_NEAR(texcoord.y / len, pDirs[1][x], 1.0e-6f);
+				EXPECT_NEAR(texcoord.z / len, pDirs[2][x], 1.0e-6f);
+				EXPECT_EQ(GetCubeTexelSolidAngle(x, y, size), lut.GetSolidAngles(y)[x]);
+			}
+		}
+}
@@ -0,0 +1,209 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// The reference irradiance against the checked-in <env>_gt.dds, and the Monte Carlo
+// estimate against the reference
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+#include "CPU/IrradianceGT.h"
+#include "CPU/IrradianceMC.h"
+#include "Optional/XUSGDDSReader.h"
+#include "TestUtils.h"
+
+using namespace std;
+using namespace CPU;
+
+static bool loadCubeMap(const string& fileName, CubeMap& cubeMap)
+{
+	XUSG::DDS::Reader reader;
+
+	return reader.Open(fileName.c_str()) && cubeMap.Create(reader, 1);
+}
+
+TEST(IrradianceGT, MatchesBakedFile)
+{
+	// The ground truth at a coarse size, against the baked level 0 sampled at the same
+	// directions; the baked file is BC6H, so only matches to its compression error.
+	static const auto size = 16u;
+	static const auto tolerance = 0.01f;
+
+	const auto fileName = TestUtils::GetAssetPath("uffizi_cross.dds");
+	CubeMap radiance, baked;
+	ASSERT_TRUE(loadCubeMap(fileName, radiance));
+	ASSERT_TRUE(loadCubeMap(fileName + "_gt.dds", baked));
+
+	IrradianceGT convolver;
+	CubeMap irradiance;
+	ASSERT_TRUE(convolver.Init());
+	ASSERT_TRUE(irradiance.Create(size));
+	ASSERT_TRUE(convolver.Convolve(radiance, irradiance));
+
+	auto maxError = 0.0f;
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto y = 0u; y < size; ++y)
+			for (auto x = 0u; x < size; ++x)
+			{
+				const auto expected = baked.SampleLevel(GetCubeTexcoord(x, y, s, size), 0);
+				const auto result = irradiance.Load(0, s, x, y);
+				const auto scale = (max)((max)(expected.x, expected.y), (max)(expected.z, 1.0e-3f));
+				maxError = (max)(maxError, fabs(result.x - expected.x) / scale);
+				maxError = (max)(maxError, fabs(result.y - expected.y) / scale);
+				maxError = (max)(maxError, fabs(result.z - expected.z) / scale);
+			}
+	EXPECT_LT(maxError, tolerance);
+	RecordProperty("MaxRelativeError", to_string(maxError));
+}
+
+//--------------------------------------------------------------------------------------
+// Monte Carlo estimate
+//--------------------------------------------------------------------------------------
+
+static float getLuminance(const float3& color)
+{
+	return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+}
+
+static void expectSameLevel0(const CubeMap& expected, const CubeMap& result)
+{
+	ASSERT_EQ(expected.GetSize(), result.GetSize());
+	const auto count = static_cast<size_t>(expected.GetSize()) * expected.GetSize();
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+			EXPECT_EQ(0, memcmp(expected.GetPlane(0, s, c), result.GetPlane(0, s, c), sizeof(float) * count))
+				<< "face " << static_cast<int>(s) << ", channel " << static_cast<int>(c);
+}
+
+// The loose bound is for the luminance: the standard error that the tolerance targets is
+// 0.5%, and the largest error across the texels is a few times that.
+TEST(IrradianceMC, MatchesGroundTruth)
+{
+	static const auto size = 16u;
+	static const auto tolerance = 0.005f;
+	static const auto maxError = 0.05f;
+
+	CubeMap radiance;
+	ASSERT_TRUE(loadCubeMap(TestUtils::GetAssetPath("grace_cross.dds"), radiance));
+
+	IrradianceGT convolver;
+	CubeMap expected;
+	ASSERT_TRUE(convolver.Init());
+	ASSERT_TRUE(expected.Create(size));
+	ASSERT_TRUE(convolver.Convolve(radiance, expected));
+
+	IrradianceMC integrator;
+	CubeMap irradiance;
+	ASSERT_TRUE(integrator.Init());
+	ASSERT_TRUE(irradiance.Create(size));
+	ASSERT_TRUE(integrator.Convolve(radiance, irradiance, 0, tolerance));
+
+	auto error = 0.0f;
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto y = 0u; y < size; ++y)
+			for (auto x = 0u; x < size; ++x)
+			{
+				const auto reference = getLuminance(expected.Load(0, s, x, y));
+				const auto result = getLuminance(irradiance.Load(0, s, x, y));
+				error = (max)(error, fabs(result - reference) / reference);
+			}
+	EXPECT_LT(error, maxError);
+	RecordProperty("MaxRelativeError", to_string(error));
+}
+
+// Texels are seeded by their position, so the estimate and the sample counts do not
+// depend on the scheduler.
+TEST(IrradianceMC, IndependentOfThreads)
+{
+	static const auto size = 8u;
+
+	CubeMap radiance;
+	ASSERT_TRUE(loadCubeMap(TestUtils::GetAssetPath("grace_cross.dds"), radiance));
+
+	CubeMap expected;
+	vector<float> expectedCounts;
+	for (const auto numThreads : { 1u, 4u })
+	{
+		SCOPED_TRACE(numThreads);
+		const auto scheduler = make_shared<Scheduler>();
+		ASSERT_TRUE(scheduler->Init(numThreads));
+
+		IrradianceMC integrator;
+		CubeMap irradiance;
+		ASSERT_TRUE(integrator.Init(scheduler));
+		ASSERT_TRUE(irradiance.Create(size));
+		ASSERT_TRUE(integrator.Convolve(radiance, irradiance, 0, 0.02f));
+
+		vector<float> counts;
+		for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+			counts.insert(counts.end(), integrator.GetSampleCounts(s), integrator.GetSampleCounts(s) + size * size);
+
+		if (numThreads == 1)
+		{
+			ASSERT_TRUE(expected.Create(size));
+			for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+				for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+					memcpy(expected.GetPlane(0, s, c), irradiance.GetPlane(0, s, c), sizeof(float) * size * size);
+			expectedCounts = counts;
+		}
+		else
+		{
+			expectSameLevel0(expected, irradiance);
+			EXPECT_TRUE(expectedCounts == counts);
+		}
+	}
+}
+
+// Texels stop at the first batch within the tolerance, or at maxSamples, and the sample
+// count image adds up to the total.
+TEST(IrradianceMC, StopsEarly)
+{
+	static const auto size = 8u;
+	static const auto maxSamples = 1024u;
+	const uint32_t batchSize = IrradianceMC::BatchSize;
+
+	CubeMap radiance;
+	ASSERT_TRUE(loadCubeMap(TestUtils::GetAssetPath("grace_cross.dds"), radiance));
+
+	IrradianceMC integrator;
+	CubeMap irradiance;
+	ASSERT_TRUE(integrator.Init());
+	ASSERT_TRUE(irradiance.Create(size));
+
+	uint64_t totals[3];
+	const float tolerances[] = { 0.0f, 0.01f, 0.1f };
+	for (auto i = 0u; i < 3; ++i)
+	{
+		SCOPED_TRACE(tolerances[i]);
+		ASSERT_TRUE(integrator.Convolve(radiance, irradiance, 0, tolerances[i], maxSamples));
+		EXPECT_EQ(nullptr, integrator.GetSampleCounts(CubeMap::FaceCount));
+
+		uint64_t total = 0;
+		for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		{
+			const auto pCounts = integrator.GetSampleCounts(s);
+			ASSERT_NE(nullptr, pCounts);
+			for (auto j = 0u; j < size * size; ++j)
+			{
+				const auto count = static_cast<uint32_t>(pCounts[j]);
+				EXPECT_EQ(static_cast<float>(count), pCounts[j]);
+				EXPECT_EQ(0u, count % batchSize);
+				EXPECT_GE(count, batchSize);
+				EXPECT_LE(count, maxSamples);
+				if (tolerances[i] == 0.0f) EXPECT_EQ(maxSamples, count);
+				total += count;
+			}
+		}
+		EXPECT_EQ(total, integrator.GetTotalSampleCount());
+		totals[i] = total;
+	}
+
+	EXPECT_LT(totals[1], totals[0]);
+	EXPECT_LT(totals[2], totals[1]);
+}
@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// The CPU light probe
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <memory>
+#include <gtest/gtest.h>
+#include "CPU/LightProbe.h"
+#include "TestUtils.h"
+
+using namespace std;
+using namespace CPU;
+
+static void processLightProbe(const CubeMap::sptr& radiance, LightProbe::UpsampleMode upsampleMode,
+	const Scheduler::sptr& scheduler, LightProbe& lightProbe)
+{
+	ASSERT_TRUE(lightProbe.Init(&radiance, 1, upsampleMode, scheduler));
+	lightProbe.UpdateFrame(0.0);
+	lightProbe.Process();
+}
+
+static void expectSameLevel0(const CubeMap& expected, const CubeMap& result)
+{
+	ASSERT_EQ(expected.GetSize(), result.GetSize());
+	const auto count = static_cast<size_t>(expected.GetSize()) * expected.GetSize();
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+			EXPECT_EQ(0, memcmp(expected.GetPlane(0, s, c), result.GetPlane(0, s, c), sizeof(float) * count))
+				<< "size " << expected.GetSize() << ", face " << static_cast<int>(s) << ", channel " << static_cast<int>(c);
+}
+
+TEST(LightProbe, RejectsSingleTexelFaces)
+{
+	const auto radiance = make_shared<CubeMap>();
+	ASSERT_TRUE(radiance->Create(1));
+
+	LightProbe lightProbe;
+	EXPECT_FALSE(lightProbe.Init(&radiance, 1));
+
+	// The largest source counts.
+	const auto larger = make_shared<CubeMap>();
+	ASSERT_TRUE(larger->Create(4));
+	const CubeMap::sptr sources[] = { radiance, larger };
+	EXPECT_TRUE(lightProbe.Init(sources, 2));
+	EXPECT_EQ(4u, lightProbe.GetIrradiance()->GetSize());
+	EXPECT_EQ(3u, lightProbe.GetIrradiance()->GetNumMips());
+}
+
+TEST(LightProbe, FusedMatchesPerLevelAtLevel0)
+{
+	// Sizes with a single band per face, several bands, and faces narrower than the borders,
+	// on 1 and 4 threads
+	for (const auto numThreads : { 1u, 4u })
+	{
+		const auto scheduler = make_shared<Scheduler>();
+		ASSERT_TRUE(scheduler->Init(numThreads));
+
+		for (const auto size : { 2u, 8u, 64u, 96u, 256u })
+		{
+			const auto radiance = make_shared<CubeMap>();
+			ASSERT_TRUE(radiance->Create(size));
+			TestUtils::FillRandom(*radiance, size);
+
+			LightProbe perLevel, fused;
+			processLightProbe(radiance, LightProbe::UPSAMPLE_PER_LEVEL, scheduler, perLevel);
+			processLightProbe(radiance, LightProbe::UPSAMPLE_FUSED, scheduler, fused);
+			expectSameLevel0(*perLevel.GetIrradiance(), *fused.GetIrradiance());
+		}
+	}
+}
@@ -0,0 +1,98 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// The MipCos weight tables
+//--------------------------------------------------------------------------------------
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include "CPU/MipCosine.h"
+
+using namespace std;
+using namespace CPU;
+
+// MipCosineBlendWeight with the standard library math
+static double referenceWeight(double s, uint8_t numLevels, uint8_t level, bool preintegrated)
+{
+	const auto pi = 3.14159265358979323846;
+	const auto a = pi / (s * 4.0);
+
+	if (preintegrated)
+	{
+		const auto x = exp2(level) * a;
+		const auto numerator = exp2(level * 3) * pi * pi * pi * sin(x) * log(2.0);
+		const auto denormC = (128.0 * s * s * s - exp2(level * 2 + 4) * s * pi * pi) * cos(x);
+		const auto denormS = exp2(level + 5) * s * s * pi * sin(x);
+
+		return numerator / (denormC - denormS + 64.0 * s * s * s * pi);
+	}
+
+	auto wsum = 0.0;
+	for (auto i = level; i < numLevels; ++i) wsum += exp2(i * 3) * sin(exp2(i) * a);
+
+	return wsum > 0.0 ? exp2(level * 3) * sin(exp2(level) * a) / wsum : 1.0;
+}
+
+static void expectReferenceWeights(float mapSize, uint8_t numLevels)
+{
+	for (const auto preintegrated : { false, true })
+	{
+		const auto weights = GetMipCosineWeights(mapSize, numLevels, preintegrated);
+		for (uint8_t i = 0; i < numLevels; ++i)
+		{
+			const auto expected = referenceWeight(mapSize, numLevels, i, preintegrated);
+			EXPECT_NEAR(expected, weights.Weights[i], fabs(expected) * 1.0e-6 + 1.0e-9)
+				<< "size " << mapSize << ", " << static_cast<int>(numLevels) << " levels, level " << static_cast<int>(i)
+				<< (preintegrated ? ", preintegrated" : "");
+		}
+
+		for (auto i = numLevels; i < MipCosineMaxLevels; ++i) EXPECT_EQ(0.0f, weights.Weights[i]);
+	}
+}
+
+// The Taylor series is accurate to double rounding; the range reduction and Cos use the
+// 10-digit PI of MipCosine.hlsli, hence the tolerance.
+TEST(MipCosine, SinMatchesStandardLibrary)
+{
+	for (auto i = -100; i <= 100; ++i)
+	{
+		const auto x = i * 0.1;
+		EXPECT_NEAR(sin(x), MipCosineMath::Sin(x), 1.0e-8) << "x = " << x;
+		EXPECT_NEAR(cos(x), MipCosineMath::Cos(x), 1.0e-8) << "x = " << x;
+	}
+}
+
+// The full chains of power-of-two sizes come from the compile-time tables.
+TEST(MipCosine, TablesMatchReference)
+{
+	for (uint8_t i = 0; i < MipCosineMaxLevels; ++i)
+		expectReferenceWeights(static_cast<float>(1u << i), i + 1);
+}
+
+// Other sizes and partial chains are generated at run time.
+TEST(MipCosine, RuntimeWeightsMatchReference)
+{
+	expectReferenceWeights(96.0f, 7);
+	expectReferenceWeights(100.0f, 7);
+	expectReferenceWeights(1000.0f, 10);
+	expectReferenceWeights(3.0f, 2);
+	expectReferenceWeights(512.0f, 4);
+	expectReferenceWeights(4096.0f, 1);
+}
+
+// The same function evaluated at run time gives the same table bits.
+TEST(MipCosine, TablesMatchRuntimeGeneration)
+{
+	for (uint8_t i = 0; i < MipCosineMaxLevels; ++i)
+		for (const auto preintegrated : { false, true })
+		{
+			// Volatile, so that the generation is not folded at compile time
+			volatile auto mapSize = static_cast<float>(1u << i);
+			const auto expected = GenerateMipCosineWeights(mapSize, i + 1, preintegrated);
+			const auto tables = GetMipCosineWeights(static_cast<float>(1u << i), i + 1, preintegrated);
+			for (uint8_t j = 0; j <= i; ++j)
+				EXPECT_EQ(expected.Weights[j], tables.Weights[j]) << "size " << (1u << i) << ", level " << static_cast<int>(j);
+		}
+}
@@ -0,0 +1,726 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// Mesh import, processing, and caching
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include "Optional/XUSGObjLoader.h"
+#include "TestUtils.h"
+
+using namespace std;
+using namespace XUSG;
+
+static void expectSameMesh(const ObjLoader& expected, const ObjLoader& result)
+{
+	ASSERT_EQ(expected.GetVertexStride(), result.GetVertexStride());
+	ASSERT_EQ(expected.GetNumVertices(), result.GetNumVertices());
+	ASSERT_EQ(expected.GetNumIndices(), result.GetNumIndices());
+	EXPECT_EQ(0, memcmp(expected.GetVertices(), result.GetVertices(),
+		static_cast<size_t>(expected.GetVertexStride()) * expected.GetNumVertices()));
+	EXPECT_EQ(0, memcmp(expected.GetIndices(), result.GetIndices(), sizeof(uint32_t) * expected.GetNumIndices()));
+	EXPECT_EQ(0, memcmp(&expected.GetAABB(), &result.GetAABB(), sizeof(ObjLoader::AABB)));
+}
+
+//--------------------------------------------------------------------------------------
+// Parsing
+//--------------------------------------------------------------------------------------
+
+// Imports through the file-read passes, which Import only falls back to when the file
+// cannot be mapped
+class LegacyObjLoader : public ObjLoader
+{
+public:
+	bool ImportLegacy(const char* pszFilename, bool needNorm, bool forDX, bool swapYZ)
+	{
+		const auto pFile = fopen(pszFilename, "r");
+		if (!pFile) return false;
+
+		m_stride = sizeof(float3);
+		m_stride += needNorm ? sizeof(float3) : 0;
+
+		uint32_t numTexc, numNorm;
+		importGeometryFirstPass(pFile, numTexc, numNorm);
+		rewind(pFile);
+		importGeometrySecondPass(pFile, numTexc, numNorm, forDX, swapYZ);
+		fclose(pFile);
+
+		if (needNorm && !numNorm) recomputeNormals();
+		computeAABB();
+
+		return true;
+	}
+};
+
+// With vn (venusm) and without, so that the normals are recomputed (bunny)
+TEST(ObjLoader, ParseMatchesLegacy)
+{
+	for (const auto name : { "bunny.obj", "venusm.obj" })
+		for (const auto swapYZ : { false, true })
+		{
+			SCOPED_TRACE(string(name) + (swapYZ ? ", swapYZ" : ""));
+			const auto fileName = TestUtils::GetAssetPath(name);
+
+			LegacyObjLoader legacy;
+			ASSERT_TRUE(legacy.ImportLegacy(fileName.c_str(), true, true, swapYZ));
+
+			// Files of 2 to 3 MB are split into 2 or 3 chunks with 4 threads.
+			for (const auto numThreads : { 1u, 2u, 4u })
+			{
+				ObjLoader objLoader;
+				ASSERT_TRUE(objLoader.Import(fileName.c_str(), true, true, true, swapYZ, false, numThreads));
+				expectSameMesh(legacy, objLoader);
+			}
+		}
+}
+
+TEST(ObjLoader, ParseWithoutNormals)
+{
+	const auto fileName = TestUtils::GetAssetPath("venusm.obj");
+
+	LegacyObjLoader legacy;
+	ObjLoader objLoader;
+	ASSERT_TRUE(legacy.ImportLegacy(fileName.c_str(), false, false, false));
+	ASSERT_TRUE(objLoader.Import(fileName.c_str(), false, true, false, false, false, 4));
+	expectSameMesh(legacy, objLoader);
+}
+
+// Height field of gridSize^2 positions without vn, so that the normals are recomputed
+static void writeGrid(const string& fileName, uint32_t gridSize)
+{
+	const auto pFile = fopen(fileName.c_str(), "w");
+	ASSERT_NE(nullptr, pFile);
+
+	for (auto i = 0u; i < gridSize; ++i)
+		for (auto j = 0u; j < gridSize; ++j)
+			fprintf(pFile, "v %.6f %.6f %.6f\n", 0.1f * j, 0.5f * sin(0.05f * i * j), 0.1f * i);
+
+	for (auto i = 0u; i + 1 < gridSize; ++i)
+		for (auto j = 0u; j + 1 < gridSize; ++j)
+		{
+			const auto base = i * gridSize + j + 1;
+			fprintf(pFile, "f %u %u %u %u\n", base, base + gridSize, base + gridSize + 1, base + 1);
+		}
+	fclose(pFile);
+}
+
+// Over minItemsPerThread (64k) triangles and vertices, so that the normals and the AABB
+// are computed in parallel
+TEST(ObjLoader, ParseLargeMeshOnThreads)
+{
+	static const auto gridSize = 300u;
+
+	const auto fileName = TestUtils::GetOutputPath("grid.obj");
+	writeGrid(fileName, gridSize);
+
+	LegacyObjLoader legacy;
+	ASSERT_TRUE(legacy.ImportLegacy(fileName.c_str(), true, true, false));
+	ASSERT_EQ(gridSize * gridSize, legacy.GetNumVertices());
+	ASSERT_EQ((gridSize - 1) * (gridSize - 1) * 6, legacy.GetNumIndices());
+
+	for (const auto numThreads : { 1u, 2u, 3u, 4u })
+	{
+		SCOPED_TRACE(numThreads);
+		ObjLoader objLoader;
+		ASSERT_TRUE(objLoader.Import(fileName.c_str(), true, true, true, false, false, numThreads));
+		expectSameMesh(legacy, objLoader);
+	}
+}
+
+// Quads of 4 positions and normals each, referenced by absolute or relative indices. The
+// file is over 2 MB, so that the relative indices of the later chunks reach across.
+static void writeQuads(const string& fileName, bool relative)
+{
+	static const auto numQuads = 12000u;
+
+	const auto pFile = fopen(fileName.c_str(), "w");
+	ASSERT_NE(nullptr, pFile);
+
+	for (auto i = 0u; i < numQuads; ++i)
+	{
+		const auto x = static_cast<float>(i % 100);
+		const auto y = static_cast<float>(i / 100);
+		for (auto j = 0u; j < 4; ++j)
+		{
+			fprintf(pFile, "v %.6f %.6f %.6f\n", x + (j == 1 || j == 2), y + (j >= 2), 0.001f * i);
+			fprintf(pFile, "vn %.6f %.6f %.6f\n", 0.0f, 0.01f * j, 1.0f);
+		}
+
+		if (relative) fputs("f -4//-4 -3//-3 -2//-2 -1//-1\n", pFile);
+		else
+		{
+			const auto base = i * 4 + 1;
+			fprintf(pFile, "f %u//%u %u//%u %u//%u %u//%u\n", base, base, base + 1, base + 1, base + 2, base + 2, base + 3, base + 3);
+		}
+	}
+	fclose(pFile);
+}
+
+TEST(ObjLoader, ParseRelativeIndicesAcrossChunks)
+{
+	const auto absoluteFileName = TestUtils::GetOutputPath("quads.obj");
+	const auto relativeFileName = TestUtils::GetOutputPath("quads_relative.obj");
+	writeQuads(absoluteFileName, false);
+	writeQuads(relativeFileName, true);
+
+	ObjLoader expected;
+	ASSERT_TRUE(expected.Import(absoluteFileName.c_str(), true, true, true, false, false, 1));
+	ASSERT_EQ(12000u * 6, expected.GetNumIndices());
+
+	for (const auto numThreads : { 1u, 2u, 4u })
+	{
+		SCOPED_TRACE(to_string(numThreads) + " threads");
+		ObjLoader objLoader;
+		ASSERT_TRUE(objLoader.Import(relativeFileName.c_str(), true, true, true, false, false, numThreads));
+		expectSameMesh(expected, objLoader);
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Welding
+//--------------------------------------------------------------------------------------
+
+// Vertices 4 and 5 repeat 1 and 2 (offset by delta), and 7 repeats the position of 1
+// with another normal. Triangle 4 collapses once 1 and 4 are merged.
+static void writeDuplicates(const string& fileName, float offset, float delta)
+{
+	const auto pFile = fopen(fileName.c_str(), "w");
+	ASSERT_NE(nullptr, pFile);
+
+	const float positions[][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { delta, 0, 0 }, { 1, delta, 0 }, { 1, 1, 0 }, { 0, 0, 0 } };
+	for (const auto& p : positions) fprintf(pFile, "v %.9g %.9g %.9g\n", p[0] + offset, p[1], p[2]);
+	fputs("vn 0 0 1\nvn 1 0 0\n", pFile);
+	fputs("f 1//1 2//1 3//1\nf 4//1 5//1 6//1\nf 7//2 2//1 3//1\nf 1//1 4//1 2//1\n", pFile);
+	fclose(pFile);
+}
+
+TEST(ObjLoader, WeldMergesDuplicates)
+{
+	const auto fileName = TestUtils::GetOutputPath("duplicates.obj");
+	static const uint32_t expectedIndices[] = { 0, 1, 2, 0, 1, 3, 4, 1, 2 };
+
+	// Exact duplicates, duplicates within epsilon, and exact duplicates far from the
+	// origin, beyond 2^31 epsilon-sized cells
+	const struct
+	{
+		float Offset;
+		float Delta;
+		float Epsilon;
+	} cases[] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0e-4f, 1.0e-3f }, { 0.0f, 0.0f, 1.0e-6f }, { 5000.0f, 0.0f, 1.0e-6f } };
+
+	for (const auto& c : cases)
+	{
+		SCOPED_TRACE("offset " + to_string(c.Offset) + ", epsilon " + to_string(c.Epsilon));
+		writeDuplicates(fileName, c.Offset, c.Delta);
+
+		ObjLoader objLoader;
+		ASSERT_TRUE(objLoader.Import(fileName.c_str(), true, true, false, false, false, 1));
+		ASSERT_EQ(7u, objLoader.GetNumVertices());
+		ASSERT_EQ(12u, objLoader.GetNumIndices());
+
+		vector<ObjLoader::float3> positions;
+		for (auto i = 0u; i < 7; ++i)
+			positions.emplace_back(reinterpret_cast<const float*>(objLoader.GetVertices() + objLoader.GetVertexStride() * i));
+
+		EXPECT_EQ(2u, objLoader.Weld(c.Epsilon));
+		ASSERT_EQ(5u, objLoader.GetNumVertices());
+		ASSERT_EQ(9u, objLoader.GetNumIndices());
+		EXPECT_EQ(0, memcmp(expectedIndices, objLoader.GetIndices(), sizeof(expectedIndices)));
+
+		// The first of the merged vertices are kept, in their order.
+		for (const auto& k : { make_pair(0u, 0u), make_pair(1u, 1u), make_pair(2u, 2u), make_pair(3u, 5u), make_pair(4u, 6u) })
+			EXPECT_EQ(0, memcmp(&positions[k.second], objLoader.GetVertices() + objLoader.GetVertexStride() * k.first, sizeof(ObjLoader::float3)))
+				<< "vertex " << k.first;
+	}
+
+	// Nothing to merge below the delta
+	writeDuplicates(fileName, 0.0f, 1.0e-2f);
+	ObjLoader objLoader;
+	ASSERT_TRUE(objLoader.Import(fileName.c_str(), true, true, false, false, false, 1));
+	EXPECT_EQ(0u, objLoader.Weld(1.0e-3f));
+	EXPECT_EQ(7u, objLoader.GetNumVertices());
+	EXPECT_EQ(12u, objLoader.GetNumIndices());
+}
+
+//--------------------------------------------------------------------------------------
+// Vertex cache optimization
+//--------------------------------------------------------------------------------------
+
+// The triangles as sorted vertex attribute bytes, each rotated to start at its smallest
+// vertex, so that they compare regardless of the vertex and triangle orders
+static vector<vector<uint8_t>> getTriangleSet(const ObjLoader& objLoader)
+{
+	const auto stride = objLoader.GetVertexStride();
+	const auto numTri = objLoader.GetNumIndices() / 3;
+
+	vector<vector<uint8_t>> triangles(numTri);
+	for (auto i = 0u; i < numTri; ++i)
+	{
+		vector<uint8_t> vertices[3];
+		for (auto j = 0u; j < 3; ++j)
+		{
+			const auto pVertex = objLoader.GetVertices() + stride * objLoader.GetIndices()[i * 3 + j];
+			vertices[j].assign(pVertex, pVertex + stride);
+		}
+
+		const auto first = static_cast<uint32_t>(min_element(vertices, vertices + 3) - vertices);
+		for (auto j = 0u; j < 3; ++j)
+		{
+			const auto& vertex = vertices[(first + j) % 3];
+			triangles[i].insert(triangles[i].end(), vertex.cbegin(), vertex.cend());
+		}
+	}
+	sort(triangles.begin(), triangles.end());
+
+	return triangles;
+}
+
+TEST(ObjLoader, VertexCacheStats)
+{
+	const auto fileName = TestUtils::GetOutputPath("quads.obj");
+	writeQuads(fileName, false);
+
+	// Unshared vertices: every index misses, and each vertex is transformed once.
+	ObjLoader objLoader;
+	ASSERT_TRUE(objLoader.Import(fileName.c_str(), true, true, true, false, false, 1));
+	auto stats = objLoader.GetVertexCacheStats(16);
+	EXPECT_FLOAT_EQ(2.0f, stats.ACMR);
+	EXPECT_FLOAT_EQ(1.0f, stats.ATVR);
+
+	// A cache of 3 still misses every other vertex of the quads, which share 2 of 4.
+	stats = objLoader.GetVertexCacheStats(3);
+	EXPECT_FLOAT_EQ(2.0f, stats.ACMR);
+}
+
+TEST(ObjLoader, OptimizeKeepsTrianglesAndLowersACMR)
+{
+	for (const auto name : { "bunny.obj", "venusm.obj" })
+	{
+		SCOPED_TRACE(name);
+		ObjLoader objLoader;
+		ASSERT_TRUE(objLoader.Import(TestUtils::GetAssetPath(name).c_str(), true, true, true, false, false, 1));
+		objLoader.Weld();
+
+		const auto numVert = objLoader.GetNumVertices();
+		const auto triangles = getTriangleSet(objLoader);
+		const auto aabb = objLoader.GetAABB();
+
+		ObjLoader::VertexCacheStats before, after;
+		objLoader.Optimize(16, &before, &after);
+		EXPECT_EQ(numVert, objLoader.GetNumVertices());
+		EXPECT_EQ(0, memcmp(&aabb, &objLoader.GetAABB(), sizeof(ObjLoader::AABB)));
+		EXPECT_TRUE(triangles == getTriangleSet(objLoader));
+
+		const auto stats = objLoader.GetVertexCacheStats(16);
+		EXPECT_EQ(after.ACMR, stats.ACMR);
+		EXPECT_LT(after.ACMR, before.ACMR);
+		EXPECT_LT(after.ACMR, 0.8f);
+		EXPECT_LE(after.ATVR, before.ATVR);
+
+		// The vertices are in order of first use.
+		auto numUsed = 0u;
+		for (auto i = 0u; i < objLoader.GetNumIndices(); ++i)
+		{
+			const auto v = objLoader.GetIndices()[i];
+			ASSERT_LE(v, numUsed);
+			if (v == numUsed) ++numUsed;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Vertex quantization
+//--------------------------------------------------------------------------------------
+
+// Triangles of unshared vertices, so that there are 3 * numTri of them. The normals
+// spiral over the sphere and include the poles and the octahedron edges.
+static void writeTriangles(const string& fileName, uint32_t numTri)
+{
+	static const float axes[][3] = { { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } };
+	static const auto numAxes = static_cast<uint32_t>(sizeof(axes) / sizeof(axes[0]));
+
+	const auto pFile = fopen(fileName.c_str(), "w");
+	ASSERT_NE(nullptr, pFile);
+
+	const auto numVert = numTri * 3;
+	for (auto i = 0u; i < numVert; ++i)
+	{
+		const auto t = (i + 0.5f) / numVert;
+		const auto z = 1.0f - 2.0f * t;
+		const auto r = sqrt(1.0f - z * z);
+		const auto phi = 2.39996323f * i;
+		fprintf(pFile, "v %.6f %.6f %.6f\n", 3.0f * t - 1.0f, sin(0.7f * i), 0.25f * (i % 5));
+		if (i < numAxes) fprintf(pFile, "vn %.6f %.6f %.6f\n", axes[i][0], axes[i][1], axes[i][2]);
+		else fprintf(pFile, "vn %.6f %.6f %.6f\n", r * cos(phi), r * sin(phi), z);
+	}
+
+	for (auto i = 0u; i < numTri; ++i)
+	{
+		const auto base = i * 3 + 1;
+		fprintf(pFile, "f %u//%u %u//%u %u//%u\n", base, base, base + 1, base + 1, base + 2, base + 2);
+	}
+	fclose(pFile);
+}
+
+// Decodes the quantized vertices without SIMD, and checks them against the source
+// vertices within the reported error.
+static void expectWithinQuantizationError(const ObjLoader& objLoader, const vector<uint8_t>& quantized,
+	ObjLoader::NormalEncoding encoding, const ObjLoader::QuantizationError& error)
+{
+	const auto numVert = objLoader.GetNumVertices();
+	const auto srcStride = objLoader.GetVertexStride();
+	const auto dstStride = ObjLoader::GetQuantizedStride(encoding);
+	ASSERT_EQ(static_cast<size_t>(dstStride) * numVert, quantized.size());
+
+	const auto& aabb = objLoader.GetAABB();
+	const double aabbMin[] = { aabb.Min.x, aabb.Min.y, aabb.Min.z };
+	const double extent[] = { aabb.Max.x - aabb.Min.x, aabb.Max.y - aabb.Min.y, aabb.Max.z - aabb.Min.z };
+	const auto normalMax = encoding == ObjLoader::NORMAL_OCT8 ? 127.0 : 32767.0;
+	const auto maxExtent = (max)((max)(extent[0], extent[1]), extent[2]);
+
+	auto maxPosError = 0.0, maxNormalError = 0.0;
+	for (auto i = 0u; i < numVert; ++i)
+	{
+		const auto pSrc = reinterpret_cast<const float*>(objLoader.GetVertices() + static_cast<size_t>(srcStride) * i);
+		const auto pDst = &quantized[static_cast<size_t>(dstStride) * i];
+		uint16_t v[4];
+		memcpy(v, pDst, sizeof(v));
+
+		auto posError = 0.0;
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			const auto d = aabbMin[c] + v[c] * extent[c] / 65535.0 - pSrc[c];
+			posError += d * d;
+		}
+		maxPosError = (max)(maxPosError, sqrt(posError));
+
+		int16_t e[2];
+		if (encoding == ObjLoader::NORMAL_OCT8)
+		{
+			e[0] = static_cast<int8_t>(v[3] & 0xff);
+			e[1] = static_cast<int8_t>(v[3] >> 8);
+		}
+		else memcpy(e, pDst + sizeof(v), sizeof(e));
+
+		auto x = (max)(e[0] / normalMax, -1.0);
+		auto y = (max)(e[1] / normalMax, -1.0);
+		const auto z = 1.0 - fabs(x) - fabs(y);
+		const auto t = (max)(-z, 0.0);
+		x += x >= 0.0 ? -t : t;
+		y += y >= 0.0 ? -t : t;
+		const double n[] = { pSrc[3], pSrc[4], pSrc[5] };
+		const auto cx = y * n[2] - z * n[1];
+		const auto cy = z * n[0] - x * n[2];
+		const auto cz = x * n[1] - y * n[0];
+		const auto angle = atan2(sqrt(cx * cx + cy * cy + cz * cz), x * n[0] + y * n[1] + z * n[2]);
+		maxNormalError = (max)(maxNormalError, angle * 180.0 / 3.14159265358979323846);
+	}
+
+	// The reported maxima are measured in single precision.
+	EXPECT_LE(maxPosError, error.MaxPosition + 1e-6 * maxExtent);
+	EXPECT_NEAR(maxPosError, error.MaxPosition, 1e-6 * maxExtent);
+	EXPECT_LE(maxNormalError, error.MaxNormal + 1e-3);
+	EXPECT_NEAR(maxNormalError, error.MaxNormal, 1e-3);
+	EXPECT_LE(error.RMSPosition, error.MaxPosition);
+	EXPECT_LE(error.RMSNormal, error.MaxNormal);
+
+	// Half a quantization step per axis, and about the octahedral cell diagonal
+	EXPECT_LE(maxPosError, 0.5 * sqrt(3.0) * maxExtent / 65535.0 + 1e-6 * maxExtent);
+	EXPECT_LT(maxNormalError, encoding == ObjLoader::NORMAL_OCT8 ? 1.5 : 0.01);
+}
+
+// Vertex counts of 3, 6, 9, and 201 leave SIMD tails of 3, 2, 1, and 1 vertices.
+TEST(ObjLoader, QuantizeWithinError)
+{
+	const auto fileName = TestUtils::GetOutputPath("triangles.obj");
+	for (const auto numTri : { 1u, 2u, 3u, 67u })
+	{
+		SCOPED_TRACE(numTri);
+		writeTriangles(fileName, numTri);
+
+		ObjLoader objLoader;
+		ASSERT_TRUE(objLoader.Import(fileName.c_str(), true, true, true, false, false, 1));
+		ASSERT_EQ(numTri * 3, objLoader.GetNumVertices());
+
+		for (const auto encoding : { ObjLoader::NORMAL_OCT16, ObjLoader::NORMAL_OCT8 })
+		{
+			SCOPED_TRACE(encoding);
+			vector<uint8_t> quantized;
+			ObjLoader::QuantizationError error;
+			ASSERT_TRUE(objLoader.Quantize(quantized, encoding, &error));
+			expectWithinQuantizationError(objLoader, quantized, encoding, error);
+		}
+	}
+}
+
+TEST(ObjLoader, QuantizeMeshWithinError)
+{
+	ObjLoader objLoader;
+	ASSERT_TRUE(objLoader.Import(TestUtils::GetAssetPath("bunny.obj").c_str(), true, true, true, false, false, 1));
+
+	for (const auto encoding : { ObjLoader::NORMAL_OCT16, ObjLoader::NORMAL_OCT8 })
+	{
+		SCOPED_TRACE(encoding);
+		vector<uint8_t> quantized, withoutError;
+		ObjLoader::QuantizationError error;
+		ASSERT_TRUE(objLoader.Quantize(quantized, encoding, &error));
+		expectWithinQuantizationError(objLoader, quantized, encoding, error);
+
+		// The error measurement does not change the encoding.
+		ASSERT_TRUE(objLoader.Quantize(withoutError, encoding));
+		EXPECT_TRUE(quantized == withoutError);
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Meshlets and their culling
+//--------------------------------------------------------------------------------------
+
+// Cube of [-1, 1]^3 with one quad per face, wound counterclockwise from outside
+static void writeCube(const string& fileName)
+{
+	const auto pFile = fopen(fileName.c_str(), "w");
+	ASSERT_NE(nullptr, pFile);
+
+	for (auto i = 0u; i < 8; ++i)
+		fprintf(pFile, "v %d %d %d\n", i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1);
+	fputs("f 1 5 7 3\nf 2 4 8 6\nf 1 2 6 5\nf 3 7 8 4\nf 1 3 4 2\nf 5 6 8 7\n", pFile);
+	fclose(pFile);
+}
+
+static bool isOutside(const float plane[4], const ObjLoader::float3& p)
+{
+	return plane[0] * p.x + plane[1] * p.y + plane[2] * p.z + plane[3] < 0.0f;
+}
+
+TEST(ObjLoader, CullCubeMeshlets)
+{
+	const auto fileName = TestUtils::GetOutputPath("cube.obj");
+	writeCube(fileName);
+
+	for (const auto forDX : { false, true })
+	{
+		SCOPED_TRACE(forDX ? "forDX" : "");
+		ObjLoader objLoader;
+		ASSERT_TRUE(objLoader.Import(fileName.c_str(), true, true, forDX, false, false, 1));
+
+		// Two triangles per meshlet, so one face each, in the file order
+		ASSERT_EQ(6u, objLoader.BuildMeshlets(64, 2));
+		const auto pMeshlets = objLoader.GetMeshlets();
+		for (auto i = 0u; i < 6; ++i)
+		{
+			const auto& meshlet = pMeshlets[i];
+			EXPECT_EQ(4u, meshlet.VertexCount);
+			EXPECT_EQ(2u, meshlet.TriangleCount);
+			EXPECT_FLOAT_EQ(sqrt(2.0f), meshlet.Radius);
+			EXPECT_FLOAT_EQ(0.0f, meshlet.ConeCutoff);
+
+			// Flat faces: the cone axis is the outward normal through the center.
+			const auto& c = meshlet.Center;
+			const auto& a = meshlet.ConeAxis;
+			EXPECT_FLOAT_EQ(1.0f, fabs(c.x + c.y + c.z));
+			EXPECT_FLOAT_EQ(c.x, a.x);
+			EXPECT_FLOAT_EQ(c.y, a.y);
+			EXPECT_FLOAT_EQ(c.z, a.z);
+		}
+
+		// Faces in the file order, with z negated for DX
+		const auto zSign = forDX ? -1.0f : 1.0f;
+		const auto findFace = [&](float x, float y, float z)
+		{
+			for (auto i = 0u; i < 6; ++i)
+				if (pMeshlets[i].Center.x == x && pMeshlets[i].Center.y == y && pMeshlets[i].Center.z == z * zSign) return i;
+
+			return UINT32_MAX;
+		};
+
+		// Everything in the frustum: only the face away from the eye is culled, as the side
+		// faces are seen edge-on.
+		float planes[6][4] =
+		{
+			{ 1.0f, 0.0f, 0.0f, 100.0f }, { -1.0f, 0.0f, 0.0f, 100.0f },
+			{ 0.0f, 1.0f, 0.0f, 100.0f }, { 0.0f, -1.0f, 0.0f, 100.0f },
+			{ 0.0f, 0.0f, 1.0f, 100.0f }, { 0.0f, 0.0f, -1.0f, 100.0f }
+		};
+		vector<uint32_t> visible;
+		EXPECT_EQ(5u, ObjLoader::CullMeshlets(pMeshlets, 6, planes, ObjLoader::float3(0.0f, 0.0f, 5.0f * zSign), visible));
+		EXPECT_EQ(visible.end(), find(visible.begin(), visible.end(), findFace(0.0f, 0.0f, -1.0f)));
+
+		// Inside y <= -0.5 and with the eye in front of +x: the bounding sphere of +y is
+		// outside the frustum, and -x faces away from the eye.
+		planes[3][3] = -0.5f;
+		EXPECT_EQ(4u, ObjLoader::CullMeshlets(pMeshlets, 6, planes, ObjLoader::float3(5.0f, 0.0f, 0.0f), visible));
+		EXPECT_EQ(visible.end(), find(visible.begin(), visible.end(), findFace(0.0f, 1.0f, 0.0f)));
+		EXPECT_EQ(visible.end(), find(visible.begin(), visible.end(), findFace(-1.0f, 0.0f, 0.0f)));
+		EXPECT_NE(visible.end(), find(visible.begin(), visible.end(), findFace(1.0f, 0.0f, 0.0f)));
+
+		// A plane past the cube culls all.
+		planes[0][3] = -10.0f;
+		EXPECT_EQ(0u, ObjLoader::CullMeshlets(pMeshlets, 6, planes, ObjLoader::float3(5.0f, 0.0f, 0.0f), visible));
+	}
+}
+
+// On a processed mesh: the meshlets partition the triangles within the limits, and a
+// culled meshlet has no triangle both in the frustum and facing the eye.
+TEST(ObjLoader, CullMeshletsConservatively)
+{
+	ObjLoader objLoader;
+	ASSERT_TRUE(objLoader.Import(TestUtils::GetAssetPath("bunny.obj").c_str(), true, true, true, false, false, 1));
+	objLoader.Weld();
+	objLoader.Optimize();
+	const auto numMeshlets = objLoader.BuildMeshlets(64, 124);
+	ASSERT_GT(numMeshlets, 1u);
+
+	const auto pMeshlets = objLoader.GetMeshlets();
+	const auto pVertices = objLoader.GetVertices();
+	const auto stride = objLoader.GetVertexStride();
+	const auto getPosition = [&](uint32_t i) { return ObjLoader::float3(reinterpret_cast<const float*>(pVertices + stride * i)); };
+
+	auto numTri = 0u;
+	for (auto i = 0u; i < numMeshlets; ++i)
+	{
+		const auto& meshlet = pMeshlets[i];
+		EXPECT_EQ(numTri, meshlet.TriangleOffset);
+		EXPECT_LE(meshlet.VertexCount, 64u);
+		EXPECT_LE(meshlet.TriangleCount, 124u);
+		for (auto j = 0u; j < meshlet.TriangleCount * 3; ++j)
+		{
+			const auto v = objLoader.GetMeshletVertices()[meshlet.VertexOffset + objLoader.GetMeshletTriangles()[meshlet.TriangleOffset * 3 + j]];
+			ASSERT_EQ(objLoader.GetIndices()[meshlet.TriangleOffset * 3 + j], v);
+		}
+		numTri += meshlet.TriangleCount;
+	}
+	EXPECT_EQ(objLoader.GetNumIndices() / 3, numTri);
+
+	const auto& aabb = objLoader.GetAABB();
+	const ObjLoader::float3 center((aabb.Min.x + aabb.Max.x) * 0.5f, (aabb.Min.y + aabb.Max.y) * 0.5f, (aabb.Min.z + aabb.Max.z) * 0.5f);
+	const auto extent = (max)((max)(aabb.Max.x - aabb.Min.x, aabb.Max.y - aabb.Min.y), aabb.Max.z - aabb.Min.z);
+
+	// A half space through the center, orthogonal to the view direction
+	const ObjLoader::float3 dirs[] =
+	{
+		ObjLoader::float3(0.0f, 0.0f, 1.0f),
+		ObjLoader::float3(0.6f, 0.0f, -0.8f),
+		ObjLoader::float3(0.0f, -0.8f, 0.6f),
+		ObjLoader::float3(-0.48f, 0.6f, 0.64f)
+	};
+	for (const auto& d : dirs)
+	{
+		const ObjLoader::float3 eyePt(center.x + d.x * extent * 2.0f, center.y + d.y * extent * 2.0f, center.z + d.z * extent * 2.0f);
+		float planes[6][4] = {};
+		for (auto& plane : planes) plane[3] = 1.0f;
+		planes[0][0] = -d.y;
+		planes[0][1] = d.x;
+		planes[0][2] = d.z * 0.5f;
+		planes[0][3] = -(planes[0][0] * center.x + planes[0][1] * center.y + planes[0][2] * center.z);
+
+		vector<uint32_t> visible;
+		const auto numVisible = ObjLoader::CullMeshlets(pMeshlets, numMeshlets, planes, eyePt, visible);
+		EXPECT_GT(numVisible, 0u);
+		EXPECT_LT(numVisible, numMeshlets);
+
+		vector<bool> isVisible(numMeshlets, false);
+		for (const auto& i : visible) isVisible[i] = true;
+		for (auto i = 0u; i < numMeshlets; ++i)
+		{
+			if (isVisible[i]) continue;
+
+			const auto& meshlet = pMeshlets[i];
+			for (auto j = meshlet.TriangleOffset; j < meshlet.TriangleOffset + meshlet.TriangleCount; ++j)
+			{
+				const auto p0 = getPosition(objLoader.GetIndices()[j * 3]);
+				const auto p1 = getPosition(objLoader.GetIndices()[j * 3 + 1]);
+				const auto p2 = getPosition(objLoader.GetIndices()[j * 3 + 2]);
+				if (isOutside(planes[0], p0) && isOutside(planes[0], p1) && isOutside(planes[0], p2)) continue;
+
+				// Wound as in the meshlet normal cones
+				const ObjLoader::float3 e1(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+				const ObjLoader::float3 e2(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z);
+				const ObjLoader::float3 n(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+				const auto facing = (p0.x - eyePt.x) * n.x + (p0.y - eyePt.y) * n.y + (p0.z - eyePt.z) * n.z;
+				EXPECT_GE(facing, 0.0f) << "meshlet " << i << ", triangle " << j;
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Mesh caches
+//--------------------------------------------------------------------------------------
+
+static void copyFile(const string& src, const string& dst)
+{
+	const auto pSrc = fopen(src.c_str(), "rb");
+	const auto pDst = fopen(dst.c_str(), "wb");
+	ASSERT_NE(nullptr, pSrc);
+	ASSERT_NE(nullptr, pDst);
+
+	char buffer[65536];
+	size_t size;
+	while ((size = fread(buffer, 1, sizeof(buffer), pSrc)) > 0) fwrite(buffer, 1, size, pDst);
+	fclose(pSrc);
+	fclose(pDst);
+}
+
+static void expectSameMeshlets(const ObjLoader& expected, const ObjLoader& result)
+{
+	ASSERT_EQ(expected.GetNumMeshlets(), result.GetNumMeshlets());
+	EXPECT_EQ(0, memcmp(expected.GetMeshlets(), result.GetMeshlets(), sizeof(ObjLoader::Meshlet) * expected.GetNumMeshlets()));
+	const auto& last = expected.GetMeshlets()[expected.GetNumMeshlets() - 1];
+	EXPECT_EQ(0, memcmp(expected.GetMeshletVertices(), result.GetMeshletVertices(), sizeof(uint32_t) * (last.VertexOffset + last.VertexCount)));
+	EXPECT_EQ(0, memcmp(expected.GetMeshletTriangles(), result.GetMeshletTriangles(), 3 * (last.TriangleOffset + last.TriangleCount)));
+}
+
+// The processed mesh goes to its own cache, which does not change what Import loads.
+TEST(ObjLoader, ProcessedCacheIsSeparate)
+{
+	const auto fileName = TestUtils::GetOutputPath("bunny.obj");
+	copyFile(TestUtils::GetAssetPath("bunny.obj"), fileName);
+	remove((fileName + ".cache").c_str());
+	remove((fileName + ".opt.cache").c_str());
+
+	ObjLoader imported, processed;
+	ASSERT_TRUE(imported.Import(fileName.c_str(), true, true, true, false, false));
+	ASSERT_TRUE(processed.Import(fileName.c_str(), true, true, true, false, true));
+	processed.Weld();
+	processed.Optimize(16);
+	processed.BuildMeshlets(64, 124);
+	ASSERT_TRUE(processed.UpdateCache());
+
+	const auto& processing = processed.GetProcessing();
+	EXPECT_TRUE(processing.Welded);
+	EXPECT_EQ(16u, processing.CacheSize);
+	EXPECT_EQ(64u, processing.MaxMeshletVertices);
+	EXPECT_EQ(124u, processing.MaxMeshletTriangles);
+
+	// Import with the cache still loads the mesh as imported.
+	ObjLoader objLoader;
+	ASSERT_TRUE(objLoader.Import(fileName.c_str(), true, true, true, false, true));
+	EXPECT_EQ(0u, objLoader.GetNumMeshlets());
+	EXPECT_FALSE(objLoader.GetProcessing().Welded);
+	expectSameMesh(imported, objLoader);
+
+	// The processed cache only loads for the same processing and flags.
+	ASSERT_TRUE(objLoader.LoadProcessedCache(fileName.c_str(), processing));
+	expectSameMesh(processed, objLoader);
+	expectSameMeshlets(processed, objLoader);
+
+	auto other = processing;
+	other.MaxMeshletTriangles = 64;
+	EXPECT_FALSE(objLoader.LoadProcessedCache(fileName.c_str(), other));
+	other = processing;
+	other.WeldEpsilon = 1.0e-4f;
+	EXPECT_FALSE(objLoader.LoadProcessedCache(fileName.c_str(), other));
+	EXPECT_FALSE(objLoader.LoadProcessedCache(fileName.c_str(), processing, true, true, true));
+
+	// Optimizing again drops the meshlets from the processing.
+	processed.Optimize(32);
+	EXPECT_EQ(32u, processed.GetProcessing().CacheSize);
+	EXPECT_EQ(0u, processed.GetProcessing().MaxMeshletVertices);
+}
@@ -0,0 +1,102 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// Batched probe baking against standalone light probes
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+#include "CPU/ProbeBaker.h"
+#include "TestUtils.h"
+
+using namespace std;
+using namespace CPU;
+
+static void expectSameLevels(const CubeMap& expected, const CubeMap& result, uint8_t numLevels)
+{
+	ASSERT_EQ(expected.GetSize(), result.GetSize());
+	for (uint8_t l = 0; l < numLevels; ++l)
+	{
+		const auto count = static_cast<size_t>(expected.GetSize(l)) * expected.GetSize(l);
+		for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+			for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+				EXPECT_EQ(0, memcmp(expected.GetPlane(l, s, c), result.GetPlane(l, s, c), sizeof(float) * count))
+					<< "level " << static_cast<int>(l) << ", face " << static_cast<int>(s) << ", channel " << static_cast<int>(c);
+	}
+}
+
+// Probes of two sizes, so that the light probe is recreated within the batch
+TEST(ProbeBaker, MatchesLightProbe)
+{
+	static const uint32_t sizes[] = { 16, 16, 32, 8 };
+	static const auto numProbes = static_cast<uint32_t>(sizeof(sizes) / sizeof(sizes[0]));
+
+	vector<CubeMap::sptr> sources(numProbes);
+	for (auto i = 0u; i < numProbes; ++i)
+	{
+		sources[i] = make_shared<CubeMap>();
+		ASSERT_TRUE(sources[i]->Create(sizes[i]));
+		TestUtils::FillRandom(*sources[i], i + 1);
+	}
+
+	const auto scheduler = make_shared<Scheduler>();
+	ASSERT_TRUE(scheduler->Init(2));
+	for (const auto upsampleMode : { LightProbe::UPSAMPLE_PER_LEVEL, LightProbe::UPSAMPLE_FUSED })
+	{
+		SCOPED_TRACE(upsampleMode == LightProbe::UPSAMPLE_FUSED ? "fused" : "per level");
+		ProbeBaker baker;
+		ASSERT_TRUE(baker.Init(upsampleMode, scheduler));
+
+		// Twice, the second time into the cubes of the first
+		vector<CubeMap::uptr> irradiances;
+		for (auto r = 0; r < 2; ++r)
+		{
+			ASSERT_TRUE(baker.Bake(sources.data(), numProbes, irradiances));
+			ASSERT_EQ(numProbes, irradiances.size());
+
+			for (auto i = 0u; i < numProbes; ++i)
+			{
+				LightProbe lightProbe;
+				ASSERT_TRUE(lightProbe.Init(&sources[i], 1, upsampleMode, scheduler));
+				lightProbe.UpdateFrame(0.0);
+				lightProbe.Process();
+
+				const auto& expected = *lightProbe.GetIrradiance();
+				const uint8_t numLevels = upsampleMode == LightProbe::UPSAMPLE_FUSED ? 1 : expected.GetNumMips();
+				ASSERT_TRUE(irradiances[i]);
+				EXPECT_EQ(numLevels, irradiances[i]->GetNumMips());
+				expectSameLevels(expected, *irradiances[i], numLevels);
+			}
+		}
+	}
+}
+
+TEST(ProbeBaker, StopsOnLoaderFailure)
+{
+	ProbeBaker baker;
+	const auto scheduler = make_shared<Scheduler>();
+	ASSERT_TRUE(scheduler->Init(2));
+	ASSERT_TRUE(baker.Init(LightProbe::UPSAMPLE_FUSED, scheduler));
+
+	// Probe 2 fails to load, so probes 3 and up are not baked.
+	auto numConsumed = 0u;
+	const auto loader = [](uint32_t i, CubeMap::sptr& source)
+	{
+		if (i == 2) return false;
+		if (!source) source = make_shared<CubeMap>();
+
+		return source->Create(8);
+	};
+	const auto consumer = [&numConsumed](uint32_t, const CubeMap& irradiance, uint8_t numLevels)
+	{
+		++numConsumed;
+
+		return numLevels == 1 && irradiance.GetSize() == 8;
+	};
+	EXPECT_FALSE(baker.Bake(5, loader, consumer));
+	EXPECT_EQ(2u, numConsumed);
+}
@@ -0,0 +1,104 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// The task-graph scheduler
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+#include "CPU/Scheduler.h"
+
+using namespace std;
+using namespace CPU;
+
+// Levels of tasks, each reading its three neighbors in the level above, as the tiles of
+// the up-sampling passes do; a task whose prerequisites have not all run sees a zero.
+TEST(Scheduler, RunsDependenciesInOrder)
+{
+	static const auto numLevels = 8u;
+	static const auto width = 16u;
+	static const auto numRuns = 200u;
+
+	vector<uint64_t> values(numLevels * width);
+	atomic<uint32_t> numMissing(0);
+
+	TaskGraph graph;
+	for (auto l = 0u; l < numLevels; ++l)
+		for (auto i = 0u; i < width; ++i)
+		{
+			const auto task = graph.AddTask([&values, &numMissing, l, i]()
+			{
+				auto value = static_cast<uint64_t>(i + 1);
+				if (l > 0)
+					for (auto j = (i > 0 ? i - 1 : i); j <= i + 1 && j < width; ++j)
+					{
+						const auto prerequisite = values[(l - 1) * width + j];
+						if (prerequisite == 0) ++numMissing;
+						value += prerequisite;
+					}
+				values[l * width + i] = value;
+			});
+			EXPECT_EQ(l * width + i, task);
+
+			if (l > 0)
+				for (auto j = (i > 0 ? i - 1 : i); j <= i + 1 && j < width; ++j)
+					graph.AddDependency(task, (l - 1) * width + j);
+		}
+	ASSERT_EQ(numLevels * width, graph.GetNumTasks());
+
+	// Reference in the order of addition
+	vector<uint64_t> expected(values.size());
+	for (auto l = 0u; l < numLevels; ++l)
+		for (auto i = 0u; i < width; ++i)
+		{
+			auto value = static_cast<uint64_t>(i + 1);
+			if (l > 0)
+				for (auto j = (i > 0 ? i - 1 : i); j <= i + 1 && j < width; ++j)
+					value += expected[(l - 1) * width + j];
+			expected[l * width + i] = value;
+		}
+
+	for (const auto numThreads : { 1u, 4u })
+	{
+		Scheduler scheduler;
+		ASSERT_TRUE(scheduler.Init(numThreads));
+		ASSERT_EQ(numThreads, scheduler.GetNumThreads());
+
+		for (auto r = 0u; r < numRuns; ++r)
+		{
+			fill(values.begin(), values.end(), 0);
+			scheduler.Run(graph);
+			ASSERT_EQ(0u, numMissing.load()) << numThreads << " threads, run " << r;
+			ASSERT_EQ(expected, values) << numThreads << " threads, run " << r;
+		}
+	}
+}
+
+TEST(Scheduler, RunsEveryTaskOnce)
+{
+	static const auto numTasks = 1000u;
+
+	vector<atomic<uint32_t>> counts(numTasks);
+	TaskGraph graph;
+	for (auto i = 0u; i < numTasks; ++i)
+		graph.AddTask([&counts, i]() { ++counts[i]; });
+
+	// A duplicate dependency counts once.
+	graph.AddDependency(1, 0);
+	graph.AddDependency(1, 0);
+
+	Scheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(4));
+	for (auto r = 0u; r < 10; ++r) scheduler.Run(graph);
+	for (auto i = 0u; i < numTasks; ++i) EXPECT_EQ(10u, counts[i].load()) << "task " << i;
+
+	// Empty graphs return at once, and the scheduler can be reinitialized.
+	scheduler.Run(TaskGraph());
+	ASSERT_TRUE(scheduler.Init(2));
+	scheduler.Run(graph);
+	EXPECT_EQ(11u, counts[0].load());
+}
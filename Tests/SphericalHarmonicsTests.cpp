@@ -0,0 +1,192 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// SH projection of cube maps, and rotation of the coefficients
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <gtest/gtest.h>
+#include "CPU/SphericalHarmonics.h"
+#include "TestUtils.h"
+
+using namespace std;
+using namespace CPU;
+
+//--------------------------------------------------------------------------------------
+// Projection
+//--------------------------------------------------------------------------------------
+
+template<uint8_t order>
+static void testSHProjection()
+{
+	// The AVX2 path sums 8 lanes and uses FMA, so it only matches to rounding
+	for (const auto size : { 5u, 16u, 37u })
+	{
+		CubeMap radiance;
+		ASSERT_TRUE(radiance.Create(size));
+		TestUtils::FillRandom(radiance, size);
+
+		SHProjector<order> projector;
+		ASSERT_TRUE(projector.Init());
+
+		float3 expected[SHProjector<order>::NumCoeffs], result[SHProjector<order>::NumCoeffs];
+		ASSERT_TRUE(projector.Project(radiance, expected, 0, ISA::SCALAR));
+		ASSERT_TRUE(projector.Project(radiance, result, 0, GetNativeISA()));
+
+		// Relative to the DC term, as the higher coefficients of noise are near zero
+		const auto tolerance = 1.0e-5f * (max)(expected[0].x, 1.0f);
+		for (uint8_t k = 0; k < SHProjector<order>::NumCoeffs; ++k)
+		{
+			EXPECT_NEAR(expected[k].x, result[k].x, tolerance) << "size " << size << ", coefficient " << static_cast<int>(k);
+			EXPECT_NEAR(expected[k].y, result[k].y, tolerance) << "size " << size << ", coefficient " << static_cast<int>(k);
+			EXPECT_NEAR(expected[k].z, result[k].z, tolerance) << "size " << size << ", coefficient " << static_cast<int>(k);
+		}
+	}
+}
+
+TEST(SH, ProjectionSIMDMatchesScalar)
+{
+	if (GetNativeISA() == ISA::SCALAR) GTEST_SKIP() << "No SIMD instruction set on this processor";
+
+	testSHProjection<2>();
+	testSHProjection<3>();
+	testSHProjection<5>();
+}
+
+// The bands are reduced in order, so the coefficients do not depend on the scheduler.
+TEST(SH, ProjectionIndependentOfThreads)
+{
+	static const auto size = 200u;
+
+	CubeMap radiance;
+	ASSERT_TRUE(radiance.Create(size));
+	TestUtils::FillRandom(radiance, size);
+
+	float3 expected[SHProjector<3>::NumCoeffs];
+	for (const auto numThreads : { 1u, 2u, 4u })
+	{
+		const auto scheduler = make_shared<Scheduler>();
+		ASSERT_TRUE(scheduler->Init(numThreads));
+
+		SHProjector<3> projector;
+		ASSERT_TRUE(projector.Init(scheduler));
+
+		float3 coeffs[SHProjector<3>::NumCoeffs];
+		ASSERT_TRUE(projector.Project(radiance, numThreads == 1 ? expected : coeffs));
+		if (numThreads > 1) EXPECT_EQ(0, memcmp(expected, coeffs, sizeof(coeffs))) << numThreads << " threads";
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Rotation against re-projecting the rotated environment
+//--------------------------------------------------------------------------------------
+
+// Polynomials up to degree 4, band-limited to order 5, with a different one per channel
+static float3 environment(const float3& d)
+{
+	return float3(
+		1.0f + 0.5f * d.x - 0.3f * d.y + 0.8f * d.z + 0.4f * d.x * d.y - 0.2f * d.z * d.z,
+		0.7f + 0.2f * d.y * d.z + 0.6f * d.x * d.x * d.y - 0.3f * d.x * d.y * d.z * d.z,
+		0.9f - 0.4f * d.x + 0.3f * d.y * d.y * d.y * d.y + 0.5f * d.x * d.z * d.z);
+}
+
+// Rotation by angle about a unit axis (Rodrigues)
+static void axisAngle(const float3& axis, float angle, float rotation[3][3])
+{
+	const float a[] = { axis.x, axis.y, axis.z };
+	const auto c = cos(angle);
+	const auto s = sin(angle);
+	for (auto i = 0; i < 3; ++i)
+		for (auto j = 0; j < 3; ++j)
+			rotation[i][j] = (1.0f - c) * a[i] * a[j] + (i == j ? c : 0.0f);
+	rotation[0][1] -= s * a[2];
+	rotation[0][2] += s * a[1];
+	rotation[1][0] += s * a[2];
+	rotation[1][2] -= s * a[0];
+	rotation[2][0] -= s * a[1];
+	rotation[2][1] += s * a[0];
+}
+
+template<uint8_t order>
+static void testRotation(const float rotation[3][3])
+{
+	static const auto size = 64u;
+	static const auto tolerance = 1.0e-3f;
+
+	CubeMap radiance, rotated;
+	ASSERT_TRUE(radiance.Create(size));
+	ASSERT_TRUE(rotated.Create(size));
+	TestUtils::FillFunction(radiance, environment);
+
+	// The rotated environment is f(inverse(rotation) * d), and the inverse is the transpose.
+	TestUtils::FillFunction(rotated, [rotation](const float3& d)
+	{
+		return environment(float3(
+			rotation[0][0] * d.x + rotation[1][0] * d.y + rotation[2][0] * d.z,
+			rotation[0][1] * d.x + rotation[1][1] * d.y + rotation[2][1] * d.z,
+			rotation[0][2] * d.x + rotation[1][2] * d.y + rotation[2][2] * d.z));
+	});
+
+	SHProjector<order> projector;
+	ASSERT_TRUE(projector.Init());
+
+	float3 coeffs[SHProjector<order>::NumCoeffs], expected[SHProjector<order>::NumCoeffs];
+	ASSERT_TRUE(projector.Project(radiance, coeffs));
+	ASSERT_TRUE(projector.Project(rotated, expected));
+
+	SHRotation<order> shRotation;
+	shRotation.SetRotation(rotation);
+	shRotation.Rotate(coeffs, coeffs);
+
+	for (uint8_t k = 0; k < SHProjector<order>::NumCoeffs; ++k)
+	{
+		EXPECT_NEAR(expected[k].x, coeffs[k].x, tolerance) << "order " << static_cast<int>(order) << ", coefficient " << static_cast<int>(k);
+		EXPECT_NEAR(expected[k].y, coeffs[k].y, tolerance) << "order " << static_cast<int>(order) << ", coefficient " << static_cast<int>(k);
+		EXPECT_NEAR(expected[k].z, coeffs[k].z, tolerance) << "order " << static_cast<int>(order) << ", coefficient " << static_cast<int>(k);
+	}
+}
+
+TEST(SH, RotationMatchesReprojection)
+{
+	const float3 axes[] =
+	{
+		float3(0.0f, 1.0f, 0.0f),
+		float3(1.0f, 0.0f, 0.0f),
+		float3(0.48f, 0.6f, 0.64f)
+	};
+
+	for (const auto& axis : axes)
+		for (const auto angle : { 0.3f, 1.9f, -2.6f })
+		{
+			float rotation[3][3];
+			axisAngle(axis, angle, rotation);
+			testRotation<2>(rotation);
+			testRotation<3>(rotation);
+			testRotation<4>(rotation);
+			testRotation<5>(rotation);
+		}
+}
+
+TEST(SH, IdentityRotationKeepsCoefficients)
+{
+	static const float identity[3][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+
+	float3 coeffs[SHRotation<5>::NumCoeffs], rotated[SHRotation<5>::NumCoeffs];
+	for (uint8_t k = 0; k < SHRotation<5>::NumCoeffs; ++k)
+		coeffs[k] = float3(k * 0.25f, 1.0f - k * 0.125f, k * k * 0.01f);
+
+	SHRotation<5> shRotation;
+	shRotation.SetRotation(identity);
+	shRotation.Rotate(coeffs, rotated);
+	for (uint8_t k = 0; k < SHRotation<5>::NumCoeffs; ++k)
+	{
+		EXPECT_FLOAT_EQ(coeffs[k].x, rotated[k].x);
+		EXPECT_FLOAT_EQ(coeffs[k].y, rotated[k].y);
+		EXPECT_FLOAT_EQ(coeffs[k].z, rotated[k].z);
+	}
+}
@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include "CPU/CubeMap.h"
+
+namespace TestUtils
+{
+#ifdef TEST_ASSET_DIR
+	// Assets shipped in Bin/Assets, and a directory for the files written by the tests
+	inline std::string GetAssetPath(const char* fileName)
+	{
+		return std::string(TEST_ASSET_DIR) + "/" + fileName;
+	}
+
+	inline std::string GetOutputPath(const char* fileName)
+	{
+		return std::string(TEST_OUTPUT_DIR) + "/" + fileName;
+	}
+#endif
+
+	// Fills all the mips with values in [0, 1), which keeps the kernels free of denormals;
+	// the benchmarks use the same inputs.
+	inline void FillRandom(CPU::CubeMap& cube, uint32_t seed)
+	{
+		for (uint8_t i = 0; i < cube.GetNumMips(); ++i)
+		{
+			const auto count = static_cast<size_t>(cube.GetSize(i)) * cube.GetSize(i);
+			for (uint8_t s = 0; s < CPU::CubeMap::FaceCount; ++s)
+				for (uint8_t c = 0; c < CPU::CubeMap::ChannelCount; ++c)
+				{
+					const auto pPlane = cube.GetPlane(i, s, c);
+					for (size_t k = 0; k < count; ++k)
+					{
+						seed = seed * 1664525u + 1013904223u;
+						pPlane[k] = (seed >> 8) * (1.0f / 16777216.0f);
+					}
+				}
+		}
+	}
+
+	// Fills level 0 with func(unit direction) at the texel centers
+	template<typename Func>
+	void FillFunction(CPU::CubeMap& cube, const Func& func)
+	{
+		const auto size = cube.GetSize();
+		for (uint8_t s = 0; s < CPU::CubeMap::FaceCount; ++s)
+			for (auto y = 0u; y < size; ++y)
+				for (auto x = 0u; x < size; ++x)
+				{
+					const auto dir = CPU::GetCubeTexcoord(x, y, s, size);
+					const auto rcpLen = 1.0f / std::sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+					cube.Store(0, s, x, y, func(CPU::float3(dir.x * rcpLen, dir.y * rcpLen, dir.z * rcpLen)));
+				}
+	}
+}
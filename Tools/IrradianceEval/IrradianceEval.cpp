@@ -0,0 +1,647 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// Headless accuracy and cost comparison of the irradiance methods on every *_cross.dds
+// of the asset directory: each method is measured against the brute-force convolution
+// of IrradianceGT at the texel centers of a cube of the evaluation size, and the results
+// are written as JSON, so that regressions can be tracked per commit.
+//
+// All the irradiance is compared as stored in the irradiance maps, divided by PI.
+// Per method and environment:
+//   rmse              RMS of the RGB differences, weighted by the texel solid angles
+//   relativeRmse      rmse over the RMS of the reference
+//   maxRelativeError  largest |Y - Yref| / Yref of the Rec.709 luminance over the texels
+//   angularError      angles between the RGB vectors of the method and the reference,
+//                     in degrees, as a histogram of the solid-angle fractions per bin
+//   timeMs            wall time of the per-frame work, the fastest of the repetitions
+//   bytesTouched      compulsory memory traffic of the per-frame work, from a model in
+//                     which each pass reads its inputs and writes its outputs once
+//   peakBytes         heap peak over the heap in use before the method was created
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+#include "CPU/IrradianceGT.h"
+#include "CPU/IrradianceMC.h"
+#include "CPU/LightProbe.h"
+#include "CPU/SphericalHarmonics.h"
+#include "Optional/XUSGDDSReader.h"
+
+using namespace std;
+using namespace CPU;
+
+//--------------------------------------------------------------------------------------
+// Heap tracking through the global operator new, which the CPU modules allocate with
+//--------------------------------------------------------------------------------------
+static atomic<size_t> g_heapBytes(0);
+static atomic<size_t> g_heapPeak(0);
+
+namespace
+{
+	// Prefix of each block, keeping the alignment of the default operator new
+	union AllocHeader
+	{
+		size_t		Size;
+		max_align_t	Align;
+	};
+}
+
+void* operator new(size_t size)
+{
+	const auto pHeader = static_cast<AllocHeader*>(malloc(sizeof(AllocHeader) + size));
+	if (!pHeader) throw bad_alloc();
+	pHeader->Size = size;
+
+	const auto bytes = g_heapBytes += size;
+	auto peak = g_heapPeak.load();
+	while (bytes > peak && !g_heapPeak.compare_exchange_weak(peak, bytes));
+
+	return pHeader + 1;
+}
+
+void operator delete(void* p) noexcept
+{
+	if (!p) return;
+
+	const auto pHeader = static_cast<AllocHeader*>(p) - 1;
+	g_heapBytes -= pHeader->Size;
+	free(pHeader);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+static size_t resetHeapPeak()
+{
+	const auto bytes = g_heapBytes.load();
+	g_heapPeak = bytes;
+
+	return bytes;
+}
+
+//--------------------------------------------------------------------------------------
+// Evaluation
+//--------------------------------------------------------------------------------------
+static const float AngleBinEdges[] = { 0.0f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 180.0f };
+static const auto NumAngleBins = static_cast<uint8_t>(sizeof(AngleBinEdges) / sizeof(float) - 1);
+static const auto PI = 3.141592654f;
+
+struct Result
+{
+	string Name;
+	bool Failed;
+	double TimeMs;
+	uint64_t BytesTouched;
+	size_t PeakBytes;
+	bool HasMetrics;
+	double RMSE;
+	double RelativeRMSE;
+	double MaxRelativeError;
+	double MeanAngularError;
+	double AngularHistogram[NumAngleBins];
+};
+
+// Texel centers of the evaluation cube, with the directions as x, y and z planes
+// and the RGB of each method as R, G and B planes, all faces after each other
+struct EvalGrid
+{
+	uint32_t Size;
+	size_t Count;
+	vector<float> Normals;
+	vector<float> SolidAngles;
+};
+
+static void createGrid(EvalGrid& grid, uint32_t size)
+{
+	grid.Size = size;
+	grid.Count = static_cast<size_t>(size) * size * CubeMap::FaceCount;
+	grid.Normals.resize(grid.Count * 3);
+	grid.SolidAngles.resize(grid.Count);
+
+	auto k = size_t(0);
+	for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+		for (auto i = 0u; i < size; ++i)
+			for (auto j = 0u; j < size; ++j, ++k)
+			{
+				const auto dir = GetCubeTexcoord(j, i, s, size);
+				const auto rcpLen = 1.0f / sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+				grid.Normals[k] = dir.x * rcpLen;
+				grid.Normals[grid.Count + k] = dir.y * rcpLen;
+				grid.Normals[grid.Count * 2 + k] = dir.z * rcpLen;
+				grid.SolidAngles[k] = GetCubeTexelSolidAngle(j, i, size);
+			}
+}
+
+// Samples level 0 of a cube map of any size at the texel centers of the grid, as the renderer does
+static void sampleGrid(const EvalGrid& grid, const CubeMap& cube, vector<float>& rgb)
+{
+	rgb.resize(grid.Count * 3);
+	for (auto k = size_t(0); k < grid.Count; ++k)
+	{
+		const float3 dir(grid.Normals[k], grid.Normals[grid.Count + k], grid.Normals[grid.Count * 2 + k]);
+		const auto color = cube.SampleLevel(dir, 0);
+		rgb[k] = color.x;
+		rgb[grid.Count + k] = color.y;
+		rgb[grid.Count * 2 + k] = color.z;
+	}
+}
+
+static void evaluate(const EvalGrid& grid, const vector<float>& rgb, const vector<float>& ref, Result& result)
+{
+	const auto n = grid.Count;
+
+	// Floor of the luminance of the reference in the relative error
+	auto meanLum = 0.0;
+	for (auto k = size_t(0); k < n; ++k)
+		meanLum += 0.2126 * ref[k] + 0.7152 * ref[n + k] + 0.0722 * ref[n * 2 + k];
+	const auto minLum = (max)(meanLum / n * 1.0e-4, 1.0e-12);
+
+	auto sumWeights = 0.0, sumSqErr = 0.0, sumSqRef = 0.0, sumAngles = 0.0;
+	result.MaxRelativeError = 0.0;
+	fill_n(result.AngularHistogram, NumAngleBins, 0.0);
+	for (auto k = size_t(0); k < n; ++k)
+	{
+		const double a[] = { rgb[k], rgb[n + k], rgb[n * 2 + k] };
+		const double b[] = { ref[k], ref[n + k], ref[n * 2 + k] };
+		const double w = grid.SolidAngles[k];
+
+		auto sqErr = 0.0, sqRef = 0.0, sqEst = 0.0, dot = 0.0;
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			sqErr += (a[c] - b[c]) * (a[c] - b[c]);
+			sqRef += b[c] * b[c];
+			sqEst += a[c] * a[c];
+			dot += a[c] * b[c];
+		}
+		sumWeights += w;
+		sumSqErr += w * sqErr;
+		sumSqRef += w * sqRef;
+
+		const auto lum = 0.2126 * a[0] + 0.7152 * a[1] + 0.0722 * a[2];
+		const auto lumRef = 0.2126 * b[0] + 0.7152 * b[1] + 0.0722 * b[2];
+		result.MaxRelativeError = (max)(fabs(lum - lumRef) / (max)(lumRef, minLum), result.MaxRelativeError);
+
+		// Black against black has no angle; black against a color is orthogonal
+		const auto norms = sqrt(sqEst * sqRef);
+		const auto angle = norms > 0.0 ? acos((min)((max)(dot / norms, -1.0), 1.0)) * 180.0 / PI :
+			(sqEst > 0.0 || sqRef > 0.0 ? 90.0 : 0.0);
+		sumAngles += w * angle;
+
+		auto bin = uint8_t(0);
+		while (bin + 1 < NumAngleBins && angle >= AngleBinEdges[bin + 1]) ++bin;
+		result.AngularHistogram[bin] += w;
+	}
+
+	result.HasMetrics = true;
+	result.RMSE = sqrt(sumSqErr / (sumWeights * 3.0));
+	result.RelativeRMSE = sumSqRef > 0.0 ? sqrt(sumSqErr / sumSqRef) : 0.0;
+	result.MeanAngularError = sumAngles / sumWeights;
+	for (auto& fraction : result.AngularHistogram) fraction /= sumWeights;
+}
+
+// Fastest wall time of the repetitions of the per-frame work, in milliseconds
+static double timeRuns(uint32_t repeat, const function<bool()>& run)
+{
+	auto best = 0.0;
+	for (auto i = 0u; i < repeat; ++i)
+	{
+		const auto start = chrono::steady_clock::now();
+		if (!run()) return -1.0;
+		const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		best = i > 0 ? (min)(elapsed.count(), best) : elapsed.count();
+	}
+
+	return best;
+}
+
+static uint64_t getCubeBytes(uint32_t size)
+{
+	return static_cast<uint64_t>(size) * size * CubeMap::FaceCount * CubeMap::ChannelCount * sizeof(float);
+}
+
+//--------------------------------------------------------------------------------------
+// Methods
+//--------------------------------------------------------------------------------------
+
+// MIP_APPROX: the CPU light probe, with one source
+static bool runMipCos(const CubeMap::sptr& radiance, const EvalGrid& grid, const Scheduler::sptr& scheduler,
+	uint32_t repeat, vector<float>& rgb, Result& result)
+{
+	result.Name = "MipCos";
+	const auto baseBytes = resetHeapPeak();
+	{
+		LightProbe lightProbe;
+		if (!lightProbe.Init(&radiance, 1, LightProbe::UPSAMPLE_PER_LEVEL, scheduler)) return false;
+		lightProbe.UpdateFrame(0.0);
+
+		result.TimeMs = timeRuns(repeat, [&]() { lightProbe.Process(); return true; });
+		sampleGrid(grid, *lightProbe.GetIrradiance(), rgb);
+		result.PeakBytes = g_heapPeak - baseBytes;
+
+		// Radiance copy; mip generation from it; in-place up sampling of each level from
+		// its coarser level down to level 0, which reads the radiance instead
+		const auto& irradiance = *lightProbe.GetIrradiance();
+		const uint8_t numLevels = irradiance.GetNumMips();
+		auto bytes = getCubeBytes(irradiance.GetSize(0)) * 2;
+		for (uint8_t i = 1; i < numLevels; ++i)
+			bytes += getCubeBytes(irradiance.GetSize(i - 1)) + getCubeBytes(irradiance.GetSize(i));
+		for (uint8_t i = 0; i + 1 < numLevels; ++i)
+			bytes += getCubeBytes(irradiance.GetSize(i + 1)) + getCubeBytes(irradiance.GetSize(i)) * 2;
+		result.BytesTouched = bytes;
+	}
+
+	return true;
+}
+
+// SH_APPROX: projection of the radiance, then evaluation per normal
+template<uint8_t order>
+static bool runSH(const CubeMap& radiance, const EvalGrid& grid, const Scheduler::sptr& scheduler,
+	uint32_t repeat, ISA isa, vector<float>& rgb, Result& result)
+{
+	result.Name = "SH" + to_string(order);
+	const auto baseBytes = resetHeapPeak();
+	{
+		SHProjector<order> projector;
+		if (!projector.Init(scheduler)) return false;
+
+		rgb.resize(grid.Count * 3);
+		float3 coeffs[order * order];
+		const float* const pNormals[] = { &grid.Normals[0], &grid.Normals[grid.Count], &grid.Normals[grid.Count * 2] };
+		float* const pIrradiance[] = { &rgb[0], &rgb[grid.Count], &rgb[grid.Count * 2] };
+		result.TimeMs = timeRuns(repeat, [&]()
+		{
+			if (!projector.Project(radiance, coeffs, 0, isa)) return false;
+			EvaluateSHIrradiance<order>(coeffs, pNormals, pIrradiance, grid.Count, isa);
+
+			return true;
+		});
+		if (result.TimeMs < 0.0) return false;
+		result.PeakBytes = g_heapPeak - baseBytes;
+
+		// The SH irradiance is not divided by PI
+		for (auto& value : rgb) value /= PI;
+
+		// The radiance with its upper-half solid-angle rows, then the normals and the irradiance
+		const auto size = radiance.GetSize();
+		result.BytesTouched = getCubeBytes(size) + static_cast<uint64_t>(size) * size / 2 * sizeof(float) +
+			grid.Count * 6 * sizeof(float);
+	}
+
+	return true;
+}
+
+// GROUND_TRUTH: the baked sidecar loaded by the renderer, as decoded
+static bool runGTFile(const string& fileName, const EvalGrid& grid, uint32_t repeat, vector<float>& rgb, Result& result)
+{
+	result.Name = "GTFile";
+	const auto baseBytes = resetHeapPeak();
+	{
+		CubeMap irradiance;
+		result.TimeMs = timeRuns(repeat, [&]()
+		{
+			XUSG::DDS::Reader reader;
+
+			return reader.Open(fileName.c_str()) && irradiance.Create(reader, 1);
+		});
+		if (result.TimeMs < 0.0) return false;
+		sampleGrid(grid, irradiance, rgb);
+		result.PeakBytes = g_heapPeak - baseBytes;
+
+		// The file, then the decoded level 0
+		ifstream file(fileName, ios::binary | ios::ate);
+		result.BytesTouched = static_cast<uint64_t>(file.tellg()) + getCubeBytes(irradiance.GetSize());
+	}
+
+	return true;
+}
+
+// Stochastic reference, at the evaluation size
+static bool runMC(const CubeMap& radiance, const EvalGrid& grid, const Scheduler::sptr& scheduler,
+	float tolerance, vector<float>& rgb, Result& result)
+{
+	result.Name = "MC";
+	const auto baseBytes = resetHeapPeak();
+	{
+		IrradianceMC integrator;
+		CubeMap irradiance;
+		if (!integrator.Init(scheduler) || !irradiance.Create(grid.Size)) return false;
+
+		// Deterministic per texel, so a single run
+		result.TimeMs = timeRuns(1, [&]() { return integrator.Convolve(radiance, irradiance, 0, tolerance); });
+		if (result.TimeMs < 0.0) return false;
+		sampleGrid(grid, irradiance, rgb);
+		result.PeakBytes = g_heapPeak - baseBytes;
+
+		// The radiance into the CDF, then the radiance and the luminance density
+		// (a double) at both directions of each sample, and the irradiance
+		result.BytesTouched = getCubeBytes(radiance.GetSize()) + integrator.GetTotalSampleCount() * 2 *
+			(sizeof(float3) + sizeof(double)) + getCubeBytes(grid.Size);
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Output
+//--------------------------------------------------------------------------------------
+static string quote(const string& str)
+{
+	string result = "\"";
+	for (const auto c : str)
+	{
+		if (c == '"' || c == '\\') result += '\\';
+		result += c;
+	}
+
+	return result + "\"";
+}
+
+static void writeResult(ostream& out, const Result& result, bool isLast)
+{
+	out << "        {\n          \"name\": " << quote(result.Name) << ",\n";
+	if (result.Failed)
+	{
+		out << "          \"error\": \"failed\"\n        }" << (isLast ? "" : ",") << "\n";
+
+		return;
+	}
+	out << "          \"timeMs\": " << result.TimeMs << ",\n";
+	if (result.BytesTouched) out << "          \"bytesTouched\": " << result.BytesTouched << ",\n";
+	out << "          \"peakBytes\": " << result.PeakBytes;
+	if (result.HasMetrics)
+	{
+		out << ",\n          \"rmse\": " << result.RMSE << ",\n";
+		out << "          \"relativeRmse\": " << result.RelativeRMSE << ",\n";
+		out << "          \"maxRelativeError\": " << result.MaxRelativeError << ",\n";
+		out << "          \"meanAngularErrorDeg\": " << result.MeanAngularError << ",\n";
+		out << "          \"angularErrorHistogram\": [";
+		for (uint8_t i = 0; i < NumAngleBins; ++i) out << (i ? ", " : "") << result.AngularHistogram[i];
+		out << "]";
+	}
+	out << "\n        }" << (isLast ? "" : ",") << "\n";
+}
+
+// Cube maps named *_cross.dds in the directory, in name order
+static vector<string> listEnvironments(const string& dir)
+{
+	static const char suffix[] = "_cross.dds";
+	static const auto suffixLen = sizeof(suffix) - 1;
+
+	vector<string> names;
+#if defined(_WIN32)
+	WIN32_FIND_DATAA findData;
+	const auto hFind = FindFirstFileA((dir + "\\*_cross.dds").c_str(), &findData);
+	if (hFind != INVALID_HANDLE_VALUE)
+	{
+		do names.emplace_back(findData.cFileName);
+		while (FindNextFileA(hFind, &findData));
+		FindClose(hFind);
+	}
+#else
+	const auto pDir = opendir(dir.c_str());
+	if (pDir)
+	{
+		while (const auto pEntry = readdir(pDir)) names.emplace_back(pEntry->d_name);
+		closedir(pDir);
+	}
+#endif
+
+	// The Windows wildcard also matches longer extensions
+	names.erase(remove_if(names.begin(), names.end(), [](const string& name)
+	{
+		return name.size() <= suffixLen || name.compare(name.size() - suffixLen, suffixLen, suffix);
+	}), names.end());
+	sort(names.begin(), names.end());
+
+	return names;
+}
+
+static void printUsage()
+{
+	fprintf(stderr,
+		"Usage: IrradianceEval [options]\n"
+		"  -assets <dir>     Directory of the *_cross.dds environments (default: Assets)\n"
+		"  -o <file>         Output JSON file (default: standard output)\n"
+		"  -tag <string>     Label of the run, e.g. the commit, written into the JSON\n"
+		"  -size <n>         Face size of the evaluation and of the reference (default: 128)\n"
+		"  -shorder <n>      SH order, 2 to 5 (default: 3)\n"
+		"  -repeat <n>       Repetitions of the timed work, the fastest taken (default: 5)\n"
+		"  -threads <n>      Worker threads (default: 0, all hardware threads)\n"
+		"  -isa <scalar|avx2>\n"
+		"  -mc               Also evaluate the Monte Carlo integrator\n"
+		"  -tolerance <t>    Relative standard error of the Monte Carlo integrator (default: 0.01)\n");
+}
+
+int main(int argc, char* argv[])
+{
+	string assetDir = "Assets";
+	string outFileName, tag;
+	auto size = 128u;
+	auto shOrder = 3u;
+	auto repeat = 5u;
+	auto numThreads = 0u;
+	auto isa = GetNativeISA();
+	auto hasMC = false;
+	auto tolerance = 0.01f;
+
+	for (auto i = 1; i < argc; ++i)
+	{
+		const auto hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-assets") && hasValue) assetDir = argv[++i];
+		else if (!strcmp(argv[i], "-o") && hasValue) outFileName = argv[++i];
+		else if (!strcmp(argv[i], "-tag") && hasValue) tag = argv[++i];
+		else if (!strcmp(argv[i], "-size") && hasValue) size = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-shorder") && hasValue) shOrder = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-repeat") && hasValue) repeat = (max)(strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (!strcmp(argv[i], "-threads") && hasValue) numThreads = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-isa") && hasValue)
+		{
+			++i;
+			if (!strcmp(argv[i], "scalar")) isa = ISA::SCALAR;
+			else if (!strcmp(argv[i], "avx2") && GetNativeISA() == ISA::AVX2) isa = ISA::AVX2;
+			else fprintf(stderr, "Unsupported ISA %s; using %s\n", argv[i], GetISAName(isa));
+		}
+		else if (!strcmp(argv[i], "-mc")) hasMC = true;
+		else if (!strcmp(argv[i], "-tolerance") && hasValue) tolerance = static_cast<float>(atof(argv[++i]));
+		else
+		{
+			printUsage();
+
+			return 1;
+		}
+	}
+
+	if (!size || shOrder < SHMinOrder || shOrder > SHMaxOrder)
+	{
+		printUsage();
+
+		return 1;
+	}
+
+	const auto envNames = listEnvironments(assetDir);
+	if (envNames.empty())
+	{
+		fprintf(stderr, "No *_cross.dds in %s\n", assetDir.c_str());
+
+		return 1;
+	}
+
+	// The light probe dispatches by the global ISA
+	SetISA(isa);
+	const auto scheduler = make_shared<Scheduler>();
+	if (!scheduler->Init(numThreads)) return 1;
+
+	EvalGrid grid;
+	createGrid(grid, size);
+
+	ofstream file;
+	if (!outFileName.empty())
+	{
+		file.open(outFileName);
+		if (!file)
+		{
+			fprintf(stderr, "Failed to open %s\n", outFileName.c_str());
+
+			return 1;
+		}
+	}
+
+	auto& out = outFileName.empty() ? cout : file;
+	out.precision(9);
+	out << "{\n  \"tag\": " << quote(tag) << ",\n";
+	out << "  \"evalSize\": " << size << ",\n  \"threads\": " << scheduler->GetNumThreads() << ",\n";
+	out << "  \"isa\": " << quote(GetISAName(isa)) << ",\n  \"repeat\": " << repeat << ",\n";
+	out << "  \"angularErrorBinEdgesDeg\": [";
+	for (uint8_t i = 0; i <= NumAngleBins; ++i) out << (i ? ", " : "") << AngleBinEdges[i];
+	out << "],\n  \"environments\": [\n";
+
+	// Evaluation buffers of the harness, outside the heap of the methods
+	vector<float> reference(grid.Count * 3), rgb(grid.Count * 3);
+	auto status = 0;
+
+	// Environments that cannot be evaluated are listed with an error, so the document stays complete
+	const auto writeFailure = [&](size_t e, const char* error)
+	{
+		fprintf(stderr, "%s: %s\n", envNames[e].c_str(), error);
+		out << "    {\n      \"name\": " << quote(envNames[e]) << ",\n      \"error\": " << quote(error) << "\n    }";
+		status = 1;
+	};
+
+	for (size_t e = 0; e < envNames.size(); ++e)
+	{
+		if (e > 0) out << ",\n";
+
+		const auto fileName = assetDir + "/" + envNames[e];
+		XUSG::DDS::Reader reader;
+		const auto radiance = make_shared<CubeMap>();
+		if (!reader.Open(fileName.c_str()) || !radiance->Create(reader, 1))
+		{
+			writeFailure(e, "failed to load the cube map");
+			continue;
+		}
+		fprintf(stderr, "%s: %u^2 x 6 texels\n", envNames[e].c_str(), radiance->GetSize());
+
+		// Reference
+		Result ref = {};
+		ref.Name = "GT";
+		{
+			const auto baseBytes = resetHeapPeak();
+			IrradianceGT convolver;
+			CubeMap irradiance;
+			ref.TimeMs = convolver.Init(scheduler) && irradiance.Create(size) ?
+				timeRuns(1, [&]() { return convolver.Convolve(*radiance, irradiance, 0, isa); }) : -1.0;
+			if (ref.TimeMs < 0.0)
+			{
+				writeFailure(e, "failed to compute the reference");
+				continue;
+			}
+			sampleGrid(grid, irradiance, reference);
+			ref.PeakBytes = g_heapPeak - baseBytes;
+		}
+
+		vector<Result> results;
+		const auto addResult = [&](bool success, Result& result)
+		{
+			if (!success)
+			{
+				fprintf(stderr, "  %s failed\n", result.Name.c_str());
+				result.Failed = true;
+				results.push_back(result);
+				status = 1;
+
+				return;
+			}
+			evaluate(grid, rgb, reference, result);
+			fprintf(stderr, "  %-7s %10.3f ms  relative RMSE %.5f\n", result.Name.c_str(), result.TimeMs, result.RelativeRMSE);
+			results.push_back(result);
+		};
+
+		Result result = {};
+		addResult(runMipCos(radiance, grid, scheduler, repeat, rgb, result), result);
+
+		result = {};
+		auto success = false;
+		switch (shOrder)
+		{
+		case 2:
+			success = runSH<2>(*radiance, grid, scheduler, repeat, isa, rgb, result);
+			break;
+		case 3:
+			success = runSH<3>(*radiance, grid, scheduler, repeat, isa, rgb, result);
+			break;
+		case 4:
+			success = runSH<4>(*radiance, grid, scheduler, repeat, isa, rgb, result);
+			break;
+		default:
+			success = runSH<5>(*radiance, grid, scheduler, repeat, isa, rgb, result);
+		}
+		addResult(success, result);
+
+		// The renderer bakes GROUND_TRUTH offline, so it is only evaluated when the sidecar exists
+		const auto gtFileName = fileName + "_gt.dds";
+		if (ifstream(gtFileName).good())
+		{
+			result = {};
+			addResult(runGTFile(gtFileName, grid, repeat, rgb, result), result);
+		}
+
+		if (hasMC)
+		{
+			result = {};
+			addResult(runMC(*radiance, grid, scheduler, tolerance, rgb, result), result);
+		}
+
+		out << "    {\n      \"name\": " << quote(envNames[e]) << ",\n      \"size\": " << radiance->GetSize() << ",\n";
+		out << "      \"reference\": { \"name\": " << quote(ref.Name) << ", \"timeMs\": " << ref.TimeMs <<
+			", \"peakBytes\": " << ref.PeakBytes << " },\n";
+		out << "      \"methods\": [\n";
+		for (size_t i = 0; i < results.size(); ++i) writeResult(out, results[i], i + 1 == results.size());
+		out << "      ]\n    }";
+	}
+	out << "\n  ]\n}\n";
+
+	return status;
+}
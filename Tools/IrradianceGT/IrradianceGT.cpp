@@ -0,0 +1,197 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// Bakes the ground-truth irradiance of an environment cube map into <env>_gt.dds, as
+// loaded by LightProbe::GetIrradianceGT, with the brute-force CPU convolution, or with
+// the Monte Carlo integrator for environments too large for it
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "CPU/BoxFilter.h"
+#include "CPU/IrradianceGT.h"
+#include "CPU/IrradianceMC.h"
+#include "Optional/XUSGDDSWriter.h"
+
+using namespace std;
+using namespace CPU;
+
+static void printUsage()
+{
+	fprintf(stderr,
+		"Usage: IrradianceGT <env.dds> [options]\n"
+		"  -o <file>         Output file (default: <env.dds>_gt.dds)\n"
+		"  -size <n>         Output face size (default: the input size)\n"
+		"  -mips <n>         Output mip levels (default: 0, the full chain)\n"
+		"  -srclevel <n>     Input level to convolve, box-filtered if not in the file (default: 0)\n"
+		"  -threads <n>      Worker threads (default: 0, all hardware threads)\n"
+		"  -isa <scalar|avx2>\n"
+		"  -float32          Write R32G32B32A32_FLOAT instead of R16G16B16A16_FLOAT\n"
+		"  -mc               Monte Carlo integration instead of the brute-force convolution\n"
+		"  -tolerance <t>    Relative standard error at which a texel stops sampling (default: 0.01)\n"
+		"  -maxsamples <n>   Samples per texel at most (default: 4096)\n"
+		"  -samples <file>   Output of the samples per texel, as an R32_FLOAT cube map\n"
+		"                    (default: <output>_samples.dds)\n");
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printUsage();
+
+		return 1;
+	}
+
+	const char* inFileName = argv[1];
+	string outFileName = string(inFileName) + "_gt.dds";
+	auto size = 0u;
+	auto numMips = 0u;
+	auto srcLevel = 0u;
+	auto numThreads = 0u;
+	auto isa = GetNativeISA();
+	auto format = XUSG::DDS::FORMAT_R16G16B16A16_FLOAT;
+	auto isMonteCarlo = false;
+	auto tolerance = 0.01f;
+	auto maxSamples = 4096u;
+	string samplesFileName;
+
+	for (auto i = 2; i < argc; ++i)
+	{
+		const auto hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-o") && hasValue) outFileName = argv[++i];
+		else if (!strcmp(argv[i], "-size") && hasValue) size = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-mips") && hasValue) numMips = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-srclevel") && hasValue) srcLevel = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-threads") && hasValue) numThreads = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-isa") && hasValue)
+		{
+			++i;
+			if (!strcmp(argv[i], "scalar")) isa = ISA::SCALAR;
+			else if (!strcmp(argv[i], "avx2") && GetNativeISA() == ISA::AVX2) isa = ISA::AVX2;
+			else fprintf(stderr, "Unsupported ISA %s; using %s\n", argv[i], GetISAName(isa));
+		}
+		else if (!strcmp(argv[i], "-float32")) format = XUSG::DDS::FORMAT_R32G32B32A32_FLOAT;
+		else if (!strcmp(argv[i], "-mc")) isMonteCarlo = true;
+		else if (!strcmp(argv[i], "-tolerance") && hasValue) tolerance = static_cast<float>(atof(argv[++i]));
+		else if (!strcmp(argv[i], "-maxsamples") && hasValue) maxSamples = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "-samples") && hasValue) samplesFileName = argv[++i];
+		else
+		{
+			printUsage();
+
+			return 1;
+		}
+	}
+
+	// Load the radiance, and reduce it down to the convolved level
+	XUSG::DDS::Reader reader;
+	CubeMap radiance, pyramid;
+	if (!reader.Open(inFileName) || !radiance.Create(reader, static_cast<uint8_t>((min)(srcLevel + 1, 255u))))
+	{
+		fprintf(stderr, "Failed to load the cube map %s\n", inFileName);
+
+		return 1;
+	}
+
+	auto pRadiance = &radiance;
+	if (srcLevel >= radiance.GetNumMips())
+	{
+		if (!pyramid.Create(radiance.GetSize(), static_cast<uint8_t>(srcLevel + 1)) || pyramid.GetNumMips() <= srcLevel)
+		{
+			fprintf(stderr, "Invalid source level %u\n", srcLevel);
+
+			return 1;
+		}
+
+		const auto srcMips = radiance.GetNumMips();
+		for (uint8_t i = 0; i < srcMips; ++i)
+		{
+			const size_t levelSize = radiance.GetSize(i);
+			for (uint8_t s = 0; s < CubeMap::FaceCount; ++s)
+				for (uint8_t c = 0; c < CubeMap::ChannelCount; ++c)
+					memcpy(pyramid.GetPlane(i, s, c), radiance.GetPlane(i, s, c), sizeof(float) * levelSize * levelSize);
+		}
+
+		for (uint8_t i = srcMips; i <= srcLevel; ++i)
+		{
+			if (!BoxDownsample(pyramid, i, pyramid, i - 1, isa))
+			{
+				fprintf(stderr, "Invalid source level %u\n", srcLevel);
+
+				return 1;
+			}
+		}
+
+		pRadiance = &pyramid;
+	}
+
+	CubeMap irradiance;
+	if (!irradiance.Create(size ? size : pRadiance->GetSize(), static_cast<uint8_t>((min)(numMips, 255u))))
+	{
+		fprintf(stderr, "Invalid output size %u\n", size);
+
+		return 1;
+	}
+
+	const auto scheduler = make_shared<Scheduler>();
+	if (!scheduler->Init(numThreads)) return 1;
+
+	const auto start = chrono::steady_clock::now();
+	IrradianceMC integrator;
+	if (isMonteCarlo)
+	{
+		if (!integrator.Init(scheduler) ||
+			!integrator.Convolve(*pRadiance, irradiance, static_cast<uint8_t>(srcLevel), tolerance, maxSamples))
+			return 1;
+	}
+	else
+	{
+		IrradianceGT convolver;
+		if (!convolver.Init(scheduler) || !convolver.Convolve(*pRadiance, irradiance, static_cast<uint8_t>(srcLevel), isa))
+			return 1;
+	}
+	const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	printf("%s %u^2 x 6 texels into %u^2 x 6 texels (%u mips) in %.3f s on %u threads, %s\n",
+		isMonteCarlo ? "Integrated" : "Convolved", pRadiance->GetSize(static_cast<uint8_t>(srcLevel)),
+		irradiance.GetSize(), irradiance.GetNumMips(), elapsed.count(), scheduler->GetNumThreads(),
+		isMonteCarlo ? "Monte Carlo" : GetISAName(isa));
+
+	XUSG::DDS::Writer writer;
+	if (!irradiance.Write(writer, format) || !writer.Save(outFileName.c_str()))
+	{
+		fprintf(stderr, "Failed to write %s\n", outFileName.c_str());
+
+		return 1;
+	}
+	printf("Saved %s\n", outFileName.c_str());
+
+	// Diagnostics of the Monte Carlo integration
+	if (isMonteCarlo)
+	{
+		const auto numTexels = static_cast<double>(irradiance.GetSize()) * irradiance.GetSize() * CubeMap::FaceCount;
+		printf("%.1f samples per texel on average\n", integrator.GetTotalSampleCount() / numTexels);
+
+		if (samplesFileName.empty()) samplesFileName = outFileName + "_samples.dds";
+		XUSG::DDS::Writer samplesWriter;
+		auto success = samplesWriter.Create(irradiance.GetSize(), irradiance.GetSize(), 1, 1, XUSG::DDS::FORMAT_R32_FLOAT, true);
+		for (uint8_t s = 0; s < CubeMap::FaceCount && success; ++s)
+			success = samplesWriter.Encode(s, 0, integrator.GetSampleCounts(s), 1);
+		if (!success || !samplesWriter.Save(samplesFileName.c_str()))
+		{
+			fprintf(stderr, "Failed to write %s\n", samplesFileName.c_str());
+
+			return 1;
+		}
+		printf("Saved %s\n", samplesFileName.c_str());
+	}
+
+	return 0;
+}